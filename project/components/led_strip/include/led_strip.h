@@ -0,0 +1,226 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_rmt.h"
+#include "led_strip_spi.h"
+#include "led_strip_multi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Set RGB for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ *
+ * @return
+ *      - ESP_OK: Set RGB for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+ *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+/**
+ * @brief Set RGBW for a specific pixel
+ *
+ * @note Only call this function if your led strip does have the white component (e.g. SK6812-RGBW)
+ * @note Also see `led_strip_set_pixel` if you only want to specify the RGB part of the color and bypass the white component
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param red: red part of color
+ * @param green: green part of color
+ * @param blue: blue part of color
+ * @param white: separate white component
+ *
+ * @return
+ *      - ESP_OK: Set RGBW color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+/**
+ * @brief Set HSV for a specific pixel
+ *
+ * @param strip: LED strip
+ * @param index: index of pixel to set
+ * @param hue: hue part of color (0 - 360)
+ * @param saturation: saturation part of color (0 - 255, rescaled from 0 - 1. e.g. saturation = 0.5, rescaled to 127)
+ * @param value: value part of color (0 - 255, rescaled from 0 - 1. e.g. value = 0.5, rescaled to 127)
+ *
+ * @return
+ *      - ESP_OK: Set HSV color for a specific pixel successfully
+ *      - ESP_ERR_INVALID_ARG: Set HSV color for a specific pixel failed because of an invalid argument
+ *      - ESP_FAIL: Set HSV color for a specific pixel failed because other error occurred
+ */
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value);
+
+/**
+ * @brief Set RGB for a run of consecutive pixels
+ *
+ * @note Faster than calling `led_strip_set_pixel` in a loop, the range is checked once and the backend writes its buffer directly
+ * @note On strips with a white component, white is set to 0 as in `led_strip_set_pixel`
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel to set
+ * @param colors: colors of the pixels, `count` entries
+ * @param count: number of pixels to set
+ *
+ * @return
+ *      - ESP_OK: Set RGB for the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because of invalid parameters (e.g. the run goes past the strip)
+ *      - ESP_FAIL: Set RGB for the pixels failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count);
+
+/**
+ * @brief Set a run of consecutive pixels to the same RGB color
+ *
+ * @note The color is encoded once and copied, on strips with a white component white is set to 0
+ *
+ * @param strip: LED strip
+ * @param start: index of the first pixel to set
+ * @param count: number of pixels to set
+ * @param color: color of the pixels
+ *
+ * @return
+ *      - ESP_OK: Fill the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Fill the pixels failed because of invalid parameters (e.g. the run goes past the strip)
+ *      - ESP_FAIL: Fill the pixels failed because other error occurred
+ */
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t start, uint32_t count, led_strip_rgb_t color);
+
+/**
+ * @brief Refresh memory colors to LEDs
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Refresh successfully
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ *
+ * @note:
+ *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+ * @note:
+ *      A frame in which no pixel changed since the last transmitted one is skipped, see `led_strip_set_keep_alive`.
+ * @note:
+ *      With an asynchronous backend (e.g. SPI with `flags.async_refresh`) the frame is queued and this function returns at once.
+ *      Pixels can be set for the next frame right away, use `led_strip_wait_refresh_done` to know when the frame is on the strip.
+ */
+esp_err_t led_strip_refresh(led_strip_handle_t strip);
+
+/**
+ * @brief Wait for the last refresh to be transmitted
+ *
+ * @note Backends without an asynchronous refresh transmit before `led_strip_refresh` returns, for them this returns ESP_OK at once
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: maximum time to wait in milliseconds, -1 to wait forever, 0 to poll
+ *
+ * @return
+ *      - ESP_OK: No refresh is in flight any more
+ *      - ESP_ERR_INVALID_ARG: Wait failed because of invalid argument
+ *      - ESP_ERR_TIMEOUT: The refresh is still being transmitted
+ *      - ESP_FAIL: Wait failed because some other error occurred
+ */
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int timeout_ms);
+
+/**
+ * @brief Set the color correction (brightness, gamma, white point) of a strip
+ *
+ * @note The correction is fused into one 256-entry table per component and applied by the backend while it encodes
+ *       the stored pixels at refresh, so it costs no extra pass. It applies to every pixel from the next refresh on,
+ *       which sends the frame again if the correction changed.
+ * @note On a multi strip the correction is set on each output.
+ *
+ * @param strip: LED strip
+ * @param correction: color correction, NULL to remove it
+ *
+ * @return
+ *      - ESP_OK: Set the color correction successfully
+ *      - ESP_ERR_INVALID_ARG: Set the color correction failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: Set the color correction failed because of out of memory
+ */
+esp_err_t led_strip_set_color_correction(led_strip_handle_t strip, const led_strip_color_correction_t *correction);
+
+/**
+ * @brief Change only the global brightness of the color correction
+ *
+ * @note Rebuilds the lookup tables from the cached gamma curves, with integer maths only. Without a color correction
+ *       set before, the gamma is linear and the white point neutral.
+ *
+ * @param strip: LED strip
+ * @param brightness: global brightness, 255 for full
+ *
+ * @return
+ *      - ESP_OK: Set the brightness successfully
+ *      - ESP_ERR_INVALID_ARG: Set the brightness failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: Set the brightness failed because of out of memory
+ */
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness);
+
+/**
+ * @brief Resend unchanged frames at a minimum rate
+ *
+ * @note `led_strip_refresh` skips frames in which no pixel changed since the last transmitted one. With a keep-alive interval,
+ *       a refresh at least that long after the last transmission is sent anyway, e.g. to repair a strip glitched by noise.
+ *       Only refresh calls transmit, this does not start a timer.
+ *
+ * @param strip: LED strip
+ * @param interval_ms: minimum time between transmissions of an unchanged frame, 0 (the default) to never resend one
+ *
+ * @return
+ *      - ESP_OK: Set the keep-alive interval successfully
+ *      - ESP_ERR_INVALID_ARG: Set the keep-alive interval failed because of invalid argument
+ */
+esp_err_t led_strip_set_keep_alive(led_strip_handle_t strip, uint32_t interval_ms);
+
+/**
+ * @brief Get the refresh counters: refreshes requested and frames actually transmitted
+ *
+ * @param strip: LED strip
+ * @param stats: filled in with the counters
+ *
+ * @return
+ *      - ESP_OK: Get the counters successfully
+ *      - ESP_ERR_INVALID_ARG: Get the counters failed because of invalid argument
+ */
+esp_err_t led_strip_get_refresh_stats(led_strip_handle_t strip, led_strip_refresh_stats_t *stats);
+
+/**
+ * @brief Clear LED strip (turn off all LEDs)
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Clear LEDs successfully
+ *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+ */
+esp_err_t led_strip_clear(led_strip_handle_t strip);
+
+/**
+ * @brief Free LED strip resources
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Free resources successfully
+ *      - ESP_FAIL: Free resources failed because error occurred
+ */
+esp_err_t led_strip_del(led_strip_handle_t strip);
+
+#ifdef __cplusplus
+}
+#endif
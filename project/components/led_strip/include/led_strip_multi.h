@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of segments in a multi-output LED strip
+ */
+#define LED_STRIP_MULTI_MAX_SEGMENTS 8
+
+/**
+ * @brief One run of consecutive logical pixels mapped onto a physical strip
+ */
+typedef struct {
+    led_strip_handle_t strip; /*!< Physical strip driving this segment, created with any backend */
+    uint32_t offset;          /*!< Index of the first pixel of the segment on the physical strip */
+    uint32_t length;          /*!< Number of pixels in the segment */
+    bool reverse;             /*!< The segment runs backwards on the physical strip (e.g. a strip fed from its far end) */
+} led_strip_segment_t;
+
+/**
+ * @brief Multi-output LED strip configuration
+ */
+typedef struct {
+    const led_strip_segment_t *segments; /*!< Segments in logical order: logical pixel 0 is the first pixel of segments[0] */
+    uint32_t num_segments;               /*!< Number of segments, up to LED_STRIP_MULTI_MAX_SEGMENTS */
+} led_strip_multi_config_t;
+
+/**
+ * @brief Create one logical LED strip spread over several physical strips
+ *
+ * @note Refresh starts every physical strip in turn, create them with `flags.async_refresh` so they transmit concurrently
+ *       and the frame time is bounded by the longest one. A synchronous strip blocks the others until it is done.
+ * @note The physical strips are owned by the multi strip from then on, `led_strip_del` deletes them too.
+ *
+ * @param config Multi strip configuration, the segment array is copied
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ */
+esp_err_t led_strip_new_multi(const led_strip_multi_config_t *config, led_strip_handle_t *ret_strip);
+
+#ifdef __cplusplus
+}
+#endif
@@ -25,7 +25,10 @@ typedef struct {
     /*!< Extra RMT specific driver flags */
     struct led_strip_rmt_extra_config {
         uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t async_refresh: 1; /*!< Keep the channel enabled, queue refreshes and return at once, the corrected frames are double buffered (three times the pixel memory) */
     } flags;                    /*!< Extra driver flags */
+    led_strip_refresh_done_cb_t on_refresh_done; /*!< Called from ISR context when a frame has been transmitted, can be NULL */
+    void *user_ctx;             /*!< User context passed to `on_refresh_done` */
 } led_strip_rmt_config_t;
 
 /**
@@ -0,0 +1,73 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/spi_master.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief LED Strip SPI specific configuration
+ */
+typedef struct {
+    spi_clock_source_t clk_src; /*!< SPI clock source */
+    spi_host_device_t spi_bus;  /*!< SPI bus ID. Which buses are available depends on the specific chip */
+    struct {
+        uint32_t with_dma: 1;   /*!< Use DMA to transmit data */
+        uint32_t async_refresh: 1; /*!< Queue refreshes and return at once, the encoded pixels are double buffered (twice the memory) */
+        uint32_t stream_encode: 1; /*!< Keep raw colors (3 or 4 bytes per LED) and encode them into two small DMA chunks during refresh.
+                                        Refresh blocks until the frame is sent, can't be combined with `async_refresh`.
+                                        The chunks are separate transactions, see led_strip_spi_get_stream_gap() */
+    } flags;                    /*!< Extra driver flags */
+    uint32_t stream_chunk_leds; /*!< LEDs per DMA chunk with `flags.stream_encode`, 0 for the default (32).
+                                     Rounded up to whole words of encoded data, a multiple of 4 LEDs for RGB */
+    led_strip_refresh_done_cb_t on_refresh_done; /*!< Called from ISR context when a frame has been transmitted, can be NULL */
+    void *user_ctx;             /*!< User context passed to `on_refresh_done` */
+} led_strip_spi_config_t;
+
+/**
+ * @brief Create LED strip based on SPI MOSI channel
+ *
+ * @note Although only the MOSI line is used for generating the signal, the whole SPI bus can't be used for other purposes.
+ *
+ * @param led_config LED strip configuration
+ * @param spi_config SPI specific configuration
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_NOT_SUPPORTED: create LED strip handle failed because of unsupported configuration
+ *      - ESP_ERR_NO_MEM: create LED strip handle failed because of out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip);
+
+/**
+ * @brief Longest time the data line idled low between two chunks of a streamed frame
+ *
+ * @note Each chunk of a `flags.stream_encode` strip is its own SPI transaction and the line is low while the driver
+ *       starts the next one. A WS2812 latches after 50us of low (280us for newer revisions), some clones sooner, so check
+ *       this on the target against the LEDs in use. It is measured from the transaction callbacks and misses their
+ *       interrupt latency, read it as a lower bound. When the refreshing task is held off so long that a chunk ends before
+ *       the next is queued, the frame is sent again after a reset, and refresh returns ESP_ERR_TIMEOUT if that keeps happening.
+ *
+ * @param strip LED strip created by led_strip_new_spi_device() with `flags.stream_encode`
+ * @param max_gap_us Returned gap in microseconds, since the strip was created
+ * @return
+ *      - ESP_OK: the gap was returned
+ *      - ESP_ERR_INVALID_ARG: not an SPI strip, or NULL argument
+ *      - ESP_ERR_INVALID_STATE: the strip does not stream
+ */
+esp_err_t led_strip_spi_get_stream_gap(led_strip_handle_t strip, uint32_t *max_gap_us);
+
+#ifdef __cplusplus
+}
+#endif
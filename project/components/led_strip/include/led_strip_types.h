@@ -16,6 +16,45 @@ extern "C" {
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief RGB color of one pixel, used by the bulk pixel APIs
+ */
+typedef struct {
+    uint8_t r; /*!< Red component */
+    uint8_t g; /*!< Green component */
+    uint8_t b; /*!< Blue component */
+} led_strip_rgb_t;
+
+/**
+ * @brief Color correction of an LED strip, applied while the stored pixels are encoded
+ *
+ * @note Pixels are written as linear full-range colors. Each component goes through its gamma curve, then is scaled
+ *       by the white point and the global brightness. All three are fused into one lookup table per component.
+ */
+typedef struct {
+    uint8_t brightness;          /*!< Global brightness, 255 for full */
+    float gamma[4];              /*!< Gamma exponent of the red, green, blue and white components, 0 or 1.0 for linear */
+    led_strip_rgb_t white_point; /*!< Scale of the red, green and blue components to balance the LEDs, {255, 255, 255} for none */
+} led_strip_color_correction_t;
+
+/**
+ * @brief Refresh counters of an LED strip
+ */
+typedef struct {
+    uint32_t requested;   /*!< Calls to `led_strip_refresh` and `led_strip_clear` */
+    uint32_t transmitted; /*!< Frames actually sent to the strip, the rest were unchanged and skipped */
+} led_strip_refresh_stats_t;
+
+/**
+ * @brief Type of LED strip refresh done callback
+ *
+ * @note Called from ISR context once a frame has been transmitted, keep it short and only use ISR-safe APIs
+ *
+ * @param strip: LED strip whose frame was transmitted
+ * @param user_ctx: User context given in the backend configuration
+ */
+typedef void (*led_strip_refresh_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
 /**
  * @brief LED strip model
  * @note Different led model may have different timing parameters, so we need to distinguish them.
@@ -0,0 +1,211 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct led_strip_t led_strip_t; /*!< Type of LED strip */
+
+typedef struct led_strip_color_state_t led_strip_color_state_t; /*!< Color correction state, private to led_strip_api.c */
+
+/**
+ * @brief Color components, rows of the color correction table
+ */
+enum {
+    LED_STRIP_COMPONENT_R, /*!< Red */
+    LED_STRIP_COMPONENT_G, /*!< Green */
+    LED_STRIP_COMPONENT_B, /*!< Blue */
+    LED_STRIP_COMPONENT_W, /*!< White */
+};
+
+/**
+ * @brief LED strip interface definition
+ */
+struct led_strip_t {
+    /**
+     * @brief Set RGB for a specific pixel
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     *
+     * @return
+     *      - ESP_OK: Set RGB for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for a specific pixel failed because of invalid parameters
+     *      - ESP_FAIL: Set RGB for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
+
+    /**
+     * @brief Set RGBW for a specific pixel. Similar to `set_pixel` but also set the white component
+     *
+     * @param strip: LED strip
+     * @param index: index of pixel to set
+     * @param red: red part of color
+     * @param green: green part of color
+     * @param blue: blue part of color
+     * @param white: separate white component
+     *
+     * @return
+     *      - ESP_OK: Set RGBW color for a specific pixel successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGBW color for a specific pixel failed because of an invalid argument
+     *      - ESP_FAIL: Set RGBW color for a specific pixel failed because other error occurred
+     */
+    esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
+
+    /**
+     * @brief Set RGB for a run of consecutive pixels, optional (NULL falls back to `set_pixel` in a loop)
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel to set
+     * @param colors: colors of the pixels, `count` entries
+     * @param count: number of pixels to set
+     *
+     * @return
+     *      - ESP_OK: Set RGB for the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because of invalid parameters
+     *      - ESP_FAIL: Set RGB for the pixels failed because other error occurred
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count);
+
+    /**
+     * @brief Set a run of consecutive pixels to the same RGB color, optional (NULL falls back to `set_pixel` in a loop)
+     *
+     * @param strip: LED strip
+     * @param start: index of the first pixel to set
+     * @param count: number of pixels to set
+     * @param color: color of the pixels
+     *
+     * @return
+     *      - ESP_OK: Fill the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Fill the pixels failed because of invalid parameters
+     *      - ESP_FAIL: Fill the pixels failed because other error occurred
+     */
+    esp_err_t (*fill)(led_strip_t *strip, uint32_t start, uint32_t count, led_strip_rgb_t color);
+
+    /**
+     * @brief Refresh memory colors to LEDs
+     *
+     * @param strip: LED strip
+     * @param force: the frame has to go out even if no pixel changed (first frame, keep-alive), for strips that refresh
+     *               others through led_strip_refresh_output(); a backend transmits either way
+     *
+     * @return
+     *      - ESP_OK: Refresh successfully
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note:
+     *      After updating the LED colors in the memory, a following invocation of this API is needed to flush colors to strip.
+     */
+    esp_err_t (*refresh)(led_strip_t *strip, bool force);
+
+    /**
+     * @brief Wait for the last refresh to be transmitted, optional (NULL if the backend refreshes synchronously)
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: maximum time to wait in milliseconds, -1 to wait forever
+     *
+     * @return
+     *      - ESP_OK: No refresh is in flight any more
+     *      - ESP_ERR_TIMEOUT: The refresh is still being transmitted
+     *      - ESP_FAIL: Wait failed because some other error occurred
+     */
+    esp_err_t (*wait_refresh_done)(led_strip_t *strip, int timeout_ms);
+
+    /**
+     * @brief Clear LED strip (turn off all LEDs)
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: timeout value for clearing task
+     *
+     * @return
+     *      - ESP_OK: Clear LEDs successfully
+     *      - ESP_FAIL: Clear LEDs failed because some other error occurred
+     */
+    esp_err_t (*clear)(led_strip_t *strip);
+
+    /**
+     * @brief Set the color correction, optional (NULL to let backends apply `color_lut` to the stored pixels while encoding)
+     *
+     * @note For strips that don't encode pixels themselves but forward them, e.g. to other strips
+     *
+     * @param strip: LED strip
+     * @param correction: color correction, NULL to remove it
+     *
+     * @return
+     *      - ESP_OK: Set the color correction successfully
+     *      - ESP_ERR_NO_MEM: Set the color correction failed because of out of memory
+     *      - ESP_FAIL: Set the color correction failed because other error occurred
+     */
+    esp_err_t (*set_color_correction)(led_strip_t *strip, const led_strip_color_correction_t *correction);
+
+    /**
+     * @brief Free LED strip resources
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Free resources successfully
+     *      - ESP_FAIL: Free resources failed because error occurred
+     */
+    esp_err_t (*del)(led_strip_t *strip);
+
+    /* Frame bookkeeping of led_strip_api.c, backends set `dirty` when a write changes a pixel and leave the rest zeroed.
+       Backends store pixels as written and correct them with `color_lut` at refresh, so a new correction applies to all of them */
+    bool dirty;                      /*!< A pixel changed since the last transmitted frame */
+    bool synced;                     /*!< A frame has been transmitted, the strip shows the pixel buffer unless dirty */
+    uint32_t keep_alive_ms;          /*!< Resend an unchanged frame after this long, 0 to never resend */
+    int64_t last_tx_us;              /*!< When the last frame was transmitted */
+    led_strip_refresh_stats_t stats; /*!< Refresh counters */
+    led_strip_color_state_t *color;  /*!< Color correction settings and tables */
+    const uint8_t (*color_lut)[256]; /*!< Fused color correction per component, NULL when there is none to apply */
+};
+
+/**
+ * @brief Refresh a strip on behalf of another, e.g. an output of a multi strip, with the skipping of `led_strip_refresh`
+ *
+ * @param strip: LED strip
+ * @param force: send the frame even if no pixel changed, e.g. because the calling strip's keep-alive is due
+ *
+ * @return Same as `led_strip_refresh`
+ */
+esp_err_t led_strip_refresh_output(led_strip_t *strip, bool force);
+
+/**
+ * @brief Color correction table row of each byte of a pixel, for backends to correct stored pixels while they encode them
+ *
+ * @param strip: LED strip
+ * @param format: component order of the stored pixels
+ * @param rows: filled with the table row of each byte position of a pixel
+ *
+ * @return false if there is no correction to apply, the pixels are sent as they are
+ */
+static inline bool led_strip_color_rows(const led_strip_t *strip, led_color_component_format_t format, const uint8_t *rows[4])
+{
+    if (!strip->color_lut) {
+        return false;
+    }
+    rows[format.format.r_pos] = strip->color_lut[LED_STRIP_COMPONENT_R];
+    rows[format.format.g_pos] = strip->color_lut[LED_STRIP_COMPONENT_G];
+    rows[format.format.b_pos] = strip->color_lut[LED_STRIP_COMPONENT_B];
+    if (format.format.num_components > 3) {
+        rows[format.format.w_pos] = strip->color_lut[LED_STRIP_COMPONENT_W];
+    }
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
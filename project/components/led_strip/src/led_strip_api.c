@@ -0,0 +1,293 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+static const char *TAG = "led_strip";
+
+struct led_strip_color_state_t {
+    led_strip_color_correction_t correction;
+    bool curves_valid;
+    uint8_t curve[4][256]; // gamma curve per component, only rebuilt when its gamma changes
+    uint8_t lut[4][256];   // curves scaled by white point and brightness, what the backends apply
+};
+
+static inline bool led_strip_gamma_is_linear(float gamma)
+{
+    return gamma <= 0.0f || gamma == 1.0f;
+}
+
+static void led_strip_build_curve(uint8_t *curve, float gamma)
+{
+    for (int v = 0; v < 256; v++) {
+        curve[v] = led_strip_gamma_is_linear(gamma) ? v : (uint8_t)(powf(v / 255.0f, gamma) * 255.0f + 0.5f);
+    }
+}
+
+// fuse the curves with the white point and brightness, NULL when the result is the identity
+static const uint8_t (*led_strip_build_lut(led_strip_color_state_t *color))[256]
+{
+    const led_strip_color_correction_t *correction = &color->correction;
+    // brightness x white point, 255 * 255 is full scale
+    uint32_t scale[4] = {
+        correction->brightness * correction->white_point.r,
+        correction->brightness * correction->white_point.g,
+        correction->brightness * correction->white_point.b,
+        correction->brightness * 255,
+    };
+    bool identity = true;
+    for (int c = 0; c < 4; c++) {
+        identity &= scale[c] == 255 * 255 && led_strip_gamma_is_linear(correction->gamma[c]);
+    }
+    if (identity) {
+        return NULL;
+    }
+    for (int c = 0; c < 4; c++) {
+        for (int v = 0; v < 256; v++) {
+            color->lut[c][v] = (color->curve[c][v] * scale[c] + 255 * 255 / 2) / (255 * 255);
+        }
+    }
+    return (const uint8_t (*)[256])color->lut;
+}
+
+// the strip now shows the pixel buffer
+static void led_strip_frame_sent(led_strip_handle_t strip, int64_t now_us)
+{
+    strip->dirty = false;
+    strip->synced = true;
+    strip->last_tx_us = now_us;
+    strip->stats.transmitted++;
+}
+
+esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel(strip, index, red, green, blue);
+}
+
+esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    uint32_t red = 0;
+    uint32_t green = 0;
+    uint32_t blue = 0;
+
+    uint32_t rgb_max = value;
+    uint32_t rgb_min = rgb_max * (255 - saturation) / 255.0f;
+
+    uint32_t i = hue / 60;
+    uint32_t diff = hue % 60;
+
+    // RGB adjustment amount by hue
+    uint32_t rgb_adj = (rgb_max - rgb_min) * diff / 60;
+
+    switch (i) {
+    case 0:
+        red = rgb_max;
+        green = rgb_min + rgb_adj;
+        blue = rgb_min;
+        break;
+    case 1:
+        red = rgb_max - rgb_adj;
+        green = rgb_max;
+        blue = rgb_min;
+        break;
+    case 2:
+        red = rgb_min;
+        green = rgb_max;
+        blue = rgb_min + rgb_adj;
+        break;
+    case 3:
+        red = rgb_min;
+        green = rgb_max - rgb_adj;
+        blue = rgb_max;
+        break;
+    case 4:
+        red = rgb_min + rgb_adj;
+        green = rgb_min;
+        blue = rgb_max;
+        break;
+    default:
+        red = rgb_max;
+        green = rgb_min;
+        blue = rgb_max - rgb_adj;
+        break;
+    }
+
+    return strip->set_pixel(strip, index, red, green, blue);
+}
+
+esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    return strip->set_pixel_rgbw(strip, index, red, green, blue, white);
+}
+
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count)
+{
+    ESP_RETURN_ON_FALSE(strip && (colors || !count), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->set_pixels) {
+        return strip->set_pixels(strip, start, colors, count);
+    }
+    // fallback for backends without a native bulk write
+    for (uint32_t i = 0; i < count; i++) {
+        ESP_RETURN_ON_ERROR(strip->set_pixel(strip, start + i, colors[i].r, colors[i].g, colors[i].b), TAG, "set pixel failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_fill(led_strip_handle_t strip, uint32_t start, uint32_t count, led_strip_rgb_t color)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->fill) {
+        return strip->fill(strip, start, count, color);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ESP_RETURN_ON_ERROR(strip->set_pixel(strip, start + i, color.r, color.g, color.b), TAG, "set pixel failed");
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_refresh_output(led_strip_t *strip, bool force)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    strip->stats.requested++;
+    int64_t now_us = esp_timer_get_time();
+    bool keep_alive_due = strip->keep_alive_ms && now_us - strip->last_tx_us >= strip->keep_alive_ms * 1000LL;
+    force |= !strip->synced || keep_alive_due;
+    // no pixel changed since the last frame, the strip already shows it
+    if (!force && !strip->dirty) {
+        return ESP_OK;
+    }
+    esp_err_t ret = strip->refresh(strip, force);
+    if (ret == ESP_OK) {
+        led_strip_frame_sent(strip, now_us);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_refresh(led_strip_handle_t strip)
+{
+    return led_strip_refresh_output(strip, false);
+}
+
+// field by field, the struct has padding
+static bool led_strip_correction_equal(const led_strip_color_correction_t *a, const led_strip_color_correction_t *b)
+{
+    for (int c = 0; c < 4; c++) {
+        if (a->gamma[c] != b->gamma[c]) {
+            return false;
+        }
+    }
+    return a->brightness == b->brightness && a->white_point.r == b->white_point.r &&
+           a->white_point.g == b->white_point.g && a->white_point.b == b->white_point.b;
+}
+
+esp_err_t led_strip_set_color_correction(led_strip_handle_t strip, const led_strip_color_correction_t *correction)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (!correction) {
+        // the backends correct the stored pixels at refresh, so they are all sent again as written
+        strip->dirty |= strip->color_lut != NULL;
+        strip->color_lut = NULL;
+        free(strip->color);
+        strip->color = NULL;
+        return strip->set_color_correction ? strip->set_color_correction(strip, NULL) : ESP_OK;
+    }
+    if (!strip->color) {
+        strip->color = calloc(1, sizeof(led_strip_color_state_t));
+        ESP_RETURN_ON_FALSE(strip->color, ESP_ERR_NO_MEM, TAG, "no mem for color correction");
+    }
+    led_strip_color_state_t *color = strip->color;
+    // a forwarding strip only keeps the settings for led_strip_set_brightness
+    if (strip->set_color_correction) {
+        color->correction = *correction;
+        return strip->set_color_correction(strip, correction);
+    }
+    if (color->curves_valid && led_strip_correction_equal(&color->correction, correction)) {
+        return ESP_OK;
+    }
+    for (int c = 0; c < 4; c++) {
+        if (!color->curves_valid || color->correction.gamma[c] != correction->gamma[c]) {
+            led_strip_build_curve(color->curve[c], correction->gamma[c]);
+        }
+    }
+    color->curves_valid = true;
+    color->correction = *correction;
+    const uint8_t (*lut)[256] = led_strip_build_lut(color);
+    // every stored pixel shows differently from the next refresh, unless the identity stays the identity
+    strip->dirty |= lut || strip->color_lut;
+    strip->color_lut = lut;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_color_correction_t correction = {
+        .white_point = { 255, 255, 255 },
+    };
+    if (strip->color) {
+        correction = strip->color->correction;
+    }
+    correction.brightness = brightness;
+    // same gamma, so the cached curves are reused
+    return led_strip_set_color_correction(strip, &correction);
+}
+
+esp_err_t led_strip_set_keep_alive(led_strip_handle_t strip, uint32_t interval_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    strip->keep_alive_ms = interval_ms;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_get_refresh_stats(led_strip_handle_t strip, led_strip_refresh_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(strip && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    *stats = strip->stats;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_wait_refresh_done(led_strip_handle_t strip, int timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // synchronous backends have nothing in flight
+    if (!strip->wait_refresh_done) {
+        return ESP_OK;
+    }
+    return strip->wait_refresh_done(strip, timeout_ms);
+}
+
+esp_err_t led_strip_clear(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    strip->stats.requested++;
+    // clearing always transmits, the strip may show anything before
+    esp_err_t ret = strip->clear(strip);
+    if (ret == ESP_OK) {
+        led_strip_frame_sent(strip, esp_timer_get_time());
+    }
+    return ret;
+}
+
+esp_err_t led_strip_del(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // the backend frees the strip object, not the color state
+    led_strip_color_state_t *color = strip->color;
+    esp_err_t ret = strip->del(strip);
+    if (ret == ESP_OK) {
+        free(color);
+    }
+    return ret;
+}
@@ -0,0 +1,209 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+static const char *TAG = "led_strip_multi";
+
+typedef struct {
+    led_strip_t base;
+    uint32_t strip_len;
+    uint32_t num_segments;
+    led_strip_segment_t segments[LED_STRIP_MULTI_MAX_SEGMENTS];
+    uint32_t seg_start[LED_STRIP_MULTI_MAX_SEGMENTS];        // logical index of the first pixel of each segment
+    uint32_t num_outputs;
+    led_strip_handle_t outputs[LED_STRIP_MULTI_MAX_SEGMENTS]; // distinct physical strips, refreshed once per frame each
+} led_strip_multi_obj;
+
+// physical index of the pixel at position pos in a segment
+static inline uint32_t led_strip_multi_phys(const led_strip_segment_t *seg, uint32_t pos)
+{
+    return seg->reverse ? seg->offset + seg->length - 1 - pos : seg->offset + pos;
+}
+
+// the multi strip has a frame to send as soon as one of its outputs has
+static inline esp_err_t led_strip_multi_forwarded(led_strip_multi_obj *multi, led_strip_handle_t output, esp_err_t ret)
+{
+    multi->base.dirty |= output->dirty;
+    return ret;
+}
+
+// segment holding a logical pixel, index must be within the strip
+static const led_strip_segment_t *led_strip_multi_find(const led_strip_multi_obj *multi, uint32_t index, uint32_t *pos)
+{
+    uint32_t i = multi->num_segments - 1;
+    while (index < multi->seg_start[i]) {
+        i--;
+    }
+    *pos = index - multi->seg_start[i];
+    return &multi->segments[i];
+}
+
+static esp_err_t led_strip_multi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    ESP_RETURN_ON_FALSE(index < multi->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint32_t pos = 0;
+    const led_strip_segment_t *seg = led_strip_multi_find(multi, index, &pos);
+    return led_strip_multi_forwarded(multi, seg->strip, led_strip_set_pixel(seg->strip, led_strip_multi_phys(seg, pos), red, green, blue));
+}
+
+static esp_err_t led_strip_multi_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    ESP_RETURN_ON_FALSE(index < multi->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint32_t pos = 0;
+    const led_strip_segment_t *seg = led_strip_multi_find(multi, index, &pos);
+    return led_strip_multi_forwarded(multi, seg->strip, led_strip_set_pixel_rgbw(seg->strip, led_strip_multi_phys(seg, pos), red, green, blue, white));
+}
+
+static esp_err_t led_strip_multi_set_pixels(led_strip_t *strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= multi->strip_len && count <= multi->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+    uint32_t end = start + count;
+    for (uint32_t i = 0; i < multi->num_segments; i++) {
+        const led_strip_segment_t *seg = &multi->segments[i];
+        uint32_t seg_begin = multi->seg_start[i];
+        uint32_t seg_end = seg_begin + seg->length;
+        if (seg_end <= start || seg_begin >= end) {
+            continue;
+        }
+        uint32_t from = start > seg_begin ? start : seg_begin;
+        uint32_t to = end < seg_end ? end : seg_end;
+        const led_strip_rgb_t *src = &colors[from - start];
+        uint32_t pos = from - seg_begin;
+        if (!seg->reverse) {
+            ESP_RETURN_ON_ERROR(led_strip_multi_forwarded(multi, seg->strip, led_strip_set_pixels(seg->strip, seg->offset + pos, src, to - from)), TAG, "set segment pixels failed");
+            continue;
+        }
+        // a reversed segment takes the colors in the opposite order, one by one
+        for (uint32_t k = 0; k < to - from; k++) {
+            ESP_RETURN_ON_ERROR(led_strip_multi_forwarded(multi, seg->strip, led_strip_set_pixel(seg->strip, led_strip_multi_phys(seg, pos + k), src[k].r, src[k].g, src[k].b)), TAG, "set segment pixel failed");
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_fill(led_strip_t *strip, uint32_t start, uint32_t count, led_strip_rgb_t color)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= multi->strip_len && count <= multi->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+    uint32_t end = start + count;
+    for (uint32_t i = 0; i < multi->num_segments; i++) {
+        const led_strip_segment_t *seg = &multi->segments[i];
+        uint32_t seg_begin = multi->seg_start[i];
+        uint32_t seg_end = seg_begin + seg->length;
+        if (seg_end <= start || seg_begin >= end) {
+            continue;
+        }
+        uint32_t from = start > seg_begin ? start : seg_begin;
+        uint32_t to = end < seg_end ? end : seg_end;
+        // the run stays contiguous on the physical strip, reversed or not
+        uint32_t first = seg->reverse ? led_strip_multi_phys(seg, to - 1 - seg_begin) : led_strip_multi_phys(seg, from - seg_begin);
+        ESP_RETURN_ON_ERROR(led_strip_multi_forwarded(multi, seg->strip, led_strip_fill(seg->strip, first, to - from, color)), TAG, "fill segment failed");
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_refresh(led_strip_t *strip, bool force)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    // asynchronous outputs return once queued, so they all transmit at the same time;
+    // unchanged ones are skipped unless the multi strip's own first frame or keep-alive forces them
+    for (uint32_t i = 0; i < multi->num_outputs; i++) {
+        ESP_RETURN_ON_ERROR(led_strip_refresh_output(multi->outputs[i], force), TAG, "refresh output %"PRIu32" failed", i);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_wait_refresh_done(led_strip_t *strip, int timeout_ms)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    // the outputs run in parallel, by the time the slowest is done the others mostly are too
+    for (uint32_t i = 0; i < multi->num_outputs; i++) {
+        esp_err_t ret = led_strip_wait_refresh_done(multi->outputs[i], timeout_ms);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_clear(led_strip_t *strip)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    for (uint32_t i = 0; i < multi->num_outputs; i++) {
+        ESP_RETURN_ON_ERROR(led_strip_clear(multi->outputs[i]), TAG, "clear output %"PRIu32" failed", i);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_set_color_correction(led_strip_t *strip, const led_strip_color_correction_t *correction)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    // the outputs encode the pixels, so they apply the correction, and resend them if it changed
+    for (uint32_t i = 0; i < multi->num_outputs; i++) {
+        ESP_RETURN_ON_ERROR(led_strip_multi_forwarded(multi, multi->outputs[i], led_strip_set_color_correction(multi->outputs[i], correction)),
+                            TAG, "set color correction of output %"PRIu32" failed", i);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_multi_del(led_strip_t *strip)
+{
+    led_strip_multi_obj *multi = __containerof(strip, led_strip_multi_obj, base);
+    for (uint32_t i = 0; i < multi->num_outputs; i++) {
+        ESP_RETURN_ON_ERROR(led_strip_del(multi->outputs[i]), TAG, "delete output %"PRIu32" failed", i);
+    }
+    free(multi);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_multi(const led_strip_multi_config_t *config, led_strip_handle_t *ret_strip)
+{
+    ESP_RETURN_ON_FALSE(config && config->segments && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(config->num_segments > 0 && config->num_segments <= LED_STRIP_MULTI_MAX_SEGMENTS, ESP_ERR_INVALID_ARG, TAG,
+                        "invalid number of segments: %"PRIu32, config->num_segments);
+    led_strip_multi_obj *multi = calloc(1, sizeof(led_strip_multi_obj));
+    ESP_RETURN_ON_FALSE(multi, ESP_ERR_NO_MEM, TAG, "no mem for multi strip");
+
+    for (uint32_t i = 0; i < config->num_segments; i++) {
+        const led_strip_segment_t *seg = &config->segments[i];
+        if (!seg->strip || !seg->length) {
+            free(multi);
+            ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid segment %"PRIu32, i);
+        }
+        multi->segments[i] = *seg;
+        multi->seg_start[i] = multi->strip_len;
+        multi->strip_len += seg->length;
+        // several segments can share one physical strip, it is still refreshed once
+        uint32_t k = 0;
+        while (k < multi->num_outputs && multi->outputs[k] != seg->strip) {
+            k++;
+        }
+        if (k == multi->num_outputs) {
+            multi->outputs[multi->num_outputs++] = seg->strip;
+        }
+    }
+    multi->num_segments = config->num_segments;
+    multi->base.set_pixel = led_strip_multi_set_pixel;
+    multi->base.set_pixel_rgbw = led_strip_multi_set_pixel_rgbw;
+    multi->base.set_pixels = led_strip_multi_set_pixels;
+    multi->base.fill = led_strip_multi_fill;
+    multi->base.refresh = led_strip_multi_refresh;
+    multi->base.wait_refresh_done = led_strip_multi_wait_refresh_done;
+    multi->base.clear = led_strip_multi_clear;
+    multi->base.set_color_correction = led_strip_multi_set_color_correction;
+    multi->base.del = led_strip_multi_del;
+
+    *ret_strip = &multi->base;
+    return ESP_OK;
+}
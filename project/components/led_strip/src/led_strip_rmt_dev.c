@@ -0,0 +1,354 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "driver/rmt_tx.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+#include "led_strip_rmt_encoder.h"
+
+#define LED_STRIP_RMT_DEFAULT_RESOLUTION 10000000 // 10MHz resolution
+#define LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE 4
+// the memory size of each RMT channel, in words (4 bytes)
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 64
+#else
+#define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 48
+#endif
+
+static const char *TAG = "led_strip_rmt";
+
+typedef struct {
+    led_strip_t base;
+    rmt_channel_handle_t rmt_chan;
+    rmt_encoder_handle_t strip_encoder;
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    led_color_component_format_t component_fmt;
+    led_strip_refresh_done_cb_t on_refresh_done;
+    void *user_ctx;
+    bool async;                   // channel stays enabled and refresh returns once the frame is queued
+    uint32_t frames_queued;       // transmissions queued by an async refresh
+    volatile uint32_t frames_done; // of them, those the channel reported done
+    uint8_t *pixel_buf;           // colors as written by set_pixel, corrected at refresh
+    uint8_t *tx_buf[2];           // corrected frames the encoder reads: both in pixel_mem in async mode, else the first is allocated once a correction is set
+    uint8_t tx_next;              // tx_buf corrected next, async mode alternates so the encoder keeps reading the other one
+    uint8_t pixel_mem[];
+} led_strip_rmt_obj;
+
+// one pixel as it is stored in pixel_buf, the white component is only written on strips that have it
+static inline void led_strip_rmt_pack_pixel(led_strip_rmt_obj *rmt_strip, uint8_t *pixel, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_color_component_format_t component_fmt = rmt_strip->component_fmt;
+    pixel[component_fmt.format.r_pos] = red & 0xFF;
+    pixel[component_fmt.format.g_pos] = green & 0xFF;
+    pixel[component_fmt.format.b_pos] = blue & 0xFF;
+    if (component_fmt.format.num_components > 3) {
+        pixel[component_fmt.format.w_pos] = white & 0xFF;
+    }
+}
+
+// the frame to send, pixel_buf through the color correction
+static void led_strip_rmt_correct(led_strip_rmt_obj *rmt_strip, uint8_t *dst)
+{
+    const uint8_t *src = rmt_strip->pixel_buf;
+    uint32_t bytes_per_pixel = rmt_strip->bytes_per_pixel;
+    const uint8_t *rows[4];
+    if (!led_strip_color_rows(&rmt_strip->base, rmt_strip->component_fmt, rows)) {
+        memcpy(dst, src, rmt_strip->strip_len * bytes_per_pixel);
+        return;
+    }
+    for (uint32_t i = 0; i < rmt_strip->strip_len; i++) {
+        for (uint32_t c = 0; c < bytes_per_pixel; c++) {
+            dst[c] = rows[c][src[c]];
+        }
+        src += bytes_per_pixel;
+        dst += bytes_per_pixel;
+    }
+}
+
+// the strip only has a new frame to send if the pixel differs from the one stored
+static inline void led_strip_rmt_store_pixel(led_strip_rmt_obj *rmt_strip, uint8_t *buf, const uint8_t *pixel)
+{
+    if (memcmp(buf, pixel, rmt_strip->bytes_per_pixel)) {
+        memcpy(buf, pixel, rmt_strip->bytes_per_pixel);
+        rmt_strip->base.dirty = true;
+    }
+}
+
+static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+
+    uint8_t pixel[4];
+    led_strip_rmt_pack_pixel(rmt_strip, pixel, red, green, blue, 0);
+    led_strip_rmt_store_pixel(rmt_strip, &rmt_strip->pixel_buf[index * rmt_strip->bytes_per_pixel], pixel);
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(index < rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(rmt_strip->component_fmt.format.num_components == 4, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    uint8_t pixel[4];
+    led_strip_rmt_pack_pixel(rmt_strip, pixel, red, green, blue, white);
+    led_strip_rmt_store_pixel(rmt_strip, &rmt_strip->pixel_buf[index * rmt_strip->bytes_per_pixel], pixel);
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(start <= rmt_strip->strip_len && count <= rmt_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+
+    uint8_t *buf = &rmt_strip->pixel_buf[start * rmt_strip->bytes_per_pixel];
+    uint8_t pixel[4];
+    for (uint32_t i = 0; i < count; i++) {
+        led_strip_rmt_pack_pixel(rmt_strip, pixel, colors[i].r, colors[i].g, colors[i].b, 0);
+        led_strip_rmt_store_pixel(rmt_strip, buf, pixel);
+        buf += rmt_strip->bytes_per_pixel;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_fill(led_strip_t *strip, uint32_t start, uint32_t count, led_strip_rgb_t color)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(start <= rmt_strip->strip_len && count <= rmt_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+    uint8_t *buf = &rmt_strip->pixel_buf[start * rmt_strip->bytes_per_pixel];
+    uint8_t pixel[4];
+    led_strip_rmt_pack_pixel(rmt_strip, pixel, color.r, color.g, color.b, 0);
+    uint32_t total = count * rmt_strip->bytes_per_pixel;
+    uint32_t done = 0;
+    // a run that already has the color leaves the strip clean
+    while (done < total && !memcmp(buf + done, pixel, rmt_strip->bytes_per_pixel)) {
+        done += rmt_strip->bytes_per_pixel;
+    }
+    if (done == total) {
+        return ESP_OK;
+    }
+    rmt_strip->base.dirty = true;
+    // store the first pixel only, then double the filled run with each copy
+    memcpy(buf, pixel, rmt_strip->bytes_per_pixel);
+    done = rmt_strip->bytes_per_pixel;
+    while (done < total) {
+        uint32_t len = done < total - done ? done : total - done;
+        memcpy(buf + done, buf, len);
+        done += len;
+    }
+
+    return ESP_OK;
+}
+
+static bool IRAM_ATTR led_strip_rmt_trans_done_cb(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    rmt_strip->frames_done++;
+    if (rmt_strip->on_refresh_done) {
+        rmt_strip->on_refresh_done(&rmt_strip->base, rmt_strip->user_ctx);
+    }
+    return false;
+}
+
+static esp_err_t led_strip_rmt_wait_refresh_done(led_strip_t *strip, int timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (!rmt_strip->async || rmt_strip->frames_done == rmt_strip->frames_queued) {
+        return ESP_OK;
+    }
+    // no log here, polling with a zero timeout is expected to time out
+    esp_err_t ret = rmt_tx_wait_all_done(rmt_strip->rmt_chan, timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // nothing is in flight any more, whether or not the done callback has run yet
+    rmt_strip->frames_done = rmt_strip->frames_queued;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip, bool force)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    rmt_transmit_config_t tx_conf = {
+        .loop_count = 0,
+    };
+    uint32_t frame_size = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+
+    if (rmt_strip->async) {
+        // the previous frame may stay on the wire, only the one before it read the buffer corrected now; the
+        // driver can't wait for a single transmission, so a render loop ahead of the wire waits for both
+        if (rmt_strip->frames_queued - rmt_strip->frames_done > 1) {
+            ESP_RETURN_ON_ERROR(led_strip_rmt_wait_refresh_done(strip, -1), TAG, "wait for previous frames failed");
+        }
+        uint8_t *tx_buf = rmt_strip->tx_buf[rmt_strip->tx_next];
+        led_strip_rmt_correct(rmt_strip, tx_buf);
+        ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, tx_buf, frame_size, &tx_conf), TAG, "transmit pixels by RMT failed");
+        rmt_strip->frames_queued++;
+        rmt_strip->tx_next ^= 1;
+        return ESP_OK;
+    }
+
+    // the frame is sent before refresh returns, so without a correction the pixels go out as they are stored
+    const uint8_t *frame = rmt_strip->pixel_buf;
+    if (rmt_strip->base.color_lut) {
+        if (!rmt_strip->tx_buf[0]) {
+            rmt_strip->tx_buf[0] = malloc(frame_size);
+            ESP_RETURN_ON_FALSE(rmt_strip->tx_buf[0], ESP_ERR_NO_MEM, TAG, "no mem for corrected frame");
+        }
+        led_strip_rmt_correct(rmt_strip, rmt_strip->tx_buf[0]);
+        frame = rmt_strip->tx_buf[0];
+    }
+    ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, frame,
+                                     frame_size, &tx_conf), TAG, "transmit pixels by RMT failed");
+    ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    // Write zero to turn off all leds
+    memset(rmt_strip->pixel_buf, 0, rmt_strip->strip_len * rmt_strip->bytes_per_pixel);
+    return led_strip_rmt_refresh(strip, true);
+}
+
+static esp_err_t led_strip_rmt_del(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (rmt_strip->async) {
+        // the encoder must be done with the pixels before they are freed, and a channel is deleted disabled
+        ESP_RETURN_ON_ERROR(led_strip_rmt_wait_refresh_done(strip, -1), TAG, "wait for last frame failed");
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    }
+    ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
+    ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
+    if (!rmt_strip->async) {
+        free(rmt_strip->tx_buf[0]);
+    }
+    free(rmt_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_rmt_obj *rmt_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    led_color_component_format_t component_fmt = led_config->color_component_format;
+    // If R/G/B order is not specified, set default GRB order as fallback
+    if (component_fmt.format_id == 0) {
+        component_fmt = LED_STRIP_COLOR_COMPONENT_FMT_GRB;
+    }
+    // check the validation of the color component format
+    uint8_t mask = 0;
+    if (component_fmt.format.num_components == 3) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x07, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else if (component_fmt.format.num_components == 4) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos) | BIT(component_fmt.format.w_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x0F, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else {
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
+    }
+    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    uint32_t frame_size = led_config->max_leds * bytes_per_pixel;
+    // pixels are kept as written and corrected into the frame the encoder reads, so a new color correction applies
+    // to all of them; in async mode two corrected frames alternate so a new one is queued behind the one on the wire
+    uint32_t num_tx_bufs = rmt_config->flags.async_refresh ? 2 : 0;
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + frame_size * (1 + num_tx_bufs));
+    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = rmt_strip->pixel_mem;
+    for (uint32_t i = 0; i < num_tx_bufs; i++) {
+        rmt_strip->tx_buf[i] = rmt_strip->pixel_mem + frame_size * (1 + i);
+    }
+    uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
+
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    rmt_clock_source_t clk_src = RMT_CLK_SRC_DEFAULT;
+    if (rmt_config->clk_src) {
+        clk_src = rmt_config->clk_src;
+    }
+    size_t mem_block_symbols = LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS;
+    // override the default value if the user sets it
+    if (rmt_config->mem_block_symbols) {
+        mem_block_symbols = rmt_config->mem_block_symbols;
+    }
+    rmt_tx_channel_config_t rmt_chan_config = {
+        .clk_src = clk_src,
+        .gpio_num = led_config->strip_gpio_num,
+        .mem_block_symbols = mem_block_symbols,
+        .resolution_hz = resolution,
+        .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
+        .flags.with_dma = rmt_config->flags.with_dma,
+        .flags.invert_out = led_config->flags.invert_out,
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
+
+    led_strip_encoder_config_t strip_encoder_conf = {
+        .resolution = resolution,
+        .led_model = led_config->led_model
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+
+    rmt_strip->on_refresh_done = rmt_config->on_refresh_done;
+    rmt_strip->user_ctx = rmt_config->user_ctx;
+    // async refresh counts the frames that are done to know which buffer the encoder still reads
+    if (rmt_config->on_refresh_done || rmt_config->flags.async_refresh) {
+        rmt_tx_event_callbacks_t cbs = {
+            .on_trans_done = led_strip_rmt_trans_done_cb,
+        };
+        ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register RMT callbacks failed");
+    }
+    if (rmt_config->flags.async_refresh) {
+        // enabled once here instead of around every frame
+        ESP_GOTO_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), err, TAG, "enable RMT channel failed");
+        rmt_strip->async = true;
+    }
+
+    rmt_strip->component_fmt = component_fmt;
+    rmt_strip->bytes_per_pixel = bytes_per_pixel;
+    rmt_strip->strip_len = led_config->max_leds;
+    rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
+    rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
+    rmt_strip->base.fill = led_strip_rmt_fill;
+    rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.wait_refresh_done = led_strip_rmt_wait_refresh_done;
+    rmt_strip->base.clear = led_strip_rmt_clear;
+    rmt_strip->base.del = led_strip_rmt_del;
+
+    *ret_strip = &rmt_strip->base;
+    return ESP_OK;
+err:
+    if (rmt_strip) {
+        if (rmt_strip->rmt_chan) {
+            if (rmt_strip->async) {
+                rmt_disable(rmt_strip->rmt_chan);
+            }
+            rmt_del_channel(rmt_strip->rmt_chan);
+        }
+        if (rmt_strip->strip_encoder) {
+            rmt_del_encoder(rmt_strip->strip_encoder);
+        }
+        free(rmt_strip);
+    }
+    return ret;
+}
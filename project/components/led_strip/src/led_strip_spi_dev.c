@@ -0,0 +1,537 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/cdefs.h>
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_rom_gpio.h"
+#include "esp_rom_sys.h"
+#include "esp_timer.h"
+#include "soc/spi_periph.h"
+#include "led_strip.h"
+#include "led_strip_interface.h"
+
+#define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
+#define LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE 4
+#define LED_STRIP_SPI_DEFAULT_STREAM_CHUNK_LEDS 32 // 922us on the wire for RGB, the time left to encode the next chunk
+// spi_master copies a DMA buffer whose address or length is not word aligned into a temporary allocation on every transaction
+#define LED_STRIP_SPI_DMA_ALIGN 4
+#define LED_STRIP_SPI_RESET_US 280        // low time that latches any WS2812 variant, so a resent frame starts at the first LED
+#define LED_STRIP_SPI_STREAM_ATTEMPTS 3   // sends of a streamed frame before an underrun is reported
+
+#define SPI_BYTES_PER_COLOR_BYTE 3
+#define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
+
+static const char *TAG = "led_strip_spi";
+
+typedef struct {
+    led_strip_t base;
+    spi_host_device_t spi_host;
+    spi_device_handle_t spi_device;
+    uint32_t strip_len;
+    uint8_t bytes_per_pixel;
+    uint32_t buf_size;       // bytes per encoded frame buffer, the frame rounded up to LED_STRIP_SPI_DMA_ALIGN
+    bool stream;             // no frame buffer, pixel_buf is encoded chunk by chunk during refresh
+    led_color_component_format_t component_fmt;
+    uint32_t chunk_leds;     // LEDs per DMA chunk in stream mode
+    uint8_t *chunk_buf[2];   // ping-pong DMA chunks in stream mode, both in chunk_mem
+    uint8_t *chunk_mem;
+    spi_transaction_t chunk_trans[2];
+    uint32_t chunks_total;   // chunks of the frame being streamed
+    uint32_t chunks_queued;  // of those, handed to the driver
+    volatile uint32_t chunks_done;    // of those, sent, counted in post_cb
+    volatile bool underrun;           // a chunk ended before the next one was queued, the line idled mid-frame
+    volatile int64_t chunk_end_us;    // when the last chunk ended
+    volatile uint32_t max_gap_us;     // longest idle between two chunks of a frame seen so far
+    led_strip_refresh_done_cb_t on_refresh_done;
+    void *user_ctx;
+    spi_transaction_t trans; // transaction of the frame being transmitted in async mode
+    bool trans_pending;      // `trans` is queued and its result has not been collected yet
+    uint8_t *pixel_buf;      // colors as written by set_pixel, corrected and encoded at refresh, only read by the CPU
+    uint8_t *tx_buf[2];      // encoded frames DMA reads, both in pixel_mem, the second one only in async mode
+    uint8_t tx_next;         // tx_buf encoded next, async mode alternates so DMA keeps reading the other one
+    uint8_t pixel_mem[] WORD_ALIGNED_ATTR;
+} led_strip_spi_obj;
+
+// Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110, MSB first
+// So a color byte occupies 3 bytes of SPI, the table holds the 3 bytes for every color value
+#define LED_STRIP_SPI_BIT_PATTERN(v, n) ((0x04u | ((((v) >> (n)) & 0x01u) << 1)) << (3 * (n)))
+#define LED_STRIP_SPI_PATTERN(v) (LED_STRIP_SPI_BIT_PATTERN(v, 0) | LED_STRIP_SPI_BIT_PATTERN(v, 1) | LED_STRIP_SPI_BIT_PATTERN(v, 2) | \
+                                  LED_STRIP_SPI_BIT_PATTERN(v, 3) | LED_STRIP_SPI_BIT_PATTERN(v, 4) | LED_STRIP_SPI_BIT_PATTERN(v, 5) | \
+                                  LED_STRIP_SPI_BIT_PATTERN(v, 6) | LED_STRIP_SPI_BIT_PATTERN(v, 7))
+#define LED_STRIP_SPI_ENCODE(v) { (LED_STRIP_SPI_PATTERN(v) >> 16) & 0xFF, (LED_STRIP_SPI_PATTERN(v) >> 8) & 0xFF, LED_STRIP_SPI_PATTERN(v) & 0xFF }
+#define LED_STRIP_SPI_ENCODE_4(v) LED_STRIP_SPI_ENCODE(v), LED_STRIP_SPI_ENCODE((v) + 1), LED_STRIP_SPI_ENCODE((v) + 2), LED_STRIP_SPI_ENCODE((v) + 3)
+#define LED_STRIP_SPI_ENCODE_16(v) LED_STRIP_SPI_ENCODE_4(v), LED_STRIP_SPI_ENCODE_4((v) + 4), LED_STRIP_SPI_ENCODE_4((v) + 8), LED_STRIP_SPI_ENCODE_4((v) + 12)
+#define LED_STRIP_SPI_ENCODE_64(v) LED_STRIP_SPI_ENCODE_16(v), LED_STRIP_SPI_ENCODE_16((v) + 16), LED_STRIP_SPI_ENCODE_16((v) + 32), LED_STRIP_SPI_ENCODE_16((v) + 48)
+
+static const uint8_t led_strip_spi_encode_table[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    LED_STRIP_SPI_ENCODE_64(0), LED_STRIP_SPI_ENCODE_64(64), LED_STRIP_SPI_ENCODE_64(128), LED_STRIP_SPI_ENCODE_64(192),
+};
+
+static inline void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
+{
+    const uint8_t *pattern = led_strip_spi_encode_table[data];
+    buf[0] = pattern[0];
+    buf[1] = pattern[1];
+    buf[2] = pattern[2];
+}
+
+// correct and encode `count` pixels of pixel_buf, the color correction costs one more table lookup per component
+static void led_strip_spi_encode(led_strip_spi_obj *spi_strip, uint8_t *dst, const uint8_t *src, uint32_t count)
+{
+    uint32_t bytes_per_pixel = spi_strip->bytes_per_pixel;
+    const uint8_t *rows[4];
+    if (!led_strip_color_rows(&spi_strip->base, spi_strip->component_fmt, rows)) {
+        for (uint32_t i = 0; i < count * bytes_per_pixel; i++) {
+            __led_strip_spi_bit(src[i], dst);
+            dst += SPI_BYTES_PER_COLOR_BYTE;
+        }
+        return;
+    }
+    if (bytes_per_pixel == 3) {
+        // the common RGB strip, with the rows in registers
+        const uint8_t *row0 = rows[0], *row1 = rows[1], *row2 = rows[2];
+        for (uint32_t i = 0; i < count; i++) {
+            __led_strip_spi_bit(row0[src[0]], dst);
+            __led_strip_spi_bit(row1[src[1]], dst + SPI_BYTES_PER_COLOR_BYTE);
+            __led_strip_spi_bit(row2[src[2]], dst + 2 * SPI_BYTES_PER_COLOR_BYTE);
+            src += 3;
+            dst += 3 * SPI_BYTES_PER_COLOR_BYTE;
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t c = 0; c < bytes_per_pixel; c++) {
+            __led_strip_spi_bit(rows[c][src[c]], dst);
+            dst += SPI_BYTES_PER_COLOR_BYTE;
+        }
+        src += bytes_per_pixel;
+    }
+}
+
+// one pixel in the strip's component order, the white component is only written on strips that have it
+static inline void led_strip_spi_pack_pixel(led_strip_spi_obj *spi_strip, uint8_t *pixel, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_color_component_format_t component_fmt = spi_strip->component_fmt;
+    pixel[component_fmt.format.r_pos] = red & 0xFF;
+    pixel[component_fmt.format.g_pos] = green & 0xFF;
+    pixel[component_fmt.format.b_pos] = blue & 0xFF;
+    if (component_fmt.format.num_components > 3) {
+        pixel[component_fmt.format.w_pos] = white & 0xFF;
+    }
+}
+
+// the strip only has a new frame to send if the pixel differs from the one stored
+static inline void led_strip_spi_store_pixel(led_strip_spi_obj *spi_strip, uint8_t *buf, const uint8_t *pixel)
+{
+    if (memcmp(buf, pixel, spi_strip->bytes_per_pixel)) {
+        memcpy(buf, pixel, spi_strip->bytes_per_pixel);
+        spi_strip->base.dirty = true;
+    }
+}
+
+static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    uint32_t start = index * spi_strip->bytes_per_pixel;
+    uint8_t pixel[4];
+    led_strip_spi_pack_pixel(spi_strip, pixel, red, green, blue, 0);
+    led_strip_spi_store_pixel(spi_strip, &spi_strip->pixel_buf[start], pixel);
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
+    ESP_RETURN_ON_FALSE(spi_strip->component_fmt.format.num_components == 4, ESP_ERR_INVALID_ARG, TAG, "led doesn't have 4 components");
+
+    uint32_t start = index * spi_strip->bytes_per_pixel;
+    uint8_t pixel[4];
+    led_strip_spi_pack_pixel(spi_strip, pixel, red, green, blue, white);
+    led_strip_spi_store_pixel(spi_strip, &spi_strip->pixel_buf[start], pixel);
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, uint32_t start, const led_strip_rgb_t *colors, uint32_t count)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+    uint32_t pixel_size = spi_strip->bytes_per_pixel;
+    uint8_t *buf = &spi_strip->pixel_buf[start * pixel_size];
+    uint8_t pixel[4];
+    for (uint32_t i = 0; i < count; i++) {
+        led_strip_spi_pack_pixel(spi_strip, pixel, colors[i].r, colors[i].g, colors[i].b, 0);
+        led_strip_spi_store_pixel(spi_strip, buf, pixel);
+        buf += pixel_size;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_fill(led_strip_t *strip, uint32_t start, uint32_t count, led_strip_rgb_t color)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(start <= spi_strip->strip_len && count <= spi_strip->strip_len - start, ESP_ERR_INVALID_ARG, TAG, "pixels out of maximum number of LEDs");
+    if (!count) {
+        return ESP_OK;
+    }
+    uint32_t pixel_size = spi_strip->bytes_per_pixel;
+    uint8_t *buf = &spi_strip->pixel_buf[start * pixel_size];
+    uint8_t pixel[4];
+    led_strip_spi_pack_pixel(spi_strip, pixel, color.r, color.g, color.b, 0);
+    uint32_t total = count * pixel_size;
+    uint32_t done = 0;
+    // a run that already has the color leaves the strip clean
+    while (done < total && !memcmp(buf + done, pixel, pixel_size)) {
+        done += pixel_size;
+    }
+    if (done == total) {
+        return ESP_OK;
+    }
+    spi_strip->base.dirty = true;
+    // store the first pixel only, then double the filled run with each copy
+    memcpy(buf, pixel, pixel_size);
+    done = pixel_size;
+    while (done < total) {
+        uint32_t len = done < total - done ? done : total - done;
+        memcpy(buf + done, buf, len);
+        done += len;
+    }
+
+    return ESP_OK;
+}
+
+static void IRAM_ATTR led_strip_spi_pre_cb(spi_transaction_t *trans)
+{
+    led_strip_spi_obj *spi_strip = (led_strip_spi_obj *)trans->user;
+    // the line has been low since the previous chunk ended, this misses the interrupt latency around the callbacks
+    if (spi_strip->chunks_done) {
+        uint32_t gap_us = esp_timer_get_time() - spi_strip->chunk_end_us;
+        if (gap_us > spi_strip->max_gap_us) {
+            spi_strip->max_gap_us = gap_us;
+        }
+    }
+}
+
+static void IRAM_ATTR led_strip_spi_post_cb(spi_transaction_t *trans)
+{
+    led_strip_spi_obj *spi_strip = (led_strip_spi_obj *)trans->user;
+    if (spi_strip->stream) {
+        spi_strip->chunk_end_us = esp_timer_get_time();
+        if (++spi_strip->chunks_done < spi_strip->chunks_total) {
+            // the next chunk has to be queued by now, or the line stays low until it is
+            if (spi_strip->chunks_done == spi_strip->chunks_queued) {
+                spi_strip->underrun = true;
+            }
+            return;
+        }
+    }
+    if (spi_strip->on_refresh_done) {
+        spi_strip->on_refresh_done(&spi_strip->base, spi_strip->user_ctx);
+    }
+}
+
+static esp_err_t led_strip_spi_wait_refresh_done(led_strip_t *strip, int timeout_ms)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    if (!spi_strip->trans_pending) {
+        return ESP_OK;
+    }
+    spi_transaction_t *trans_done = NULL;
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    // no log here, polling with a zero timeout is expected to time out
+    esp_err_t ret = spi_device_get_trans_result(spi_strip->spi_device, &trans_done, ticks);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    spi_strip->trans_pending = false;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_stream_frame(led_strip_spi_obj *spi_strip)
+{
+    esp_err_t ret = ESP_OK;
+    uint32_t frame_size = spi_strip->strip_len * spi_strip->bytes_per_pixel;
+    uint32_t chunk_size = spi_strip->chunk_leds * spi_strip->bytes_per_pixel;
+    uint32_t offset = 0;
+    int in_flight = 0;
+    int next = 0;
+    spi_transaction_t *trans_done = NULL;
+    spi_strip->chunks_total = (frame_size + chunk_size - 1) / chunk_size;
+    spi_strip->chunks_queued = 0;
+    spi_strip->chunks_done = 0;
+    spi_strip->underrun = false;
+    // keep two chunks queued, the next one is encoded while the driver sends the other
+    while (offset < frame_size || in_flight) {
+        if (offset < frame_size && in_flight < 2) {
+            uint32_t len = frame_size - offset < chunk_size ? frame_size - offset : chunk_size;
+            // chunks hold whole pixels, so each starts at the first component
+            led_strip_spi_encode(spi_strip, spi_strip->chunk_buf[next], &spi_strip->pixel_buf[offset], len / spi_strip->bytes_per_pixel);
+            offset += len;
+            // only the last chunk can be short, its zero padding just starts the reset time
+            uint32_t tx_len = len * SPI_BYTES_PER_COLOR_BYTE;
+            while (tx_len % LED_STRIP_SPI_DMA_ALIGN) {
+                spi_strip->chunk_buf[next][tx_len++] = 0;
+            }
+            spi_transaction_t *trans = &spi_strip->chunk_trans[next];
+            memset(trans, 0, sizeof(spi_transaction_t));
+            trans->length = tx_len * 8;
+            trans->tx_buffer = spi_strip->chunk_buf[next];
+            trans->user = spi_strip;
+            ESP_GOTO_ON_ERROR(spi_device_queue_trans(spi_strip->spi_device, trans, portMAX_DELAY), drain, TAG, "queue pixels by SPI failed");
+            // counted once queued, a chunk that ends in between is taken for an underrun, which errs on the safe side
+            spi_strip->chunks_queued++;
+            in_flight++;
+            next ^= 1;
+            continue;
+        }
+        // results come back in order, so this frees the chunk buffer encoded next
+        ESP_GOTO_ON_ERROR(spi_device_get_trans_result(spi_strip->spi_device, &trans_done, portMAX_DELAY), drain, TAG, "transmit pixels by SPI failed");
+        in_flight--;
+    }
+
+    return ESP_OK;
+drain:
+    // the driver still owns the queued chunks, collect them before their buffers are encoded again
+    while (in_flight && spi_device_get_trans_result(spi_strip->spi_device, &trans_done, portMAX_DELAY) == ESP_OK) {
+        in_flight--;
+    }
+    return ret;
+}
+
+// each chunk is a transaction of its own, the line is low while the driver starts the next one (see led_strip_spi_get_stream_gap)
+static esp_err_t led_strip_spi_stream_refresh(led_strip_spi_obj *spi_strip)
+{
+    for (int attempt = 1; ; attempt++) {
+        ESP_RETURN_ON_ERROR(led_strip_spi_stream_frame(spi_strip), TAG, "stream frame failed");
+        if (!spi_strip->underrun) {
+            return ESP_OK;
+        }
+        // the LEDs may have latched part of the frame, send it again from the start
+        ESP_RETURN_ON_FALSE(attempt < LED_STRIP_SPI_STREAM_ATTEMPTS, ESP_ERR_TIMEOUT, TAG, "chunks not queued in time, frame cut short");
+        ESP_LOGW(TAG, "chunks not queued in time, resending frame");
+        esp_rom_delay_us(LED_STRIP_SPI_RESET_US);
+    }
+}
+
+static esp_err_t led_strip_spi_refresh(led_strip_t *strip, bool force)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    if (spi_strip->stream) {
+        return led_strip_spi_stream_refresh(spi_strip);
+    }
+    uint8_t *tx_buf = spi_strip->tx_buf[spi_strip->tx_next];
+    // in async mode DMA may still read the other buffer, so this one is encoded while the previous frame is on the wire
+    led_strip_spi_encode(spi_strip, tx_buf, spi_strip->pixel_buf, spi_strip->strip_len);
+    spi_transaction_t tx_conf;
+    memset(&tx_conf, 0, sizeof(tx_conf));
+
+    // the padding is zero, it only lengthens the low reset time after the frame
+    tx_conf.length = spi_strip->buf_size * 8;
+    tx_conf.tx_buffer = tx_buf;
+    tx_conf.rx_buffer = NULL;
+    tx_conf.user = spi_strip;
+    if (!spi_strip->tx_buf[1]) {
+        ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+        return ESP_OK;
+    }
+
+    // only one frame in flight, once it is collected its buffer is encoded next
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_refresh_done(strip, -1), TAG, "wait for previous frame failed");
+    spi_strip->trans = tx_conf;
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(spi_strip->spi_device, &spi_strip->trans, portMAX_DELAY), TAG, "queue pixels by SPI failed");
+    spi_strip->trans_pending = true;
+    spi_strip->tx_next ^= 1;
+
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_spi_clear(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    //Write zero to turn off all leds, white included
+    ESP_RETURN_ON_ERROR(led_strip_spi_fill(strip, 0, spi_strip->strip_len, (led_strip_rgb_t) {0}), TAG, "clear pixels failed");
+
+    return led_strip_spi_refresh(strip, true);
+}
+
+static esp_err_t led_strip_spi_del(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+
+    // DMA must be done with the buffers before they are freed
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_refresh_done(strip, -1), TAG, "wait for last frame failed");
+    ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
+    ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
+
+    free(spi_strip->chunk_mem);
+    free(spi_strip->pixel_buf);
+    free(spi_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_spi_get_stream_gap(led_strip_handle_t strip, uint32_t *max_gap_us)
+{
+    ESP_RETURN_ON_FALSE(strip && max_gap_us && strip->refresh == led_strip_spi_refresh, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(spi_strip->stream, ESP_ERR_INVALID_STATE, TAG, "not a streamed strip");
+    *max_gap_us = spi_strip->max_gap_us;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const led_strip_spi_config_t *spi_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_spi_obj *spi_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && spi_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->max_leds > 0, ESP_ERR_INVALID_ARG, err, TAG, "invalid number of LEDs");
+    ESP_GOTO_ON_FALSE(!(spi_config->flags.stream_encode && spi_config->flags.async_refresh), ESP_ERR_INVALID_ARG, err, TAG, "stream_encode and async_refresh are exclusive");
+    led_color_component_format_t component_fmt = led_config->color_component_format;
+    // If R/G/B order is not specified, set default GRB order as fallback
+    if (component_fmt.format_id == 0) {
+        component_fmt = LED_STRIP_COLOR_COMPONENT_FMT_GRB;
+    }
+    // check the validation of the color component format
+    uint8_t mask = 0;
+    if (component_fmt.format.num_components == 3) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x07, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else if (component_fmt.format.num_components == 4) {
+        mask = BIT(component_fmt.format.r_pos) | BIT(component_fmt.format.g_pos) | BIT(component_fmt.format.b_pos) | BIT(component_fmt.format.w_pos);
+        // Check for invalid values
+        ESP_RETURN_ON_FALSE(mask == 0x0F, ESP_ERR_INVALID_ARG, TAG, "invalid order argument");
+    } else {
+        ESP_RETURN_ON_FALSE(false, ESP_ERR_INVALID_ARG, TAG, "invalid number of color components: %d", component_fmt.format.num_components);
+    }
+    // TODO: we assume each color component is 8 bits, may need to support other configurations in the future, e.g. 10bits per color component?
+    uint8_t bytes_per_pixel = component_fmt.format.num_components;
+    uint32_t mem_caps = MALLOC_CAP_DEFAULT;
+    if (spi_config->flags.with_dma) {
+        // DMA buffer must be placed in internal SRAM
+        mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
+    }
+    bool stream = spi_config->flags.stream_encode;
+    uint32_t frame_size = led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    // each buffer starts word aligned, so DMA reads it in place
+    uint32_t buf_size = (frame_size + LED_STRIP_SPI_DMA_ALIGN - 1) & ~(LED_STRIP_SPI_DMA_ALIGN - 1);
+    // pixels are kept as written and encoded at refresh, so a new color correction applies to all of them;
+    // async refresh encodes the next frame while DMA reads the previous one, so it needs two frame buffers
+    uint32_t num_bufs = stream ? 0 : spi_config->flags.async_refresh ? 2 : 1;
+    // a streamed strip has no frame buffer, just the chunks have to be DMA capable
+    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + buf_size * num_bufs, num_bufs ? mem_caps : MALLOC_CAP_DEFAULT);
+
+    ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    for (uint32_t i = 0; i < num_bufs; i++) {
+        spi_strip->tx_buf[i] = spi_strip->pixel_mem + buf_size * i;
+    }
+    // DMA never reads the colors as written, they stay out of the DMA capable memory
+    spi_strip->pixel_buf = heap_caps_calloc(led_config->max_leds, bytes_per_pixel, MALLOC_CAP_DEFAULT);
+    ESP_GOTO_ON_FALSE(spi_strip->pixel_buf, ESP_ERR_NO_MEM, err, TAG, "no mem for spi pixels");
+    spi_strip->buf_size = buf_size;
+    uint32_t max_transfer_sz = buf_size;
+    if (stream) {
+        uint32_t chunk_leds = spi_config->stream_chunk_leds ? spi_config->stream_chunk_leds : LED_STRIP_SPI_DEFAULT_STREAM_CHUNK_LEDS;
+        if (chunk_leds > led_config->max_leds) {
+            chunk_leds = led_config->max_leds;
+        }
+        // whole words per chunk, so both are sent in place (a multiple of 4 LEDs for RGB)
+        while ((chunk_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE) % LED_STRIP_SPI_DMA_ALIGN) {
+            chunk_leds++;
+        }
+        max_transfer_sz = chunk_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+        spi_strip->chunk_mem = heap_caps_calloc(2, max_transfer_sz, mem_caps);
+        ESP_GOTO_ON_FALSE(spi_strip->chunk_mem, ESP_ERR_NO_MEM, err, TAG, "no mem for spi chunks");
+        spi_strip->chunk_buf[0] = spi_strip->chunk_mem;
+        spi_strip->chunk_buf[1] = spi_strip->chunk_mem + max_transfer_sz;
+        spi_strip->chunk_leds = chunk_leds;
+    }
+
+    spi_strip->spi_host = spi_config->spi_bus;
+    // for backward compatibility, if the user does not set the clk_src, use the default value
+    spi_clock_source_t clk_src = SPI_CLK_SRC_DEFAULT;
+    if (spi_config->clk_src) {
+        clk_src = spi_config->clk_src;
+    }
+
+    spi_bus_config_t spi_bus_cfg = {
+        .mosi_io_num = led_config->strip_gpio_num,
+        //Only use MOSI to generate the signal, set -1 when other pins are not used.
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = max_transfer_sz,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(spi_strip->spi_host, &spi_bus_cfg, spi_config->flags.with_dma ? SPI_DMA_CH_AUTO : SPI_DMA_DISABLED), err, TAG, "create SPI bus failed");
+
+    if (led_config->flags.invert_out == true) {
+        esp_rom_gpio_connect_out_signal(led_config->strip_gpio_num, spi_periph_signal[spi_strip->spi_host].spid_out, true, false);
+    }
+
+    spi_device_interface_config_t spi_dev_cfg = {
+        .clock_source = clk_src,
+        .command_bits = 0,
+        .address_bits = 0,
+        .dummy_bits = 0,
+        .clock_speed_hz = LED_STRIP_SPI_DEFAULT_RESOLUTION,
+        .mode = 0,
+        //set -1 when CS is not used
+        .spics_io_num = -1,
+        .queue_size = LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE,
+        // streamed chunks are timed in the callbacks
+        .pre_cb = stream ? led_strip_spi_pre_cb : NULL,
+        .post_cb = (stream || spi_config->on_refresh_done) ? led_strip_spi_post_cb : NULL,
+    };
+
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(spi_strip->spi_host, &spi_dev_cfg, &spi_strip->spi_device), err, TAG, "Failed to add spi device");
+    //ensure the reset time is enough
+    esp_rom_delay_us(10);
+    int clock_resolution_khz = 0;
+    spi_device_get_actual_freq(spi_strip->spi_device, &clock_resolution_khz);
+    // TODO: ideally we should decide the SPI_BYTES_PER_COLOR_BYTE by the real clock resolution
+    // But now, let's fixed the resolution, the downside is, we don't support a clock source whose frequency is not multiple of LED_STRIP_SPI_DEFAULT_RESOLUTION
+    // clock_resolution between 2.2MHz to 2.8MHz is supported
+    ESP_GOTO_ON_FALSE((clock_resolution_khz < LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 + 300) && (clock_resolution_khz > LED_STRIP_SPI_DEFAULT_RESOLUTION / 1000 - 300), ESP_ERR_NOT_SUPPORTED, err,
+                      TAG, "unsupported clock resolution:%dKHz", clock_resolution_khz);
+
+    spi_strip->component_fmt = component_fmt;
+    spi_strip->bytes_per_pixel = bytes_per_pixel;
+    spi_strip->stream = stream;
+    spi_strip->strip_len = led_config->max_leds;
+    spi_strip->on_refresh_done = spi_config->on_refresh_done;
+    spi_strip->user_ctx = spi_config->user_ctx;
+    spi_strip->base.set_pixel = led_strip_spi_set_pixel;
+    spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.set_pixels = led_strip_spi_set_pixels;
+    spi_strip->base.fill = led_strip_spi_fill;
+    spi_strip->base.refresh = led_strip_spi_refresh;
+    spi_strip->base.wait_refresh_done = led_strip_spi_wait_refresh_done;
+    spi_strip->base.clear = led_strip_spi_clear;
+    spi_strip->base.del = led_strip_spi_del;
+
+    *ret_strip = &spi_strip->base;
+    return ESP_OK;
+err:
+    if (spi_strip) {
+        if (spi_strip->spi_device) {
+            spi_bus_remove_device(spi_strip->spi_device);
+        }
+        if (spi_strip->spi_host) {
+            spi_bus_free(spi_strip->spi_host);
+        }
+        free(spi_strip->chunk_mem);
+        free(spi_strip->pixel_buf);
+        free(spi_strip);
+    }
+    return ret;
+}
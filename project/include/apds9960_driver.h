@@ -7,8 +7,11 @@
 #define APDS9960_DRIVER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
-#include "driver/i2c.h"
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 // APDS-9960 I2C address
 #define APDS9960_I2C_ADDR 0x39
@@ -21,6 +24,7 @@
 #define APDS9960_GSTATUS       0xAF
 #define APDS9960_GFLVL         0xAE // Gesture FIFO Level
 #define APDS9960_GFIFO_U       0xFC // Gesture FIFO UP Value
+#define APDS9960_GFIFO_DATASETS_MAX 32 // FIFO depth in U/D/L/R datasets
 #define APDS9960_ID            0x92
 #define APDS9960_ID_EXPECTED   0x9E // Common valid IDs are 0xAB (Rev B), 0x9E (Rev A), some datasheets mention 0xA8.
 #define APDS9960_GPENTH        0xA0 // Gesture Proximity Enter Threshold
@@ -29,33 +33,174 @@
 #define APDS9960_PDATA         0x9C // Proximity Data
 #define APDS9960_PPULSE        0x8E // Proximity Pulse Count and Length
 #define APDS9960_CONTROL       0x8F // Control Register (for PGAIN, LDRIVE)
+#define APDS9960_PILT          0x89 // Proximity Interrupt Low Threshold
+#define APDS9960_PIHT          0x8B // Proximity Interrupt High Threshold
+#define APDS9960_PERS          0x8C // Interrupt Persistence Filters (PPERS in bits 7:4)
+#define APDS9960_STATUS        0x93 // Device Status (PINT, GINT, PVALID)
+#define APDS9960_PICLEAR       0xE5 // Proximity Interrupt Clear (address-only write)
+#define APDS9960_AICLEAR       0xE7 // All Non-Gesture Interrupts Clear (address-only write)
 
-// I2C configuration
+// Configuration register window mirrored by the driver shadow (ENABLE..GCONF4)
+#define APDS9960_SHADOW_FIRST  APDS9960_ENABLE
+#define APDS9960_SHADOW_SIZE   (APDS9960_GCONF4 - APDS9960_ENABLE + 1)
+
+// Register bit fields
+#define APDS9960_ENABLE_PON    0x01 // Power ON
+#define APDS9960_ENABLE_PEN    0x04 // Proximity Enable
+#define APDS9960_ENABLE_PIEN   0x20 // Proximity Interrupt Enable
+#define APDS9960_ENABLE_GEN    0x40 // Gesture Enable
+#define APDS9960_GCONF4_GMODE  0x01 // Gesture Mode
+#define APDS9960_GCONF4_GIEN   0x02 // Gesture Interrupt Enable
+#define APDS9960_GCONF4_GFIFO_CLR 0x04 // Clears the gesture FIFO, GINT, GVALID, GFLVL and GFOV
+#define APDS9960_GSTATUS_GVALID 0x01 // Gesture FIFO holds valid data
+#define APDS9960_STATUS_GINT   0x04
+#define APDS9960_STATUS_PINT   0x20
+
+/**
+ * @struct apds9960_gesture_dataset_t
+ * @brief One gesture FIFO dataset, laid out in the sensor's U, D, L, R read order.
+ */
+typedef struct {
+    uint8_t u;
+    uint8_t d;
+    uint8_t l;
+    uint8_t r;
+} apds9960_gesture_dataset_t;
+
+/**
+ * @struct apds9960_snapshot_t
+ * @brief Sensor status needed by one acquisition pass.
+ */
+typedef struct {
+    uint8_t pdata;   // Proximity data (PDATA)
+    uint8_t gflvl;   // Gesture FIFO level in datasets (GFLVL)
+    uint8_t gstatus; // Gesture status (GSTATUS, bit 0 = GVALID)
+} apds9960_snapshot_t;
+
+/**
+ * @struct apds9960_stats_t
+ * @brief Bus health counters maintained by the driver.
+ */
+typedef struct {
+    uint32_t transactions;      // I2C transactions issued (including retries)
+    uint32_t errors;            // Transactions that failed
+    uint32_t timeouts;          // Transactions that hit their deadline
+    uint32_t recoveries;        // Successful bus recoveries
+    uint32_t recovery_failures; // Recoveries that could not bring the sensor back
+    uint32_t last_recovery_us;  // Duration of the last recovery
+    uint32_t max_recovery_us;   // Longest recovery so far
+    uint32_t mux_switches;      // Mux channel changes made to reach this sensor
+} apds9960_stats_t;
+
+#define APDS9960_NO_MUX -1     // Sensor wired directly to the bus
+#define APDS9960_MUX_CHANNELS 8 // TCA9548A channel count
+#define APDS9960_BUS_MAX_DEVS 8 // Sensors per bus (all APDS-9960 share address 0x39, so one per mux channel)
+
+typedef struct apds9960_dev_t apds9960_dev_t;
+
+/**
+ * @struct apds9960_bus_config_t
+ * @brief I2C bus wiring, with an optional TCA9548A-style mux in front of the sensors.
+ */
+typedef struct {
+    i2c_port_num_t port;
+    gpio_num_t sda_io;
+    gpio_num_t scl_io;
+    uint8_t mux_addr; // 7-bit mux address (0x70-0x77), 0 when the bus has no mux
+} apds9960_bus_config_t;
+
+/**
+ * @struct apds9960_bus_t
+ * @brief State of one I2C bus and the sensors attached to it.
+ */
+typedef struct {
+    apds9960_bus_config_t config;
+    i2c_master_bus_handle_t handle;
+    i2c_master_dev_handle_t mux_handle;
+    int8_t mux_channel; // Channel currently routed by the mux, APDS9960_NO_MUX when unknown
+    bool recovering;
+    apds9960_dev_t *devs[APDS9960_BUS_MAX_DEVS];
+    uint8_t num_devs;
+} apds9960_bus_t;
+
+/**
+ * @struct apds9960_dev_config_t
+ * @brief Per-sensor wiring.
+ */
+typedef struct {
+    int8_t mux_channel; // Mux channel (0-7), or APDS9960_NO_MUX
+    gpio_num_t int_io;  // INT pin, GPIO_NUM_NC if not wired
+} apds9960_dev_config_t;
+
+/**
+ * @struct apds9960_dev_t
+ * @brief State of one APDS-9960: bus handle, configuration shadow and counters.
+ */
+struct apds9960_dev_t {
+    apds9960_bus_t *bus;
+    apds9960_dev_config_t config;
+    i2c_master_dev_handle_t handle;
+    uint8_t shadow[APDS9960_SHADOW_SIZE]; // RAM copy of the configuration registers 0x80-0xAB
+    uint64_t shadow_dirty;                // Bit n covers register 0x80 + n
+    bool shadow_valid;                    // Set once apds9960_init has seeded the shadow
+    apds9960_stats_t stats;
+};
+
+// I2C configuration (defaults for the single-sensor wiring)
 #define I2C_MASTER_NUM I2C_NUM_0
 #define I2C_MASTER_SCL_IO 4
 #define I2C_MASTER_SDA_IO 5
+#define I2C_MASTER_FAST_MODE 0 // Set to 1 for 400 kHz fast mode (needs external pull-ups, ~4.7k)
+#if I2C_MASTER_FAST_MODE
+#define I2C_MASTER_FREQ_HZ 400000
+#else
 #define I2C_MASTER_FREQ_HZ 100000
-#define I2C_MASTER_TIMEOUT_MS 1000
+#endif
+#define I2C_MASTER_TIMEOUT_MS 5 // Slack on top of the wire time of each transaction, see apds9960_timeout_ms()
 
+// Interrupt configuration (INT is open-drain, active low)
+#define APDS9960_INT_IO 6
+#define APDS9960_PROX_GATE 140 // Hand-in-range threshold, programmed as PIHT and GPENTH
+#define APDS9960_PPERS_DEFAULT 2 // Consecutive out-of-range proximity cycles before PINT asserts
+#define APDS9960_INT_FALLBACK_MS 10000 // Safety poll in case an INT edge is missed
 
 /**
- * @brief Initialize I2C communication with APDS-9960
+ * @brief Initialize an I2C bus for APDS-9960 sensors
+ * @note Creates the persistent i2c_master bus (and mux device) handles used by every register access
+ * @param bus Caller-owned bus object, must outlive every sensor attached to it
+ * @param config Bus pins, port and optional mux address
  * @return esp_err_t 
  *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: NULL pointer
  *         - ESP_FAIL: I2C initialization error
  */
-esp_err_t apds9960_i2c_init(void);
+esp_err_t apds9960_bus_init(apds9960_bus_t *bus, const apds9960_bus_config_t *config);
 
 /**
- * @brief Initialize APDS-9960 sensor with default gesture configuration
+ * @brief Attach an APDS-9960 to a bus and initialize it with the default gesture configuration
+ * @param dev Caller-owned sensor object
+ * @param bus Bus the sensor is wired to
+ * @param config Mux channel and INT pin of the sensor
  * @return esp_err_t 
  *         - ESP_OK: Success
- *         - ESP_ERR_INVALID_STATE: Sensor not responding
+ *         - ESP_ERR_INVALID_ARG: NULL pointer, bad mux channel or bus already full
+ *         - ESP_FAIL: Sensor not responding
+ */
+esp_err_t apds9960_init(apds9960_dev_t *dev, apds9960_bus_t *bus, const apds9960_dev_config_t *config);
+
+/**
+ * @brief Pick where a pass over several sensors should start
+ * @note Sensors are expected in mux channel order. Starting at the sensor whose channel is already
+ *       routed, then wrapping around, costs one mux switch per sensor and none for the first.
+ * @param devs Sensors in mux channel order
+ * @param count Number of sensors
+ * @return Index of the first sensor to read
  */
-esp_err_t apds9960_init(void);
+size_t apds9960_schedule_start(apds9960_dev_t *const *devs, size_t count);
 
 /**
  * @brief Write a byte to APDS-9960 register
+ * @param dev Sensor handle
  * @param reg Register address (0x00-0xFF)
  * @param value Byte to write
  * @return esp_err_t 
@@ -63,10 +208,11 @@ esp_err_t apds9960_init(void);
  *         - ESP_ERR_INVALID_ARG: Invalid register
  *         - ESP_FAIL: I2C communication error
  */
-esp_err_t apds9960_write_byte(uint8_t reg, uint8_t value);
+esp_err_t apds9960_write_byte(apds9960_dev_t *dev, uint8_t reg, uint8_t value);
 
 /**
  * @brief Read a byte from APDS-9960 register
+ * @param dev Sensor handle
  * @param reg Register address (0x00-0xFF)
  * @param data Pointer to store read value
  * @return esp_err_t 
@@ -74,55 +220,200 @@ esp_err_t apds9960_write_byte(uint8_t reg, uint8_t value);
  *         - ESP_ERR_INVALID_ARG: Invalid register or NULL pointer
  *         - ESP_FAIL: I2C communication error
  */
-esp_err_t apds9960_read_byte(uint8_t reg, uint8_t *data);
+esp_err_t apds9960_read_byte(apds9960_dev_t *dev, uint8_t reg, uint8_t *data);
 
 /**
  * @brief Read a block of data from consecutive registers
+ * @param dev Sensor handle
  * @param reg Starting register address
  * @param data Buffer to store read data
- * @param len Number of bytes to read (max 32)
+ * @param len Number of bytes to read (a full gesture FIFO is 128 bytes)
  * @return esp_err_t 
  *         - ESP_OK: Success
- *         - ESP_ERR_INVALID_SIZE: Requested length too large
  *         - ESP_FAIL: I2C communication error
  */
-esp_err_t apds9960_read_block(uint8_t reg, uint8_t *data, uint8_t len);
+esp_err_t apds9960_read_block(apds9960_dev_t *dev, uint8_t reg, uint8_t *data, size_t len);
+
+/**
+ * @brief Stage a configuration register value in the driver shadow
+ * @note Nothing is sent until apds9960_config_commit() is called
+ * @param dev Sensor handle
+ * @param reg Configuration register address (0x80-0xAB, data and reserved registers are rejected)
+ * @param value Value to stage
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: Not a configuration register
+ */
+esp_err_t apds9960_config_set(apds9960_dev_t *dev, uint8_t reg, uint8_t value);
+
+/**
+ * @brief Stage a masked update of a configuration register in the driver shadow
+ * @param dev Sensor handle
+ * @param reg Configuration register address
+ * @param mask Bits to modify
+ * @param value New value for the masked bits
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: Not a configuration register
+ */
+esp_err_t apds9960_config_update(apds9960_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t value);
+
+/**
+ * @brief Read a configuration register from the driver shadow (no bus access)
+ * @param dev Sensor handle
+ * @param reg Configuration register address
+ * @param value Pointer to store the cached value
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: Not a configuration register or NULL pointer
+ */
+esp_err_t apds9960_config_get(apds9960_dev_t *dev, uint8_t reg, uint8_t *value);
+
+/**
+ * @brief Flush staged configuration changes, one burst write per contiguous run of dirty registers
+ * @param dev Sensor handle
+ * @return esp_err_t 
+ *         - ESP_OK: Success (or nothing to write)
+ *         - ESP_FAIL: I2C error, the failed run stays dirty
+ */
+esp_err_t apds9960_config_commit(apds9960_dev_t *dev);
+
+/**
+ * @brief Recover a stuck I2C bus and re-initialise every sensor on it from their shadow configurations
+ * @note Called automatically when a transaction times out or is not acknowledged
+ * @param dev Sensor handle
+ * @return esp_err_t 
+ *         - ESP_OK: Bus recreated and sensor configuration restored
+ *         - ESP_ERR_INVALID_STATE: Recovery already in progress
+ *         - ESP_FAIL: I2C error while restoring the configuration
+ */
+esp_err_t apds9960_bus_recover(apds9960_dev_t *dev);
+
+/**
+ * @brief Get a copy of the bus health counters
+ * @param dev Sensor handle
+ * @param stats Pointer to store the counters
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: NULL pointer
+ */
+esp_err_t apds9960_get_stats(apds9960_dev_t *dev, apds9960_stats_t *stats);
 
 /**
  * @brief Read proximity value from PDATA register
+ * @param dev Sensor handle
  * @param proximity Pointer to store proximity value (0-255)
  * @return esp_err_t 
  *         - ESP_OK: Success
  *         - ESP_ERR_INVALID_STATE: Proximity engine not enabled
  */
-esp_err_t apds9960_read_proximity(uint8_t *proximity);
+esp_err_t apds9960_read_proximity(apds9960_dev_t *dev, uint8_t *proximity);
 
 /**
  * @brief Read gesture status from GSTATUS register
+ * @param dev Sensor handle
  * @param status Pointer to store status byte (bit 0 = GVALID)
  * @return esp_err_t 
  *         - ESP_OK: Success
  *         - ESP_FAIL: I2C error
  */
-esp_err_t apds9960_read_gesture_status(uint8_t *status);
+esp_err_t apds9960_read_gesture_status(apds9960_dev_t *dev, uint8_t *status);
 
 /**
  * @brief Read number of available gesture datasets in FIFO
+ * @param dev Sensor handle
  * @param level Pointer to store FIFO level (0-32)
  * @return esp_err_t 
  *         - ESP_OK: Success
  *         - ESP_FAIL: I2C error
  */
-esp_err_t apds9960_read_gesture_fifo_level(uint8_t *level);
+esp_err_t apds9960_read_gesture_fifo_level(apds9960_dev_t *dev, uint8_t *level);
 
 /**
  * @brief Read gesture FIFO data (4 bytes per dataset: U, D, L, R)
+ * @param dev Sensor handle
  * @param fifo_data Buffer to store data (must have space for 4*N bytes)
  * @return esp_err_t 
  *         - ESP_OK: Success
  *         - ESP_ERR_INVALID_SIZE: FIFO empty
  */
-esp_err_t apds9960_read_gesture_fifo_data(uint8_t *fifo_data);
+esp_err_t apds9960_read_gesture_fifo_data(apds9960_dev_t *dev, uint8_t *fifo_data);
+
+/**
+ * @brief Drain gesture FIFO datasets in a single repeated-start block read
+ * @param dev Sensor handle
+ * @param level Number of datasets to read, as reported by GFLVL (1-32)
+ * @param datasets Buffer to store the datasets (must have space for level entries)
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: NULL buffer
+ *         - ESP_ERR_INVALID_SIZE: level is 0 or larger than the FIFO
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_read_gesture_fifo(apds9960_dev_t *dev, uint8_t level, apds9960_gesture_dataset_t *datasets);
+
+/**
+ * @brief Read PDATA, GFLVL and GSTATUS in the fewest bus transactions
+ * @note PDATA (0x9C) is a single read, GFLVL/GSTATUS (0xAE-0xAF) are one auto-increment block read
+ * @param dev Sensor handle
+ * @param snap Pointer to the snapshot to fill
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: NULL pointer
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_read_snapshot(apds9960_dev_t *dev, apds9960_snapshot_t *snap);
+
+/**
+ * @brief Route the APDS-9960 INT line to a GPIO interrupt that notifies a task
+ * @param dev Sensor handle
+ * @param notify_task Task woken with a task notification on every falling edge of INT
+ *        (several sensors may notify the same task)
+ * @return esp_err_t 
+ *         - ESP_OK: Success, or nothing to do when config.int_io is GPIO_NUM_NC
+ *         - ESP_ERR_INVALID_ARG: NULL task handle
+ *         - ESP_FAIL: GPIO/ISR configuration error
+ */
+esp_err_t apds9960_int_init(apds9960_dev_t *dev, TaskHandle_t notify_task);
+
+/**
+ * @brief Enable or disable the gesture interrupt (GIEN in GCONF4)
+ * @param dev Sensor handle
+ * @param enable true to assert INT when the gesture FIFO reaches GFIFOTH
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_enable_gesture_interrupt(apds9960_dev_t *dev, bool enable);
+
+/**
+ * @brief Enable or disable the proximity interrupt (PIEN in ENABLE)
+ * @param dev Sensor handle
+ * @param enable true to assert INT when PDATA leaves the PILT/PIHT window
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_enable_proximity_interrupt(apds9960_dev_t *dev, bool enable);
+
+/**
+ * @brief Clear all pending non-gesture interrupts (PINT, AINT, CINT)
+ * @param dev Sensor handle
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_clear_interrupts(apds9960_dev_t *dev);
+
+/**
+ * @brief Clear the gesture FIFO, which also releases GINT
+ * @note Leaves GMODE clear, for when no hand is present; the sensor enters the gesture engine again above GPENTH
+ * @param dev Sensor handle
+ * @return esp_err_t 
+ *         - ESP_OK: Success
+ *         - ESP_FAIL: I2C error
+ */
+esp_err_t apds9960_clear_gesture_fifo(apds9960_dev_t *dev);
 
 
 #endif // APDS9960_DRIVER_H
\ No newline at end of file
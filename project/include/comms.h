@@ -25,6 +25,14 @@ extern bool mqtt_connected;
  */
 void publish(const char* topic, const char* message);
 
+/**
+ * @brief Function to publish a binary payload to a specific MQTT topic.
+ * @param topic The MQTT topic to publish to.
+ * @param data The payload to publish.
+ * @param len Length of the payload in bytes.
+ */
+void publish_binary(const char* topic, const void* data, size_t len);
+
 /**
  * @brief Function to initialize Wi-Fi.
  */
@@ -0,0 +1,97 @@
+/**
+ * @file gesture_classifier.h
+ * @brief Decision-tree gesture classifier over decoded trajectories.
+ *
+ * Each finished trajectory is reduced to a small integer feature vector and
+ * classified by walking a binary tree stored as a const table in flash
+ * (gesture_model.c, generated by tools/train_gesture_model.py from labelled traces).
+ * The committed model is still the hand-written seed, a placeholder until it is
+ * retrained on captured gestures.
+ * Inference allocates nothing and visits at most GESTURE_TREE_MAX_DEPTH nodes.
+ * Taps are combined into double taps afterwards, using the trajectory timestamps.
+ */
+
+#ifndef GESTURE_CLASSIFIER_H
+#define GESTURE_CLASSIFIER_H
+
+#include <stdint.h>
+#include "../include/gesture_decoder.h"
+
+#define GESTURE_TREE_MAX_DEPTH 12            // Deepest path the generator may emit
+#define GESTURE_TREE_LEAF 0xFF               // Node feature value marking a leaf
+#define GESTURE_DOUBLE_TAP_WINDOW_US 600000  // Second tap must end within this time of the first
+#define GESTURE_CLASSIFIER_PROFILE 0         // Set to 1 to count CPU cycles spent in gesture_classifier_run()
+
+/**
+ * @enum gesture_feature_t
+ * @brief Index of each entry in the feature vector, shared with the model generator.
+ */
+typedef enum {
+    GESTURE_FEATURE_UD_DELTA = 0, // Q15
+    GESTURE_FEATURE_LR_DELTA,     // Q15
+    GESTURE_FEATURE_AXIS_MARGIN,  // |UD delta| - |LR delta|, Q15
+    GESTURE_FEATURE_MOTION,       // max(|UD delta|, |LR delta|), Q15
+    GESTURE_FEATURE_SAMPLES,
+    GESTURE_FEATURE_ENTRY_LEVEL,
+    GESTURE_FEATURE_PEAK_LEVEL,
+    GESTURE_FEATURE_LEVEL_DELTA,  // Exit minus entry level
+    GESTURE_FEATURE_COUNT,
+} gesture_feature_t;
+
+/**
+ * @struct gesture_tree_node_t
+ * @brief One tree node, stored in pre-order so the left child always follows its parent.
+ */
+typedef struct {
+    int32_t threshold; // Go left when feature <= threshold
+    uint8_t feature;   // gesture_feature_t, or GESTURE_TREE_LEAF
+    uint8_t label;     // gesture_t at a leaf
+    uint16_t right;    // Index of the right child
+} gesture_tree_node_t;
+
+// Model tables, see gesture_model.c
+extern const gesture_tree_node_t gesture_model_nodes[];
+extern const uint16_t gesture_model_node_count;
+
+/**
+ * @struct gesture_classifier_t
+ * @brief Per-sensor state for gestures spanning several trajectories.
+ */
+typedef struct {
+    int64_t last_tap_us; // End of the last unpaired tap, 0 if none
+#if GESTURE_CLASSIFIER_PROFILE
+    uint32_t profile_cycles; // Cycles spent in gesture_classifier_run()
+    uint32_t profile_runs;   // Trajectories classified
+#endif
+} gesture_classifier_t;
+
+/**
+ * @brief Reset a classifier
+ * @param cls Classifier
+ */
+void gesture_classifier_init(gesture_classifier_t *cls);
+
+/**
+ * @brief Build the feature vector of a trajectory
+ * @param result Trajectory from the decoder
+ * @param features Filled in with GESTURE_FEATURE_COUNT values
+ */
+void gesture_classifier_features(const gesture_result_t *result, int32_t features[GESTURE_FEATURE_COUNT]);
+
+/**
+ * @brief Classify one trajectory with the tree alone
+ * @param result Trajectory from the decoder
+ * @return The leaf label, GESTURE_NONE if the table is malformed
+ */
+gesture_t gesture_classifier_predict(const gesture_result_t *result);
+
+/**
+ * @brief Classify a trajectory and pair taps into double taps
+ * @param cls Classifier of the sensor that produced the trajectory
+ * @param result Trajectory from the decoder
+ * @param end_us Timestamp of the sample that ended the trajectory
+ * @return The gesture to act on
+ */
+gesture_t gesture_classifier_run(gesture_classifier_t *cls, const gesture_result_t *result, int64_t end_us);
+
+#endif // GESTURE_CLASSIFIER_H
@@ -0,0 +1,126 @@
+/**
+ * @file gesture_decoder.h
+ * @brief Streaming swipe decoder over APDS-9960 gesture FIFO datasets.
+ *
+ * A swipe shows up as the balance between opposing photodiodes changing over time.
+ * The decoder records the UD and LR ratios when the hand enters the sensor's field
+ * and the ratios when it leaves, and classifies the swipe by the larger delta.
+ * Datasets are consumed one at a time with constant state, so the FIFO can be fed
+ * in whatever chunks it is read.
+ *
+ * All maths is integer: ratios, deltas and confidence are Q15 (1.0 = 32768). The
+ * ESP32-C3 has no FPU, and integer results are identical on host and target.
+ */
+
+#ifndef GESTURE_DECODER_H
+#define GESTURE_DECODER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../include/apds9960_driver.h"
+
+// Decoder tuning
+#define GESTURE_DECODER_THRESHOLD 10      // All four channels must exceed this for a dataset to count as "hand present"
+#define GESTURE_DECODER_MIN_SAMPLES 4     // Shorter trajectories are treated as noise
+#define GESTURE_DECODER_SENSITIVITY (GESTURE_Q15_ONE / 2) // Minimum ratio delta (ratios span -1..1) for a swipe
+#define GESTURE_DECODER_SMOOTH_SHIFT 1    // EMA weight of a new sample is 1 / 2^shift, 0 disables smoothing
+#define GESTURE_DECODER_PROFILE 0         // Set to 1 to count CPU cycles spent in gesture_decoder_push()
+
+#define GESTURE_Q15_ONE 32768             // 1.0 in Q15
+
+/**
+ * @brief Balance between two opposing photodiodes in Q15
+ * @param a Channel counted positive
+ * @param b Opposing channel, a + b must not be 0
+ * @return -1 (all b) .. 1 (all a), clamped below GESTURE_Q15_ONE
+ */
+static inline int32_t gesture_ratio_q15(uint8_t a, uint8_t b) {
+    int32_t ratio = ((int32_t)a - (int32_t)b) * GESTURE_Q15_ONE / ((int32_t)a + (int32_t)b);
+    return ratio >= GESTURE_Q15_ONE ? GESTURE_Q15_ONE - 1 : ratio;
+}
+
+/**
+ * @enum gesture_t
+ * @brief Decoded gesture, the values match the codes taken by blink_led().
+ *        The decoder itself only produces swipes, the rest come from gesture_classifier.
+ */
+typedef enum {
+    GESTURE_NONE = 0,
+    GESTURE_UP = 1,
+    GESTURE_DOWN = 2,
+    GESTURE_LEFT = 3,
+    GESTURE_RIGHT = 4,
+    GESTURE_HOLD = 5,       // Hand held still over the sensor
+    GESTURE_APPROACH = 6,   // Hand moving towards the sensor
+    GESTURE_RETREAT = 7,    // Hand moving away from the sensor
+    GESTURE_TAP = 8,        // Short dip towards the sensor and back
+    GESTURE_DOUBLE_TAP = 9, // Two taps in quick succession
+} gesture_t;
+
+/**
+ * @struct gesture_result_t
+ * @brief A decoded gesture and how clearly the trajectory supports it.
+ */
+typedef struct {
+    gesture_t gesture;
+    int32_t confidence; // Q15 0..1, grows with the dominant delta and its margin over the other axis
+    int32_t ud_delta;   // Exit minus entry UD ratio, Q15
+    int32_t lr_delta;   // Exit minus entry LR ratio, Q15
+    uint16_t samples;   // Datasets in the trajectory
+    uint16_t entry_level; // U+D+L+R of the first dataset (0-1020)
+    uint16_t peak_level;  // Highest U+D+L+R seen
+    uint16_t exit_level;  // Smoothed U+D+L+R at the exit
+} gesture_result_t;
+
+/**
+ * @struct gesture_decoder_t
+ * @brief Decoder state for one sensor.
+ */
+typedef struct {
+    bool active;       // A trajectory is in progress
+    uint16_t samples;
+    int32_t ud_entry;  // Q15 ratios
+    int32_t lr_entry;
+    int32_t ud_exit;   // Smoothed, follows the latest samples
+    int32_t lr_exit;
+    uint16_t entry_level; // U+D+L+R sums
+    uint16_t peak_level;
+    uint16_t exit_level;  // Smoothed like the exit ratios
+#if GESTURE_DECODER_PROFILE
+    uint32_t profile_cycles;  // Cycles spent in gesture_decoder_push()
+    uint32_t profile_pushes;  // Datasets pushed
+#endif
+} gesture_decoder_t;
+
+/**
+ * @brief Reset a decoder to the idle state
+ * @param dec Decoder
+ */
+void gesture_decoder_init(gesture_decoder_t *dec);
+
+/**
+ * @brief Feed one FIFO dataset to the decoder
+ * @param dec Decoder
+ * @param dataset U/D/L/R sample, in FIFO order
+ * @param result Filled in when a trajectory ends
+ * @return true if a trajectory ended with this dataset and result was written
+ *         (result->gesture may still be GESTURE_NONE if it was too weak)
+ */
+bool gesture_decoder_push(gesture_decoder_t *dec, const apds9960_gesture_dataset_t *dataset, gesture_result_t *result);
+
+/**
+ * @brief Close the current trajectory, e.g. when the hand has left without a trailing low dataset
+ * @param dec Decoder
+ * @param result Filled in when a trajectory was in progress
+ * @return true if a trajectory was closed and result was written
+ */
+bool gesture_decoder_finish(gesture_decoder_t *dec, gesture_result_t *result);
+
+/**
+ * @brief Name of a gesture, as published over MQTT
+ * @param gesture Gesture
+ * @return "UP", "DOWN", "LEFT", "RIGHT", "HOLD", "APPROACH", "RETREAT", "TAP", "DOUBLE_TAP" or "NONE"
+ */
+const char *gesture_decoder_name(gesture_t gesture);
+
+#endif // GESTURE_DECODER_H
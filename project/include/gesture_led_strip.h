@@ -8,22 +8,32 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "led_strip.h"
 
 // LED strip config
 #define LED_STRIP_GPIO 8
+#define LED_STRIP_MAX_LEDS 30 // LEDs on the strip, at least one LED on board
+#define LED_STRIP_STREAM 0    // 1 for long strips: 3 bytes of RAM per LED instead of 18, but refresh blocks for the wire time
+#define LED_STRIP_SPLIT_GPIO -1 // Data pin of a second strip section holding the upper half of the LEDs, sent over RMT
+                                // at the same time as the SPI half. -1 drives the whole strip from LED_STRIP_GPIO
+#define LED_STRIP_PIXELS 29 // Pixels driven by the effects
+#define LED_SPOT_RADIUS 4   // Half-width of the tracking spot, in pixels
+#define LED_QUEUE_LENGTH 8  // Pending render commands
+#define LED_BRIGHTNESS 128  // Global brightness applied by the strip encoder, 255 is full
+#define LED_GAMMA 2.2f      // Gamma of the strip encoder, effects and led_colors write uncorrected values
+#define LED_CHROMATIC_PERIOD_MS 200       // Time spent on each color
+#define LED_SHIFT_CHROMATIC_PERIOD_MS 150 // Time to scroll by one pixel
+#define LED_FPS 100                       // Frame clock rate while an effect is animating
+#define LED_FRAME_US (1000000 / LED_FPS)
 
 /**
  * @struct rgb_t
- * @brief Structure to hold RGB color values.
+ * @brief Structure to hold RGB color values, the same layout led_strip_set_pixels() takes.
  */
-typedef struct {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-} rgb_t;
+typedef led_strip_rgb_t rgb_t;
 
 
 extern rgb_t led_colors[];
@@ -33,29 +43,76 @@ extern uint8_t s_led_state;
 // color index
 extern int8_t i;
 
-extern led_strip_handle_t led_strip;
-extern TaskHandle_t chromatic_task_handle;
-extern TaskHandle_t shift_chromatic_task_handle;
-extern volatile bool chromatic_active;
-extern volatile bool shift_chromatic_active;
+extern led_strip_handle_t led_strip; // Only touched by the render task once configure_led() returns
+
+/**
+ * @enum led_effect_t
+ * @brief Effects run by the render task.
+ */
+typedef enum {
+    LED_EFFECT_SOLID = 0,       // Whole strip in one color
+    LED_EFFECT_CHROMATIC,       // Whole strip cycling through led_colors
+    LED_EFFECT_SHIFT_CHROMATIC, // led_colors scrolling along the strip
+    LED_EFFECT_SPOT,            // Hand tracking spot
+    LED_EFFECT_HOLD,            // Keep the current pixels
+} led_effect_t;
+
+/**
+ * @struct led_command_t
+ * @brief Effect change sent to the render task, applied at the next frame boundary.
+ */
+typedef struct {
+    led_effect_t effect;
+    uint8_t color;     // Index into led_colors for LED_EFFECT_SOLID and LED_EFFECT_SPOT
+    uint8_t level;     // Spot brightness, 0-255
+    uint32_t center;   // Spot center along the strip, in 1/256 pixel
+} led_command_t;
+
+/**
+ * @struct led_render_stats_t
+ * @brief Frame clock statistics, maintained by the render task.
+ */
+typedef struct {
+    uint32_t frames;         // Frames drawn
+    uint32_t dropped_frames; // Clock ticks that passed without a frame
+    uint32_t max_frame_us;   // Longest render + refresh
+    uint64_t total_frame_us; // Sum of render + refresh times
+    uint32_t max_jitter_us;  // Worst lateness of a frame against the ideal clock
+    led_strip_refresh_stats_t strip; // Refreshes requested vs frames sent, unchanged frames are skipped
+    uint32_t stream_gap_us;  // Longest low time between two streamed SPI chunks, 0 unless LED_STRIP_STREAM
+} led_render_stats_t;
 
 /**
- * @brief Function to change colors of the LED strip based on gesture.asm
+ * @brief Function to change colors of the LED strip based on gesture. Never blocks, the change is queued for the render task.
  * @param gesture The gesture detected by the apds9960 sensor.
+ * @return Name of the color selected after the gesture.
  */
 const char* blink_led(uint8_t gesture);
 
 /**
- * @brief Function to configure the LED strip.
+ * @brief Function to configure the LED strip and start the render task.
  */
 void configure_led(void);
 
 /**
- * @brief Task for applying chromatic effect
+ * @brief Function to light the whole strip in the current color.
+ */
+void led_show_color(void);
+
+/**
+ * @brief Function to draw a light spot in the current color, with the rest of the strip off.
+ * @param center Spot center along the strip, in 1/256 pixel.
+ * @param level Spot brightness, 0-255.
+ */
+void led_spot(uint32_t center, uint8_t level);
+
+/**
+ * @brief Function to read the frame clock statistics.
+ * @param stats Filled in with a copy of the statistics.
  */
-void chromatic_effect_task(void *arg);
+void led_get_render_stats(led_render_stats_t *stats);
 
 /**
- * @brief Task for applying shift chromatic effect
+ * @brief Task that owns the LED strip, runs the current effect and applies queued commands.
  */
-void shift_chromatic_effect_task(void *arg);
+void led_render_task(void *arg);
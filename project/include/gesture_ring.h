@@ -0,0 +1,96 @@
+/**
+ * @file gesture_ring.h
+ * @brief Lock-free single-producer/single-consumer ring of timestamped gesture samples.
+ *
+ * The acquisition task pushes samples as it drains the sensor FIFOs and the
+ * processing task pops them. Neither side ever blocks: a full ring drops the new
+ * sample and counts an overflow.
+ */
+
+#ifndef GESTURE_RING_H
+#define GESTURE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "../include/apds9960_driver.h"
+
+#define GESTURE_RING_SIZE 256 // Samples, must be a power of two (8 full FIFOs)
+
+_Static_assert((GESTURE_RING_SIZE & (GESTURE_RING_SIZE - 1)) == 0, "GESTURE_RING_SIZE must be a power of two");
+
+/**
+ * @enum gesture_sample_kind_t
+ * @brief What a ring entry carries.
+ */
+typedef enum {
+    GESTURE_SAMPLE_DATASET = 0, // One FIFO dataset in data
+    GESTURE_SAMPLE_EXIT,        // The proximity gate closed, any open trajectory has ended
+    GESTURE_SAMPLE_PROXIMITY,   // Proximity reading of a poll in pdata
+} gesture_sample_kind_t;
+
+/**
+ * @struct gesture_sample_t
+ * @brief One ring entry.
+ */
+typedef struct {
+    int64_t timestamp_us;             // esp_timer time of the read that produced the entry
+    apds9960_gesture_dataset_t data;
+    uint8_t kind;                     // gesture_sample_kind_t
+    uint8_t sensor;                   // Index of the sensor that produced the entry
+    uint8_t pdata;
+} gesture_sample_t;
+
+/**
+ * @struct gesture_ring_t
+ * @brief Ring storage and indices; head is only written by the producer, tail only by the consumer.
+ */
+typedef struct {
+    gesture_sample_t buf[GESTURE_RING_SIZE];
+    atomic_uint_fast32_t head;       // Free-running count of pushed samples
+    atomic_uint_fast32_t tail;       // Free-running count of popped samples
+    atomic_uint_fast32_t overflows;  // Samples dropped because the ring was full
+    atomic_uint_fast32_t high_water; // Highest fill level seen by the producer
+} gesture_ring_t;
+
+/**
+ * @struct gesture_ring_stats_t
+ * @brief Snapshot of the ring counters.
+ */
+typedef struct {
+    uint32_t level;
+    uint32_t high_water;
+    uint32_t overflows;
+    uint32_t pushed;
+} gesture_ring_stats_t;
+
+/**
+ * @brief Reset a ring to empty with cleared counters (call before either task starts)
+ * @param ring Ring
+ */
+void gesture_ring_init(gesture_ring_t *ring);
+
+/**
+ * @brief Append a sample (producer side only)
+ * @param ring Ring
+ * @param sample Sample to copy in
+ * @return true if stored, false if the ring was full and the sample was dropped
+ */
+bool gesture_ring_push(gesture_ring_t *ring, const gesture_sample_t *sample);
+
+/**
+ * @brief Take the oldest sample (consumer side only)
+ * @param ring Ring
+ * @param sample Filled in with the oldest sample
+ * @return true if a sample was returned, false if the ring was empty
+ */
+bool gesture_ring_pop(gesture_ring_t *ring, gesture_sample_t *sample);
+
+/**
+ * @brief Read the ring counters, safe from either side
+ * @param ring Ring
+ * @param stats Filled in with the counters
+ */
+void gesture_ring_get_stats(gesture_ring_t *ring, gesture_ring_stats_t *stats);
+
+#endif // GESTURE_RING_H
@@ -0,0 +1,86 @@
+/**
+ * @file gesture_scheduler.h
+ * @brief Adaptive polling period for the gesture acquisition task.
+ *
+ * While a hand is in the gesture zone the sensors are polled every tick on top of
+ * their interrupts, after it leaves the rate decays through a cooldown period to
+ * the idle state, where only INT (and the APDS9960_INT_FALLBACK_MS safety poll)
+ * wakes the task. Time spent in each state is accumulated for diagnostics.
+ */
+
+#ifndef GESTURE_SCHEDULER_H
+#define GESTURE_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+
+#define GESTURE_POLL_ACTIVE_MS 5      // Rounded up to one tick (10 ms at CONFIG_FREERTOS_HZ=100)
+#define GESTURE_POLL_COOLDOWN_MS 50
+#define GESTURE_COOLDOWN_MS 1000      // Inactivity before falling back to idle
+
+/**
+ * @enum gesture_sched_state_t
+ * @brief Polling state.
+ */
+typedef enum {
+    GESTURE_SCHED_IDLE = 0, // Interrupt driven only
+    GESTURE_SCHED_ACTIVE,   // Hand in the gesture zone, fastest polling
+    GESTURE_SCHED_COOLDOWN, // Hand just left, medium polling in case it comes back
+    GESTURE_SCHED_STATES,
+} gesture_sched_state_t;
+
+/**
+ * @struct gesture_sched_stats_t
+ * @brief Per-state dwell statistics.
+ */
+typedef struct {
+    uint64_t dwell_us[GESTURE_SCHED_STATES]; // Total time spent in each state
+    uint32_t entries[GESTURE_SCHED_STATES];  // Times each state was entered
+    uint32_t polls[GESTURE_SCHED_STATES];    // Wake-ups while in each state
+} gesture_sched_stats_t;
+
+/**
+ * @struct gesture_scheduler_t
+ * @brief Scheduler state, updated by the acquisition task and readable from any task.
+ */
+typedef struct {
+    gesture_sched_state_t state;
+    int64_t state_since_us;    // When the current state was entered
+    int64_t last_activity_us;  // Last poll that saw a hand
+    gesture_sched_stats_t stats;
+    portMUX_TYPE lock;         // Guards stats and state_since_us for readers on other tasks
+} gesture_scheduler_t;
+
+/**
+ * @brief Start the scheduler in the idle state
+ * @param sched Scheduler
+ * @param now_us Current esp_timer time
+ */
+void gesture_scheduler_init(gesture_scheduler_t *sched, int64_t now_us);
+
+/**
+ * @brief Feed the outcome of a poll and get the time to wait before the next one
+ * @param sched Scheduler
+ * @param hand_present A sensor reported GVALID, a non-empty FIFO or proximity above the gate
+ * @param now_us Current esp_timer time
+ * @return Ticks to wait for INT before polling again
+ */
+TickType_t gesture_scheduler_update(gesture_scheduler_t *sched, bool hand_present, int64_t now_us);
+
+/**
+ * @brief Read the dwell statistics, including the time spent so far in the current state
+ * @param sched Scheduler
+ * @param now_us Current esp_timer time
+ * @param stats Filled in with the statistics
+ */
+void gesture_scheduler_get_stats(gesture_scheduler_t *sched, int64_t now_us, gesture_sched_stats_t *stats);
+
+/**
+ * @brief Name of a scheduler state
+ * @param state State
+ * @return "IDLE", "ACTIVE" or "COOLDOWN"
+ */
+const char *gesture_scheduler_state_name(gesture_sched_state_t state);
+
+#endif // GESTURE_SCHEDULER_H
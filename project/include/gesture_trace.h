@@ -0,0 +1,143 @@
+/**
+ * @file gesture_trace.h
+ * @brief Binary trace format for recording gesture samples on the device and replaying them elsewhere.
+ *
+ * A trace is a header, one configuration block per sensor and a list of fixed-size
+ * records, all little-endian and packed:
+ *
+ *     gesture_trace_header_t | gesture_trace_sensor_t x sensor_count | gesture_trace_record_t x record_count
+ *
+ * Capture keeps the newest GESTURE_TRACE_CAPACITY records in a RAM ring (a flight
+ * recorder). Replay only parses memory and has no ESP-IDF runtime dependencies, so
+ * the same code can feed recorded traces to the decoder on a host.
+ */
+
+#ifndef GESTURE_TRACE_H
+#define GESTURE_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "../include/apds9960_driver.h"
+#include "../include/gesture_ring.h"
+
+#define GESTURE_TRACE_CAPTURE 0       // Set to 1 to record samples and publish a trace after every unrecognized trajectory
+#define GESTURE_TRACE_MAGIC 0x43525447 // "GTRC"
+#define GESTURE_TRACE_VERSION 1
+#define GESTURE_TRACE_CAPACITY 1024    // Records kept in RAM (14 bytes each)
+#define GESTURE_TRACE_MAX_SENSORS APDS9960_BUS_MAX_DEVS
+
+/**
+ * @struct gesture_trace_header_t
+ * @brief Start of every trace.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;        // GESTURE_TRACE_MAGIC
+    uint16_t version;      // GESTURE_TRACE_VERSION
+    uint8_t record_size;   // sizeof(gesture_trace_record_t)
+    uint8_t sensor_count;  // Configuration blocks that follow
+    uint32_t record_count; // Records that follow the configuration blocks
+    uint32_t dropped;      // Records overwritten in RAM before the export
+    int64_t start_us;      // esp_timer time that record offsets are relative to
+} gesture_trace_header_t;
+
+/**
+ * @struct gesture_trace_sensor_t
+ * @brief Settings of one sensor that affect its gesture data.
+ */
+typedef struct __attribute__((packed)) {
+    int8_t mux_channel;
+    uint8_t ppulse;
+    uint8_t control;
+    uint8_t gpenth;
+    uint8_t gexth;
+    uint8_t gconf1;
+    uint8_t gconf2;
+    uint8_t gpulse;
+} gesture_trace_sensor_t;
+
+/**
+ * @struct gesture_trace_record_t
+ * @brief One recorded gesture_sample_t.
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t time_us;  // Offset from the header's start_us, wide enough for any uptime
+    uint8_t kind;      // gesture_sample_kind_t in bits 0-3, sensor index in bits 4-7
+    uint8_t pdata;
+    apds9960_gesture_dataset_t data;
+} gesture_trace_record_t;
+
+_Static_assert(sizeof(gesture_trace_header_t) == 24, "Trace header layout changed");
+_Static_assert(sizeof(gesture_trace_record_t) == 14, "Trace record layout changed");
+
+// Largest export produced by gesture_trace_export()
+#define GESTURE_TRACE_EXPORT_MAX (sizeof(gesture_trace_header_t) + \
+                                  GESTURE_TRACE_MAX_SENSORS * sizeof(gesture_trace_sensor_t) + \
+                                  GESTURE_TRACE_CAPACITY * sizeof(gesture_trace_record_t))
+
+/**
+ * @struct gesture_trace_t
+ * @brief RAM capture of the newest records, owned by one task.
+ */
+typedef struct {
+    gesture_trace_sensor_t sensors[GESTURE_TRACE_MAX_SENSORS];
+    uint8_t sensor_count;
+    gesture_trace_record_t records[GESTURE_TRACE_CAPACITY];
+    uint32_t recorded;  // Records written since the last reset
+    int64_t start_us;   // Timestamp of the first record since the last reset
+} gesture_trace_t;
+
+/**
+ * @brief Callback receiving replayed samples
+ * @param sample Sample rebuilt from a record, with an absolute timestamp
+ * @param ctx User context passed to gesture_trace_replay()
+ */
+typedef void (*gesture_trace_sink_t)(const gesture_sample_t *sample, void *ctx);
+
+/**
+ * @brief Start a capture and snapshot the configuration of the sensors it covers
+ * @param trace Capture
+ * @param devs Sensors, indexed like gesture_sample_t.sensor
+ * @param count Number of sensors
+ * @return esp_err_t
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_ARG: Too many sensors
+ */
+esp_err_t gesture_trace_init(gesture_trace_t *trace, apds9960_dev_t *const *devs, size_t count);
+
+/**
+ * @brief Drop all records, keeping the sensor configuration
+ * @param trace Capture
+ */
+void gesture_trace_reset(gesture_trace_t *trace);
+
+/**
+ * @brief Append a sample, overwriting the oldest record when the capture is full
+ * @param trace Capture
+ * @param sample Sample popped from the gesture ring
+ */
+void gesture_trace_record(gesture_trace_t *trace, const gesture_sample_t *sample);
+
+/**
+ * @brief Serialize the capture, oldest record first
+ * @param trace Capture
+ * @param out Output buffer, GESTURE_TRACE_EXPORT_MAX bytes always suffice
+ * @param size Size of out
+ * @return Bytes written, 0 if out is too small
+ */
+size_t gesture_trace_export(const gesture_trace_t *trace, uint8_t *out, size_t size);
+
+/**
+ * @brief Parse a serialized trace and hand every record to a sink, in order
+ * @param data Serialized trace
+ * @param size Size of data
+ * @param sink Called once per record
+ * @param ctx Passed through to sink
+ * @return esp_err_t
+ *         - ESP_OK: Success
+ *         - ESP_ERR_INVALID_VERSION: Unknown magic, version or record size
+ *         - ESP_ERR_INVALID_SIZE: Truncated trace
+ */
+esp_err_t gesture_trace_replay(const uint8_t *data, size_t size, gesture_trace_sink_t sink, void *ctx);
+
+#endif // GESTURE_TRACE_H
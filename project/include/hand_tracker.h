@@ -0,0 +1,66 @@
+/**
+ * @file hand_tracker.h
+ * @brief Continuous hand position and closeness from gesture FIFO datasets.
+ *
+ * Every dataset updates the lateral position (L/R balance) and closeness (U+D+L+R
+ * intensity), both Q15 and smoothed with a shift-based EMA so a light spot driven
+ * by them does not jitter. Proximity readings keep closeness current between FIFO
+ * bursts. PDATA and the photodiode sum have different gains, so each is scaled over
+ * its own in-range span and smoothed on its own; closeness is their mean.
+ */
+
+#ifndef HAND_TRACKER_H
+#define HAND_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "../include/gesture_decoder.h"
+
+#define HAND_TRACKER_SMOOTH_SHIFT 2 // EMA weight of a new sample is 1 / 2^shift
+#define HAND_TRACKER_INVERT 0       // Set to 1 if the spot moves opposite to the hand
+#define HAND_TRACKER_LEVEL_MIN (4 * (GESTURE_DECODER_THRESHOLD + 1)) // U+D+L+R of the faintest dataset tracked
+#define HAND_TRACKER_LEVEL_MAX (4 * 255)                             // Every channel saturated
+#define HAND_TRACKER_PDATA_MIN APDS9960_PROX_GATE                    // PDATA where a hand counts as present
+#define HAND_TRACKER_PDATA_MAX 255
+
+/**
+ * @struct hand_tracker_t
+ * @brief Tracker state for one sensor.
+ */
+typedef struct {
+    bool present;       // A hand is over the sensor
+    int32_t position;   // Q15 -1 (right) .. 1 (left), 0 is centred over the sensor
+    int32_t closeness;  // Q15 0 (far) .. 1 (touching)
+    int32_t level_closeness; // Q15, from the U+D+L+R sums alone
+    int32_t pdata_closeness; // Q15, from PDATA alone
+    bool pdata_valid;        // A proximity reading arrived since the hand appeared
+} hand_tracker_t;
+
+/**
+ * @brief Reset a tracker to "no hand"
+ * @param tracker Tracker
+ */
+void hand_tracker_init(hand_tracker_t *tracker);
+
+/**
+ * @brief Update from one FIFO dataset
+ * @param tracker Tracker
+ * @param dataset U/D/L/R sample, ignored unless all four channels see the hand
+ */
+void hand_tracker_update(hand_tracker_t *tracker, const apds9960_gesture_dataset_t *dataset);
+
+/**
+ * @brief Update closeness from a proximity reading
+ * @param tracker Tracker
+ * @param pdata PDATA register value, only used while a hand is present
+ */
+void hand_tracker_update_proximity(hand_tracker_t *tracker, uint8_t pdata);
+
+/**
+ * @brief Mark the hand as gone
+ * @param tracker Tracker
+ * @return true if a hand was present
+ */
+bool hand_tracker_lost(hand_tracker_t *tracker);
+
+#endif // HAND_TRACKER_H
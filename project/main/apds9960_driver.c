@@ -3,129 +3,509 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_bit_defs.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 
 static const char *TAG = "APDS9960";
 
-esp_err_t apds9960_i2c_init(void) {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+// Configuration registers inside the 0x80-0xAB shadow window, bit n covers register 0x80 + n:
+// ENABLE, ATIME, WTIME, AILTL-AIHTH, PILT, PIHT, PERS, CONFIG1, PPULSE, CONTROL, CONFIG2,
+// POFFSET_UR, POFFSET_DL, CONFIG3, GPENTH-GOFFSET_L, GOFFSET_R, GCONF3, GCONF4
+static const uint64_t s_shadow_config_mask = 0x00000EFFE001FAFBULL;
+
+static inline bool apds9960_is_config_reg(uint8_t reg) {
+    return reg >= APDS9960_SHADOW_FIRST && reg < APDS9960_SHADOW_FIRST + APDS9960_SHADOW_SIZE &&
+           (s_shadow_config_mask & BIT64(reg - APDS9960_SHADOW_FIRST));
+}
+
+static esp_err_t apds9960_add_i2c_device(apds9960_bus_t *bus, uint16_t addr, i2c_master_dev_handle_t *handle) {
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = addr,
+        .scl_speed_hz = I2C_MASTER_FREQ_HZ,
+    };
+    return i2c_master_bus_add_device(bus->handle, &dev_config, handle);
+}
+
+// Detaches every handle and deletes the bus, safe on a partially created bus
+static void apds9960_bus_destroy(apds9960_bus_t *bus) {
+    for (uint8_t n = 0; n < bus->num_devs; n++) {
+        if (bus->devs[n]->handle) {
+            i2c_master_bus_rm_device(bus->devs[n]->handle);
+            bus->devs[n]->handle = NULL;
+        }
+    }
+    if (bus->mux_handle) {
+        i2c_master_bus_rm_device(bus->mux_handle);
+        bus->mux_handle = NULL;
+    }
+    if (bus->handle) {
+        i2c_del_master_bus(bus->handle);
+        bus->handle = NULL;
+    }
+    bus->mux_channel = APDS9960_NO_MUX;
+}
+
+// Creates the bus and (re)attaches the mux and every sensor already registered on it.
+// All or nothing: on failure every handle is left NULL, which apds9960_transfer treats as a bus to recover
+static esp_err_t apds9960_bus_create(apds9960_bus_t *bus) {
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = bus->config.port,
+        .sda_io_num = bus->config.sda_io,
+        .scl_io_num = bus->config.scl_io,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .trans_queue_depth = 0, // Synchronous mode: transactions are built on the stack, nothing is allocated per access
+        .flags.enable_internal_pullup = true,
+    };
+    esp_err_t ret = i2c_new_master_bus(&bus_config, &bus->handle);
+    if (ret != ESP_OK) {
+        bus->handle = NULL;
+        return ret;
+    }
+
+    bus->mux_channel = APDS9960_NO_MUX;
+    if (bus->config.mux_addr) {
+        ret = apds9960_add_i2c_device(bus, bus->config.mux_addr, &bus->mux_handle);
+    }
+    for (uint8_t n = 0; n < bus->num_devs && ret == ESP_OK; n++) {
+        ret = apds9960_add_i2c_device(bus, APDS9960_I2C_ADDR, &bus->devs[n]->handle);
+    }
+    if (ret != ESP_OK) apds9960_bus_destroy(bus);
+    return ret;
+}
+
+esp_err_t apds9960_bus_init(apds9960_bus_t *bus, const apds9960_bus_config_t *config) {
+    if (bus == NULL || config == NULL) return ESP_ERR_INVALID_ARG;
+    *bus = (apds9960_bus_t) {
+        .config = *config,
+        .mux_channel = APDS9960_NO_MUX,
     };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &conf));
-    ESP_ERROR_CHECK(i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0));
-    ESP_LOGI(TAG, "I2C Master initialized.");
+    esp_err_t ret = apds9960_bus_create(bus);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "I2C bus %d init failed: %s", config->port, esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "I2C Master %d initialized%s.", config->port, config->mux_addr ? " with mux" : "");
+    return ESP_OK;
+}
+
+// Deadline covers the bytes on the wire (9 clocks each) plus I2C_MASTER_TIMEOUT_MS of slack
+static inline int apds9960_timeout_ms(size_t bytes) {
+    return I2C_MASTER_TIMEOUT_MS + (int)((bytes * 9 * 1000 + I2C_MASTER_FREQ_HZ - 1) / I2C_MASTER_FREQ_HZ);
+}
+
+// Route the mux to the sensor's channel, skipped when it is already selected
+static esp_err_t apds9960_mux_select(apds9960_dev_t *dev) {
+    apds9960_bus_t *bus = dev->bus;
+    if (dev->config.mux_channel == APDS9960_NO_MUX || bus->mux_channel == dev->config.mux_channel) {
+        return ESP_OK;
+    }
+    const uint8_t mask = 1 << dev->config.mux_channel;
+    esp_err_t ret = i2c_master_transmit(bus->mux_handle, &mask, 1, apds9960_timeout_ms(2));
+    dev->stats.transactions++;
+    if (ret != ESP_OK) {
+        bus->mux_channel = APDS9960_NO_MUX; // Unknown routing, force a switch next time
+        return ret;
+    }
+    bus->mux_channel = dev->config.mux_channel;
+    dev->stats.mux_switches++;
     return ESP_OK;
 }
 
-esp_err_t apds9960_write_byte(uint8_t reg, uint8_t value) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, value, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(I2C_MASTER_TIMEOUT_MS));
-    i2c_cmd_link_delete(cmd);
+static esp_err_t apds9960_transfer_once(apds9960_dev_t *dev, const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len) {
+    // Handles are NULL after a failed recovery, report it as a bus fault so the next access recovers again
+    bool detached = dev->handle == NULL || (dev->config.mux_channel != APDS9960_NO_MUX && dev->bus->mux_handle == NULL);
+    esp_err_t ret = detached ? ESP_ERR_INVALID_STATE : apds9960_mux_select(dev);
+    if (ret == ESP_OK) {
+        int timeout_ms = apds9960_timeout_ms(tx_len + rx_len + 2); // + address bytes
+        ret = rx_len ? i2c_master_transmit_receive(dev->handle, tx, tx_len, rx, rx_len, timeout_ms)
+                     : i2c_master_transmit(dev->handle, tx, tx_len, timeout_ms);
+        dev->stats.transactions++;
+    }
+    if (ret != ESP_OK) {
+        dev->stats.errors++;
+        if (ret == ESP_ERR_TIMEOUT) dev->stats.timeouts++;
+    }
+    return ret;
+}
+
+// Every bus access goes through here: a stuck bus or missing ACK triggers one recovery and a retry
+static esp_err_t apds9960_transfer(apds9960_dev_t *dev, const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len) {
+    esp_err_t ret = apds9960_transfer_once(dev, tx, tx_len, rx, rx_len);
+    if ((ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_INVALID_STATE) && !dev->bus->recovering) {
+        if (apds9960_bus_recover(dev) == ESP_OK) {
+            ret = apds9960_transfer_once(dev, tx, tx_len, rx, rx_len);
+        }
+    }
+    return ret;
+}
+
+esp_err_t apds9960_write_byte(apds9960_dev_t *dev, uint8_t reg, uint8_t value) {
+    const uint8_t buf[2] = {reg, value};
+    esp_err_t ret = apds9960_transfer(dev, buf, sizeof(buf), NULL, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Write to reg 0x%02X failed: %s", reg, esp_err_to_name(ret));
+    } else if (apds9960_is_config_reg(reg)) {
+        // Keep the shadow coherent with raw writes (self-clearing GFIFO_CLR is never cached)
+        dev->shadow[reg - APDS9960_SHADOW_FIRST] = reg == APDS9960_GCONF4 ? value & ~APDS9960_GCONF4_GFIFO_CLR : value;
+        dev->shadow_dirty &= ~BIT64(reg - APDS9960_SHADOW_FIRST);
+    }
+    return ret;
+}
+
+// Special function registers (e.g. AICLEAR) are triggered by an address-only write
+static esp_err_t apds9960_write_cmd(apds9960_dev_t *dev, uint8_t reg) {
+    esp_err_t ret = apds9960_transfer(dev, &reg, 1, NULL, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Command 0x%02X failed: %s", reg, esp_err_to_name(ret));
     }
     return ret;
 }
 
-esp_err_t apds9960_read_byte(uint8_t reg, uint8_t *data) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDR << 1) | I2C_MASTER_READ, true);
-    i2c_master_read_byte(cmd, data, I2C_MASTER_NACK);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(I2C_MASTER_TIMEOUT_MS));
-    i2c_cmd_link_delete(cmd);
+esp_err_t apds9960_read_byte(apds9960_dev_t *dev, uint8_t reg, uint8_t *data) {
+    esp_err_t ret = apds9960_transfer(dev, &reg, 1, data, 1);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Read from reg 0x%02X failed: %s", reg, esp_err_to_name(ret));
     }
     return ret;
 }
 
-esp_err_t apds9960_read_block(uint8_t reg, uint8_t *data, uint8_t len) {
+esp_err_t apds9960_read_block(apds9960_dev_t *dev, uint8_t reg, uint8_t *data, size_t len) {
     if (len == 0) return ESP_OK;
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true); // Send the register to read from
-    i2c_master_start(cmd); // Repeated start
-    i2c_master_write_byte(cmd, (APDS9960_I2C_ADDR << 1) | I2C_MASTER_READ, true);
-    if (len > 1) {
-        i2c_master_read(cmd, data, len - 1, I2C_MASTER_ACK);
-    }
-    i2c_master_read_byte(cmd, data + len - 1, I2C_MASTER_NACK); // Last byte with NACK
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(I2C_MASTER_TIMEOUT_MS));
-    i2c_cmd_link_delete(cmd);
+    // Register write followed by a repeated start and the burst read, the last byte is NACKed by the driver
+    esp_err_t ret = apds9960_transfer(dev, &reg, 1, data, len);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Read block from reg 0x%02X failed: %s", reg, esp_err_to_name(ret));
     }
     return ret;
 }
 
-esp_err_t apds9960_init(void) {
+esp_err_t apds9960_config_set(apds9960_dev_t *dev, uint8_t reg, uint8_t value) {
+    if (!apds9960_is_config_reg(reg)) return ESP_ERR_INVALID_ARG;
+    uint8_t idx = reg - APDS9960_SHADOW_FIRST;
+    if (dev->shadow[idx] != value) {
+        dev->shadow[idx] = value;
+        dev->shadow_dirty |= BIT64(idx);
+    }
+    return ESP_OK;
+}
+
+esp_err_t apds9960_config_update(apds9960_dev_t *dev, uint8_t reg, uint8_t mask, uint8_t value) {
+    if (!apds9960_is_config_reg(reg)) return ESP_ERR_INVALID_ARG;
+    uint8_t current = dev->shadow[reg - APDS9960_SHADOW_FIRST];
+    return apds9960_config_set(dev, reg, (current & ~mask) | (value & mask));
+}
+
+esp_err_t apds9960_config_get(apds9960_dev_t *dev, uint8_t reg, uint8_t *value) {
+    if (value == NULL || !apds9960_is_config_reg(reg)) return ESP_ERR_INVALID_ARG;
+    *value = dev->shadow[reg - APDS9960_SHADOW_FIRST];
+    return ESP_OK;
+}
+
+esp_err_t apds9960_config_commit(apds9960_dev_t *dev) {
+    uint8_t buf[1 + APDS9960_SHADOW_SIZE]; // Register address followed by the run's values
+    uint8_t idx = 0;
+    while (dev->shadow_dirty != 0 && idx < APDS9960_SHADOW_SIZE) {
+        if (!(dev->shadow_dirty & BIT64(idx))) {
+            idx++;
+            continue;
+        }
+        // Extend the run while the following registers are dirty too, the address auto-increments on writes
+        uint8_t run = 0;
+        buf[0] = APDS9960_SHADOW_FIRST + idx;
+        while (idx + run < APDS9960_SHADOW_SIZE && (dev->shadow_dirty & BIT64(idx + run))) {
+            buf[1 + run] = dev->shadow[idx + run];
+            run++;
+        }
+        esp_err_t ret = apds9960_transfer(dev, buf, 1 + run, NULL, 0);
+        if (ret != ESP_OK) {
+            // Leave the run dirty so the next commit retries it
+            ESP_LOGE(TAG, "Burst write of %d regs from 0x%02X failed: %s", run, buf[0], esp_err_to_name(ret));
+            return ret;
+        }
+        dev->shadow_dirty &= ~((BIT64(run) - 1) << idx);
+        idx += run;
+    }
+    return ESP_OK;
+}
+
+// Rewrite the sensor from the shadow, with the same ordering as apds9960_init (ENABLE, then GCONF4 last)
+static esp_err_t apds9960_config_restore(apds9960_dev_t *dev) {
+    const uint64_t enable_bit = BIT64(APDS9960_ENABLE - APDS9960_SHADOW_FIRST);
+    const uint64_t gconf4_bit = BIT64(APDS9960_GCONF4 - APDS9960_SHADOW_FIRST);
+    // GMODE belongs to the sensor, which clears it when it leaves the gesture engine: the shadow copy is stale,
+    // so GCONF4 goes back with the GMODE the sensor holds now
+    uint8_t gconf4 = 0;
+    esp_err_t ret = apds9960_read_byte(dev, APDS9960_GCONF4, &gconf4);
+    if (ret != ESP_OK) return ret;
+    uint8_t *shadow_gconf4 = &dev->shadow[APDS9960_GCONF4 - APDS9960_SHADOW_FIRST];
+    *shadow_gconf4 = (*shadow_gconf4 & ~APDS9960_GCONF4_GMODE) | (gconf4 & APDS9960_GCONF4_GMODE);
+    dev->shadow_dirty = s_shadow_config_mask & ~(enable_bit | gconf4_bit);
+    ret = apds9960_config_commit(dev);
+    if (ret != ESP_OK) return ret;
+    dev->shadow_dirty = enable_bit;
+    ret = apds9960_config_commit(dev);
+    if (ret != ESP_OK) return ret;
+    dev->shadow_dirty = gconf4_bit;
+    return apds9960_config_commit(dev);
+}
+
+// Clock out a slave holding SDA low, then issue a STOP condition by hand
+static void apds9960_bus_unstick(const apds9960_bus_config_t *config) {
+    const uint32_t half_period_us = 500000 / I2C_MASTER_FREQ_HZ + 1;
+    gpio_set_direction(config->sda_io, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(config->scl_io, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level(config->sda_io, 1);
+    for (int clk = 0; clk < 9 && gpio_get_level(config->sda_io) == 0; clk++) {
+        gpio_set_level(config->scl_io, 0);
+        esp_rom_delay_us(half_period_us);
+        gpio_set_level(config->scl_io, 1);
+        esp_rom_delay_us(half_period_us);
+    }
+    gpio_set_level(config->scl_io, 0);
+    gpio_set_level(config->sda_io, 0);
+    esp_rom_delay_us(half_period_us);
+    gpio_set_level(config->scl_io, 1);
+    esp_rom_delay_us(half_period_us);
+    gpio_set_level(config->sda_io, 1); // SDA rising while SCL is high = STOP
+    esp_rom_delay_us(half_period_us);
+}
+
+esp_err_t apds9960_bus_recover(apds9960_dev_t *dev) {
+    apds9960_bus_t *bus = dev->bus;
+    if (bus->recovering) return ESP_ERR_INVALID_STATE;
+    bus->recovering = true;
+    int64_t start_us = esp_timer_get_time();
+    ESP_LOGW(TAG, "Recovering I2C bus %d...", bus->config.port);
+
+    apds9960_bus_destroy(bus);
+    apds9960_bus_unstick(&bus->config);
+    esp_err_t ret = apds9960_bus_create(bus);
+    // Every sensor on the bus may have seen the glitch, bring them all back
+    for (uint8_t n = 0; n < bus->num_devs && ret == ESP_OK; n++) {
+        if (bus->devs[n]->shadow_valid) {
+            ret = apds9960_config_restore(bus->devs[n]);
+        }
+    }
+
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start_us);
+    dev->stats.last_recovery_us = elapsed_us;
+    if (elapsed_us > dev->stats.max_recovery_us) dev->stats.max_recovery_us = elapsed_us;
+    if (ret == ESP_OK) {
+        dev->stats.recoveries++;
+        ESP_LOGW(TAG, "I2C bus recovered in %lu us.", (unsigned long)elapsed_us);
+    } else {
+        dev->stats.recovery_failures++;
+        ESP_LOGE(TAG, "I2C bus recovery failed: %s", esp_err_to_name(ret));
+    }
+    bus->recovering = false;
+    return ret;
+}
+
+esp_err_t apds9960_get_stats(apds9960_dev_t *dev, apds9960_stats_t *stats) {
+    if (stats == NULL) return ESP_ERR_INVALID_ARG;
+    *stats = dev->stats;
+    return ESP_OK;
+}
+
+size_t apds9960_schedule_start(apds9960_dev_t *const *devs, size_t count) {
+    for (size_t n = 0; n < count; n++) {
+        if (devs[n]->config.mux_channel != APDS9960_NO_MUX && devs[n]->config.mux_channel == devs[n]->bus->mux_channel) {
+            return n;
+        }
+    }
+    return 0;
+}
+
+// Unregister a sensor from its bus and drop its device handle
+static void apds9960_bus_detach(apds9960_dev_t *dev) {
+    apds9960_bus_t *bus = dev->bus;
+    for (uint8_t n = 0; n < bus->num_devs; n++) {
+        if (bus->devs[n] == dev) {
+            bus->devs[n] = bus->devs[--bus->num_devs];
+            break;
+        }
+    }
+    if (dev->handle) {
+        i2c_master_bus_rm_device(dev->handle);
+        dev->handle = NULL;
+    }
+    dev->shadow_valid = false;
+}
+
+esp_err_t apds9960_init(apds9960_dev_t *dev, apds9960_bus_t *bus, const apds9960_dev_config_t *config) {
+    if (dev == NULL || bus == NULL || config == NULL) return ESP_ERR_INVALID_ARG;
+    if (bus->num_devs >= APDS9960_BUS_MAX_DEVS) return ESP_ERR_INVALID_ARG;
+    if (config->mux_channel >= APDS9960_MUX_CHANNELS || (config->mux_channel != APDS9960_NO_MUX && !bus->config.mux_addr)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *dev = (apds9960_dev_t) {
+        .bus = bus,
+        .config = *config,
+    };
+    if (apds9960_add_i2c_device(bus, APDS9960_I2C_ADDR, &dev->handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add sensor to I2C bus %d.", bus->config.port);
+        return ESP_FAIL;
+    }
+    bus->devs[bus->num_devs++] = dev;
+
     uint8_t id = 0;
-    if (apds9960_read_byte(APDS9960_ID, &id) != ESP_OK) {
+    if (apds9960_read_byte(dev, APDS9960_ID, &id) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to read sensor ID during init.");
-        return ESP_FAIL;
+        goto fail;
     }
 
     if (id != APDS9960_ID_EXPECTED && id != 0xAB && id != 0xA8) {
         ESP_LOGE(TAG, "Wrong ID: 0x%02X. Expected 0x9E, 0xAB, or 0xA8.", id);
-        return ESP_FAIL;
+        goto fail;
     }
-    ESP_LOGI(TAG, "Sensor ID verified: 0x%02X", id);
+    ESP_LOGI(TAG, "Sensor ID verified: 0x%02X (mux channel %d)", id, config->mux_channel);
+
+    // Seed the shadow with the current register contents in one burst
+    if (apds9960_read_block(dev, APDS9960_SHADOW_FIRST, dev->shadow, APDS9960_SHADOW_SIZE) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read configuration registers during init.");
+        goto fail;
+    }
+    dev->shadow[APDS9960_GCONF4 - APDS9960_SHADOW_FIRST] &= ~APDS9960_GCONF4_GFIFO_CLR;
+    dev->shadow_dirty = 0;
+    dev->shadow_valid = true;
 
     ESP_LOGI(TAG, "Configuring APDS-9960...");
-    apds9960_write_byte(APDS9960_ENABLE, 0x00); // Disable everything first
+    apds9960_config_set(dev, APDS9960_ENABLE, 0x00); // Disable everything first
+    apds9960_config_commit(dev);
     vTaskDelay(pdMS_TO_TICKS(10));
 
     // Proximity Configuration
     ESP_LOGI(TAG, "Setting Proximity: PPULSE to 0x5F (32 pulses, 16us), CONTROL to 0x0C (PGAIN 8x)");
-    apds9960_write_byte(APDS9960_PPULSE, 0x5F);
-    apds9960_write_byte(APDS9960_CONTROL, 0x0C);
-
-    // Gesture Configuration
-    apds9960_write_byte(APDS9960_GPENTH, 40);
-    apds9960_write_byte(APDS9960_GEXTH, 30);
-    apds9960_write_byte(APDS9960_GCONF1, 0x40);
-    apds9960_write_byte(APDS9960_GCONF2, 0x20);
-    apds9960_write_byte(APDS9960_GPULSE, 0xC9);
-
-    // Enable Power (PON), Proximity (PEN), and Gesture (GEN)
-    apds9960_write_byte(APDS9960_ENABLE, 0x45); // PON | PEN | GEN = 0b01000101
+    apds9960_config_set(dev, APDS9960_PPULSE, 0x5F);
+    apds9960_config_set(dev, APDS9960_CONTROL, 0x0C);
+    apds9960_config_set(dev, APDS9960_PILT, 0);
+    apds9960_config_set(dev, APDS9960_PIHT, APDS9960_PROX_GATE); // PINT only once a hand is within range
+    apds9960_config_set(dev, APDS9960_PERS, APDS9960_PPERS_DEFAULT << 4);
+
+    // Gesture Configuration (GPENTH-GCONF2 are contiguous and go out as one burst)
+    apds9960_config_set(dev, APDS9960_GPENTH, APDS9960_PROX_GATE); // The FIFO (and GINT) only fills inside the gate
+    apds9960_config_set(dev, APDS9960_GEXTH, 30);
+    apds9960_config_set(dev, APDS9960_GCONF1, 0x40);
+    apds9960_config_set(dev, APDS9960_GCONF2, 0x20);
+    apds9960_config_set(dev, APDS9960_GPULSE, 0xC9);
+    apds9960_config_commit(dev);
+
+    // Enable Power (PON), Proximity (PEN), Proximity Interrupt (PIEN) and Gesture (GEN)
+    apds9960_config_set(dev, APDS9960_ENABLE, APDS9960_ENABLE_PON | APDS9960_ENABLE_PEN | APDS9960_ENABLE_PIEN | APDS9960_ENABLE_GEN); // 0x65
+    apds9960_config_commit(dev);
     vTaskDelay(pdMS_TO_TICKS(10));
 
-    // Enable Gesture Mode (GMODE=1) in GCONF4
-    apds9960_write_byte(APDS9960_GCONF4, 0x01); // GMODE=1
-    ESP_LOGI(TAG, "APDS-9960 configured and gesture mode enabled.");
+    // Enable Gesture Mode (GMODE=1) and Gesture Interrupt (GIEN=1) in GCONF4
+    apds9960_config_set(dev, APDS9960_GCONF4, APDS9960_GCONF4_GMODE | APDS9960_GCONF4_GIEN); // 0x03
+    if (apds9960_config_commit(dev) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write sensor configuration.");
+        goto fail;
+    }
+    apds9960_clear_interrupts(dev);
+    ESP_LOGI(TAG, "APDS-9960 configured, gesture mode and interrupts enabled.");
     
     return ESP_OK;
+
+fail:
+    apds9960_bus_detach(dev); // A sensor that failed init must not be re-attached by a later recovery
+    return ESP_FAIL;
+}
+
+esp_err_t apds9960_read_proximity(apds9960_dev_t *dev, uint8_t *proximity) {
+    return apds9960_read_byte(dev, APDS9960_PDATA, proximity);
+}
+
+esp_err_t apds9960_read_gesture_status(apds9960_dev_t *dev, uint8_t *status) {
+    return apds9960_read_byte(dev, APDS9960_GSTATUS, status);
+}
+
+esp_err_t apds9960_read_gesture_fifo_level(apds9960_dev_t *dev, uint8_t *level) {
+    return apds9960_read_byte(dev, APDS9960_GFLVL, level);
+}
+
+esp_err_t apds9960_read_gesture_fifo_data(apds9960_dev_t *dev, uint8_t *fifo_data) {
+    return apds9960_read_block(dev, APDS9960_GFIFO_U, fifo_data, 4);
+}
+
+esp_err_t apds9960_read_snapshot(apds9960_dev_t *dev, apds9960_snapshot_t *snap) {
+    if (snap == NULL) return ESP_ERR_INVALID_ARG;
+    // Reading 0x9C-0xAF in one go would clock 17 unused bytes, two short transactions are cheaper
+    esp_err_t ret = apds9960_read_byte(dev, APDS9960_PDATA, &snap->pdata);
+    if (ret != ESP_OK) return ret;
+    uint8_t gesture_regs[2]; // GFLVL, GSTATUS
+    ret = apds9960_read_block(dev, APDS9960_GFLVL, gesture_regs, sizeof(gesture_regs));
+    if (ret != ESP_OK) return ret;
+    snap->gflvl = gesture_regs[0];
+    snap->gstatus = gesture_regs[1];
+    return ESP_OK;
+}
+
+_Static_assert(sizeof(apds9960_gesture_dataset_t) == 4, "FIFO datasets are read straight into the array");
+
+esp_err_t apds9960_read_gesture_fifo(apds9960_dev_t *dev, uint8_t level, apds9960_gesture_dataset_t *datasets) {
+    if (datasets == NULL) return ESP_ERR_INVALID_ARG;
+    if (level == 0 || level > APDS9960_GFIFO_DATASETS_MAX) return ESP_ERR_INVALID_SIZE;
+    // The FIFO pointer auto-increments through 0xFC-0xFF and wraps, so one burst drains all datasets
+    return apds9960_read_block(dev, APDS9960_GFIFO_U, (uint8_t *)datasets, level * sizeof(apds9960_gesture_dataset_t));
+}
+
+static void IRAM_ATTR apds9960_int_isr(void *arg) {
+    BaseType_t higher_prio_woken = pdFALSE;
+    vTaskNotifyGiveFromISR((TaskHandle_t)arg, &higher_prio_woken);
+    portYIELD_FROM_ISR(higher_prio_woken);
+}
+
+esp_err_t apds9960_int_init(apds9960_dev_t *dev, TaskHandle_t notify_task) {
+    if (notify_task == NULL) return ESP_ERR_INVALID_ARG;
+    if (dev->config.int_io == GPIO_NUM_NC) return ESP_OK; // Polled via the fallback timeout only
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << dev->config.int_io,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE, // INT is open-drain
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "INT GPIO config failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) { // Already installed is fine
+        ESP_LOGE(TAG, "GPIO ISR service install failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = gpio_isr_handler_add(dev->config.int_io, apds9960_int_isr, notify_task);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "INT ISR handler add failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ESP_LOGI(TAG, "INT routed to GPIO %d.", dev->config.int_io);
+    return ESP_OK;
 }
 
-esp_err_t apds9960_read_proximity(uint8_t *proximity) {
-    return apds9960_read_byte(APDS9960_PDATA, proximity);
+esp_err_t apds9960_enable_gesture_interrupt(apds9960_dev_t *dev, bool enable) {
+    apds9960_config_update(dev, APDS9960_GCONF4, APDS9960_GCONF4_GIEN, enable ? APDS9960_GCONF4_GIEN : 0);
+    return apds9960_config_commit(dev);
 }
 
-esp_err_t apds9960_read_gesture_status(uint8_t *status) {
-    return apds9960_read_byte(APDS9960_GSTATUS, status);
+esp_err_t apds9960_enable_proximity_interrupt(apds9960_dev_t *dev, bool enable) {
+    apds9960_config_update(dev, APDS9960_ENABLE, APDS9960_ENABLE_PIEN, enable ? APDS9960_ENABLE_PIEN : 0);
+    return apds9960_config_commit(dev);
 }
 
-esp_err_t apds9960_read_gesture_fifo_level(uint8_t *level) {
-    return apds9960_read_byte(APDS9960_GFLVL, level);
+esp_err_t apds9960_clear_interrupts(apds9960_dev_t *dev) {
+    return apds9960_write_cmd(dev, APDS9960_AICLEAR);
 }
 
-esp_err_t apds9960_read_gesture_fifo_data(uint8_t *fifo_data) {
-    return apds9960_read_block(APDS9960_GFIFO_U, fifo_data, 4);
-}
\ No newline at end of file
+esp_err_t apds9960_clear_gesture_fifo(apds9960_dev_t *dev) {
+    // GMODE in the shadow is stale, the sensor clears it when it leaves the gesture engine; writing it back
+    // would force the engine on again with no hand present
+    uint8_t gconf4 = dev->shadow[APDS9960_GCONF4 - APDS9960_SHADOW_FIRST] & ~APDS9960_GCONF4_GMODE;
+    return apds9960_write_byte(dev, APDS9960_GCONF4, gconf4 | APDS9960_GCONF4_GFIFO_CLR);
+}
@@ -12,6 +12,15 @@ void publish(const char* topic, const char* message) {
     }
 }
 
+void publish_binary(const char* topic, const void* data, size_t len) {
+    if (mqtt_connected && mqtt_client) {
+        esp_mqtt_client_publish(mqtt_client, topic, data, len, 0, 0);
+        ESP_LOGI("MQTT", "Published %d bytes to topic '%s'", (int)len, topic);
+    } else {
+        ESP_LOGW("MQTT", "MQTT not connected, %d bytes not published to '%s'", (int)len, topic);
+    }
+}
+
 void wifi_init() {
     esp_netif_init();
     esp_event_loop_create_default();
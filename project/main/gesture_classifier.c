@@ -0,0 +1,61 @@
+#include "../include/gesture_classifier.h"
+#include <stdlib.h>
+#if GESTURE_CLASSIFIER_PROFILE
+#include "esp_cpu.h"
+#endif
+
+void gesture_classifier_init(gesture_classifier_t *cls) {
+    *cls = (gesture_classifier_t) {0};
+}
+
+void gesture_classifier_features(const gesture_result_t *result, int32_t features[GESTURE_FEATURE_COUNT]) {
+    int32_t ud_mag = abs(result->ud_delta);
+    int32_t lr_mag = abs(result->lr_delta);
+    features[GESTURE_FEATURE_UD_DELTA] = result->ud_delta;
+    features[GESTURE_FEATURE_LR_DELTA] = result->lr_delta;
+    features[GESTURE_FEATURE_AXIS_MARGIN] = ud_mag - lr_mag;
+    features[GESTURE_FEATURE_MOTION] = ud_mag > lr_mag ? ud_mag : lr_mag;
+    features[GESTURE_FEATURE_SAMPLES] = result->samples;
+    features[GESTURE_FEATURE_ENTRY_LEVEL] = result->entry_level;
+    features[GESTURE_FEATURE_PEAK_LEVEL] = result->peak_level;
+    features[GESTURE_FEATURE_LEVEL_DELTA] = (int32_t)result->exit_level - (int32_t)result->entry_level;
+}
+
+gesture_t gesture_classifier_predict(const gesture_result_t *result) {
+    int32_t features[GESTURE_FEATURE_COUNT];
+    gesture_classifier_features(result, features);
+
+    // The depth bound keeps a corrupt table from looping
+    uint16_t idx = 0;
+    for (int depth = 0; depth <= GESTURE_TREE_MAX_DEPTH && idx < gesture_model_node_count; depth++) {
+        const gesture_tree_node_t *node = &gesture_model_nodes[idx];
+        if (node->feature == GESTURE_TREE_LEAF) return (gesture_t)node->label;
+        if (node->feature >= GESTURE_FEATURE_COUNT) break;
+        idx = features[node->feature] <= node->threshold ? idx + 1 : node->right;
+    }
+    return GESTURE_NONE;
+}
+
+static gesture_t gesture_classifier_step(gesture_classifier_t *cls, const gesture_result_t *result, int64_t end_us) {
+    gesture_t gesture = gesture_classifier_predict(result);
+    if (gesture != GESTURE_TAP) return gesture;
+
+    if (cls->last_tap_us != 0 && end_us - cls->last_tap_us <= GESTURE_DOUBLE_TAP_WINDOW_US) {
+        cls->last_tap_us = 0;
+        return GESTURE_DOUBLE_TAP;
+    }
+    cls->last_tap_us = end_us;
+    return GESTURE_TAP;
+}
+
+gesture_t gesture_classifier_run(gesture_classifier_t *cls, const gesture_result_t *result, int64_t end_us) {
+#if GESTURE_CLASSIFIER_PROFILE
+    uint32_t start = esp_cpu_get_cycle_count();
+    gesture_t gesture = gesture_classifier_step(cls, result, end_us);
+    cls->profile_cycles += esp_cpu_get_cycle_count() - start;
+    cls->profile_runs++;
+    return gesture;
+#else
+    return gesture_classifier_step(cls, result, end_us);
+#endif
+}
@@ -0,0 +1,104 @@
+#include "../include/gesture_decoder.h"
+#include <stdlib.h>
+#if GESTURE_DECODER_PROFILE
+#include "esp_cpu.h"
+#endif
+
+void gesture_decoder_init(gesture_decoder_t *dec) {
+    *dec = (gesture_decoder_t) {0};
+}
+
+// Exponential moving average, the arithmetic shift rounds towards -inf identically on host and target
+static inline int32_t gesture_smooth(int32_t avg, int32_t sample) {
+    return avg + ((sample - avg) >> GESTURE_DECODER_SMOOTH_SHIFT);
+}
+
+static bool gesture_decoder_step(gesture_decoder_t *dec, const apds9960_gesture_dataset_t *dataset, gesture_result_t *result) {
+    bool present = dataset->u > GESTURE_DECODER_THRESHOLD && dataset->d > GESTURE_DECODER_THRESHOLD &&
+                   dataset->l > GESTURE_DECODER_THRESHOLD && dataset->r > GESTURE_DECODER_THRESHOLD;
+    if (!present) {
+        // The first dataset below threshold marks the exit
+        return gesture_decoder_finish(dec, result);
+    }
+
+    int32_t ud = gesture_ratio_q15(dataset->u, dataset->d);
+    int32_t lr = gesture_ratio_q15(dataset->l, dataset->r);
+    uint16_t level = dataset->u + dataset->d + dataset->l + dataset->r;
+    if (!dec->active) {
+        dec->active = true;
+        dec->samples = 0;
+        dec->ud_entry = dec->ud_exit = ud;
+        dec->lr_entry = dec->lr_exit = lr;
+        dec->entry_level = dec->peak_level = dec->exit_level = level;
+    } else {
+        dec->ud_exit = gesture_smooth(dec->ud_exit, ud);
+        dec->lr_exit = gesture_smooth(dec->lr_exit, lr);
+        dec->exit_level = gesture_smooth(dec->exit_level, level);
+        if (level > dec->peak_level) dec->peak_level = level;
+    }
+    if (dec->samples < UINT16_MAX) dec->samples++;
+    return false;
+}
+
+bool gesture_decoder_push(gesture_decoder_t *dec, const apds9960_gesture_dataset_t *dataset, gesture_result_t *result) {
+#if GESTURE_DECODER_PROFILE
+    uint32_t start = esp_cpu_get_cycle_count();
+    bool done = gesture_decoder_step(dec, dataset, result);
+    dec->profile_cycles += esp_cpu_get_cycle_count() - start;
+    dec->profile_pushes++;
+    return done;
+#else
+    return gesture_decoder_step(dec, dataset, result);
+#endif
+}
+
+bool gesture_decoder_finish(gesture_decoder_t *dec, gesture_result_t *result) {
+    if (!dec->active) return false;
+    dec->active = false;
+
+    int32_t ud_delta = dec->ud_exit - dec->ud_entry;
+    int32_t lr_delta = dec->lr_exit - dec->lr_entry;
+    int32_t ud_mag = abs(ud_delta);
+    int32_t lr_mag = abs(lr_delta);
+    *result = (gesture_result_t) {
+        .gesture = GESTURE_NONE,
+        .ud_delta = ud_delta,
+        .lr_delta = lr_delta,
+        .samples = dec->samples,
+        .entry_level = dec->entry_level,
+        .peak_level = dec->peak_level,
+        .exit_level = dec->exit_level,
+    };
+    if (dec->samples < GESTURE_DECODER_MIN_SAMPLES) return true;
+
+    // With the sensor's default orientation an upward swipe drives the UD ratio down, a leftward one the LR ratio
+    int32_t dominant = ud_mag >= lr_mag ? ud_mag : lr_mag;
+    int32_t other = ud_mag >= lr_mag ? lr_mag : ud_mag;
+    if (dominant < GESTURE_DECODER_SENSITIVITY) return true;
+    if (ud_mag >= lr_mag) {
+        result->gesture = ud_delta < 0 ? GESTURE_UP : GESTURE_DOWN;
+    } else {
+        result->gesture = lr_delta < 0 ? GESTURE_LEFT : GESTURE_RIGHT;
+    }
+
+    // Full strength at a delta of 1 (half the ratio span), scaled by the margin over the other axis.
+    // strength <= 2^15 and the margin <= 2^16, so the product fits in 32 unsigned bits.
+    uint32_t strength = dominant > GESTURE_Q15_ONE ? GESTURE_Q15_ONE : dominant;
+    result->confidence = (int32_t)(strength * (uint32_t)(dominant - other) / (uint32_t)dominant);
+    return true;
+}
+
+const char *gesture_decoder_name(gesture_t gesture) {
+    switch (gesture) {
+    case GESTURE_UP: return "UP";
+    case GESTURE_DOWN: return "DOWN";
+    case GESTURE_LEFT: return "LEFT";
+    case GESTURE_RIGHT: return "RIGHT";
+    case GESTURE_HOLD: return "HOLD";
+    case GESTURE_APPROACH: return "APPROACH";
+    case GESTURE_RETREAT: return "RETREAT";
+    case GESTURE_TAP: return "TAP";
+    case GESTURE_DOUBLE_TAP: return "DOUBLE_TAP";
+    default: return "NONE";
+    }
+}
@@ -1,24 +1,32 @@
 #include "../include/gesture_led_strip.h"
 #include "../include/comms.h"
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "esp_bit_defs.h"
 
 static const char *TAG_LED = "LED_STRIP";
-TaskHandle_t chromatic_task_handle = NULL;
-TaskHandle_t shift_chromatic_task_handle = NULL;
-volatile bool chromatic_active = false;
-volatile bool shift_chromatic_active = false;
+static QueueHandle_t led_queue = NULL;
+static TaskHandle_t led_render_task_handle = NULL;
+static esp_timer_handle_t led_frame_timer = NULL;
+static led_render_stats_t render_stats;
+static portMUX_TYPE render_stats_lock = portMUX_INITIALIZER_UNLOCKED;
 
+#define LED_NOTIFY_FRAME   BIT0 // Frame clock tick
+#define LED_NOTIFY_COMMAND BIT1 // Command queued
+static led_effect_t current_effect = LED_EFFECT_SOLID; // Last effect requested by blink_led()
 
+/* Full range, LED_BRIGHTNESS and LED_GAMMA are applied by the strip while encoding */
 rgb_t led_colors[] = {
-    {74, 0, 105},    // Violet (50% brightness)
-    {69, 21, 113},   // Blue Violet (50% brightness)
-    {37, 0, 65},     // Indigo (50% brightness)
-    {0, 0, 128},     // Blue (50% brightness)
-    {0, 128, 128},   // Cyan (50% brightness)
-    {0, 128, 0},     // Green (50% brightness)
-    {128, 128, 0},   // Yellow (50% brightness)
-    {128, 83, 0},    // Orange (50% brightness)
-    {128, 34, 0},    // Red Orange (50% brightness)
-    {128, 0, 0}      // Red (50% brightness)
+    {148, 0, 211},   // Violet
+    {138, 43, 226},  // Blue Violet
+    {75, 0, 130},    // Indigo
+    {0, 0, 255},     // Blue
+    {0, 255, 255},   // Cyan
+    {0, 255, 0},     // Green
+    {255, 255, 0},   // Yellow
+    {255, 165, 0},   // Orange
+    {255, 69, 0},    // Red Orange
+    {255, 0, 0}      // Red
 };
 
 // Color names array that matches the colors
@@ -38,71 +46,71 @@ const char* color_names[] = {
 uint8_t s_led_state = 0;
 int8_t i = 0; // Index for the current color in led_colors
 led_strip_handle_t led_strip;
+static led_strip_handle_t spi_output; // The SPI strip, led_strip is the multi strip over it with LED_STRIP_SPLIT_GPIO
 
-const char* blink_led(uint8_t gesture)
+static void led_send(const led_command_t *cmd)
 {
-    // Stop chromatic if running and a new gesture is received
-    if (gesture != 1 && chromatic_active) {
-        chromatic_active = false;
-        vTaskDelay(pdMS_TO_TICKS(50)); // Give the task time to end gracefully
-    }
-    // Stop shift chromatic if running and a new gesture is received
-    if (gesture != 2 && shift_chromatic_active) {
-        shift_chromatic_active = false;
-        vTaskDelay(pdMS_TO_TICKS(50)); // Give the task time to end gracefully
+    /* Never wait on the render task, a full queue means newer commands are already pending */
+    if (xQueueSend(led_queue, cmd, 0) != pdTRUE) {
+        ESP_LOGW(TAG_LED, "Render queue full, command dropped");
+        return;
     }
+    xTaskNotify(led_render_task_handle, LED_NOTIFY_COMMAND, eSetBits);
+}
+
+static void led_frame_timer_cb(void *arg)
+{
+    xTaskNotify(led_render_task_handle, LED_NOTIFY_FRAME, eSetBits);
+}
+
+const char* blink_led(uint8_t gesture)
+{
+    led_command_t cmd = { .effect = LED_EFFECT_HOLD };
 
     /* If the addressable LED is enabled */
     switch (gesture)
     {
     case 1:
         /* If gesture is up, make a chromatic change */
-        if (!chromatic_active) {
-            chromatic_active = true;
-            xTaskCreate(chromatic_effect_task, "chromatic", 2048, NULL, 5, &chromatic_task_handle);
-        }
-        break;
-        
-
+        if (current_effect == LED_EFFECT_CHROMATIC) return color_names[i];
+        cmd.effect = LED_EFFECT_CHROMATIC;
+        publish("esp32/color", "Chromatic Effect");
         break;
     case 2:
         /* If gesture is down, shift chromatic effect */
-        if (!shift_chromatic_active) {
-            shift_chromatic_active = true;
-            xTaskCreate(shift_chromatic_effect_task, "shift_chromatic", 2048, NULL, 5, NULL);
-        }
+        if (current_effect == LED_EFFECT_SHIFT_CHROMATIC) return color_names[i];
+        cmd.effect = LED_EFFECT_SHIFT_CHROMATIC;
+        publish("esp32/color", "Shift Chromatic Effect");
         break;
     case 3:
         /* If the gesture is left, decrease the index */
         i--;
         if (i < 0) i = sizeof(led_colors) / sizeof(led_colors[0]) - 1; // Wrap around
         ESP_LOGI(TAG_LED, "Gesture LEFT detected, changing color to index %d", i);
-        for(int j = 0; j < 29; j++) {
-            led_strip_set_pixel(led_strip, j, led_colors[i].r, led_colors[i].g, led_colors[i].b);
-        }
+        cmd.effect = LED_EFFECT_SOLID;
+        cmd.color = i;
 
         //* Publish the new color name to MQTT */
         publish("esp32/color", color_names[i]);
-
         break;
     case 4:
         /* If the gesture is right, increase the index */
         i++;
         if (i >= sizeof(led_colors) / sizeof(led_colors[0])) i = 0; // Wrap around
         ESP_LOGI(TAG_LED, "Gesture RIGHT detected, changing color to index %d", i);
-        for(int j = 0; j < 29; j++) {
-            led_strip_set_pixel(led_strip, j, led_colors[i].r, led_colors[i].g, led_colors[i].b);
-        }
+        cmd.effect = LED_EFFECT_SOLID;
+        cmd.color = i;
 
         //* Publish the new color name to MQTT */
         publish("esp32/color", color_names[i]);
         break;
     default:
+        /* Any other gesture stops a running effect and keeps the pixels */
         break;
     }
 
-    /* Refresh the strip to send data */
-    led_strip_refresh(led_strip);
+    current_effect = cmd.effect;
+    led_send(&cmd);
     return color_names[i];
 }
 
@@ -112,57 +120,219 @@ void configure_led(void)
     /* LED strip initialization with the GPIO and pixels number*/
     led_strip_config_t strip_config = {
         .strip_gpio_num = LED_STRIP_GPIO,
-        .max_leds = 30, // at least one LED on board
+        .max_leds = LED_STRIP_MAX_LEDS,
     };
+#if LED_STRIP_SPLIT_GPIO >= 0
+    strip_config.max_leds = LED_STRIP_MAX_LEDS / 2;
+#endif
 
     led_strip_spi_config_t spi_config = {
         .spi_bus = SPI2_HOST,
         .flags.with_dma = true,
+        .flags.async_refresh = !LED_STRIP_STREAM, // Render the next frame while DMA sends this one
+        .flags.stream_encode = LED_STRIP_STREAM,
     };
     ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &led_strip));
+    spi_output = led_strip;
+
+#if LED_STRIP_SPLIT_GPIO >= 0
+    /* Upper half on an RMT channel, one logical strip over both so the effects do not know about the split */
+    led_strip_handle_t upper_strip;
+    led_strip_config_t upper_config = {
+        .strip_gpio_num = LED_STRIP_SPLIT_GPIO,
+        .max_leds = LED_STRIP_MAX_LEDS - LED_STRIP_MAX_LEDS / 2,
+    };
+    led_strip_rmt_config_t rmt_config = {
+        .resolution_hz = 10 * 1000 * 1000,
+        .flags.async_refresh = true, // Sends while the SPI half does
+    };
+    ESP_ERROR_CHECK(led_strip_new_rmt_device(&upper_config, &rmt_config, &upper_strip));
+    led_strip_segment_t segments[] = {
+        { .strip = led_strip, .offset = 0, .length = LED_STRIP_MAX_LEDS / 2 },
+        { .strip = upper_strip, .offset = 0, .length = LED_STRIP_MAX_LEDS - LED_STRIP_MAX_LEDS / 2 },
+    };
+    led_strip_multi_config_t multi_config = {
+        .segments = segments,
+        .num_segments = sizeof(segments) / sizeof(segments[0]),
+    };
+    ESP_ERROR_CHECK(led_strip_new_multi(&multi_config, &led_strip));
+#endif
+
+    const led_strip_color_correction_t correction = {
+        .brightness = LED_BRIGHTNESS,
+        .gamma = { LED_GAMMA, LED_GAMMA, LED_GAMMA, LED_GAMMA },
+        .white_point = { 255, 255, 255 },
+    };
+    ESP_ERROR_CHECK(led_strip_set_color_correction(led_strip, &correction));
 
     /* Set all LED off to clear all pixels */
     led_strip_set_pixel(led_strip, 0, 0, 0, 0);
+
+    /* From here on only the render task touches the strip */
+    led_queue = xQueueCreate(LED_QUEUE_LENGTH, sizeof(led_command_t));
+    configASSERT(led_queue);
+    const esp_timer_create_args_t timer_args = {
+        .callback = led_frame_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "led_frame",
+        .skip_unhandled_events = true, // A late render task drops frames instead of bursting
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &led_frame_timer));
+    xTaskCreate(led_render_task, "led_render", 3072, NULL, 5, &led_render_task_handle);
+}
+
+void led_show_color(void)
+{
+    led_command_t cmd = { .effect = LED_EFFECT_SOLID, .color = i };
+    current_effect = cmd.effect;
+    led_send(&cmd);
+}
+
+void led_spot(uint32_t center, uint8_t level)
+{
+    led_command_t cmd = { .effect = LED_EFFECT_SPOT, .color = i, .level = level, .center = center };
+    current_effect = cmd.effect;
+    led_send(&cmd);
 }
 
-void chromatic_effect_task(void *arg) {
-    int color_index = 0;
+static void render_solid(const rgb_t *color)
+{
+    led_strip_fill(led_strip, 0, LED_STRIP_PIXELS, *color);
+}
 
-    // Publish MQTT
-    publish("esp32/color", "Chromatic Effect");
+static void render_spot(const led_command_t *cmd)
+{
+    const rgb_t *color = &led_colors[cmd->color];
+    const int32_t radius = LED_SPOT_RADIUS * 256;
+    rgb_t frame[LED_STRIP_PIXELS];
+    for (int j = 0; j < LED_STRIP_PIXELS; j++) {
+        /* Triangular falloff from the center, scaled by the level */
+        int32_t dist = abs(j * 256 - (int32_t)cmd->center);
+        uint32_t weight = dist < radius ? (uint32_t)(radius - dist) * cmd->level / radius : 0;
+        frame[j] = (rgb_t) { color->r * weight / 255, color->g * weight / 255, color->b * weight / 255 };
+    }
+    led_strip_set_pixels(led_strip, 0, frame, LED_STRIP_PIXELS);
+}
 
-    while (chromatic_active) {
-        rgb_t color = led_colors[color_index];
-        for (int j = 0; j < 29; j++) {
-            led_strip_set_pixel(led_strip, j, color.r, color.g, color.b);
-        }
-        led_strip_refresh(led_strip);
-        vTaskDelay(pdMS_TO_TICKS(200)); // 200ms delay
+/* Blend two colors, frac is 0-255 towards b */
+static inline rgb_t blend(const rgb_t *a, const rgb_t *b, uint32_t frac)
+{
+    return (rgb_t) {
+        .r = (a->r * (256 - frac) + b->r * frac) >> 8,
+        .g = (a->g * (256 - frac) + b->g * frac) >> 8,
+        .b = (a->b * (256 - frac) + b->b * frac) >> 8,
+    };
+}
+
+/* Color of the palette at a position in 1/256 color steps, wrapping around */
+static inline rgb_t palette_at(uint64_t pos)
+{
+    const uint32_t num_colors = sizeof(led_colors) / sizeof(led_colors[0]);
+    uint32_t k = (pos >> 8) % num_colors;
+    return blend(&led_colors[k], &led_colors[(k + 1) % num_colors], pos & 0xFF);
+}
 
-        color_index = (color_index + 1) % (sizeof(led_colors)/sizeof(led_colors[0]));
+static void render_chromatic(int64_t elapsed_us)
+{
+    rgb_t color = palette_at(elapsed_us * 256 / (LED_CHROMATIC_PERIOD_MS * 1000));
+    render_solid(&color);
+}
+
+static void render_shift_chromatic(int64_t elapsed_us)
+{
+    uint64_t offset = elapsed_us * 256 / (LED_SHIFT_CHROMATIC_PERIOD_MS * 1000);
+    rgb_t frame[LED_STRIP_PIXELS];
+    for (int j = 0; j < LED_STRIP_PIXELS; j++) {
+        frame[j] = palette_at(j * 256 + offset);
     }
+    led_strip_set_pixels(led_strip, 0, frame, LED_STRIP_PIXELS);
+}
 
-    vTaskDelete(NULL); // End the task when no longer active
+void led_get_render_stats(led_render_stats_t *stats)
+{
+    portENTER_CRITICAL(&render_stats_lock);
+    *stats = render_stats;
+    portEXIT_CRITICAL(&render_stats_lock);
 }
 
-void shift_chromatic_effect_task(void *arg) {
-    int shift_index = 0;
-    int num_colors = sizeof(led_colors) / sizeof(led_colors[0]);
+void led_render_task(void *arg)
+{
+    led_command_t state = { .effect = LED_EFFECT_HOLD };
+    led_command_t cmd;
+    int64_t effect_start_us = 0;
+    int64_t clock_origin_us = 0; // Ideal time of frame 0 of the running clock
+    uint32_t last_frame = 0;
+    bool clock_running = false;
+
+    while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+
+        /* While animating, commands wait for the next tick so effects switch on a frame boundary */
+        if (clock_running && !(events & LED_NOTIFY_FRAME)) continue;
 
-    // Publish MQTT
-    publish("esp32/color", "Shift Chromatic Effect");
+        bool changed = false;
+        while (xQueueReceive(led_queue, &cmd, 0) == pdTRUE) {
+            if (cmd.effect != state.effect) effect_start_us = now;
+            state = cmd;
+            changed = true;
+        }
 
-    while (shift_chromatic_active) {
-        for (int j = 0; j < 29; j++) {
-            rgb_t color = led_colors[(j + shift_index) % num_colors];
-            led_strip_set_pixel(led_strip, j, color.r, color.g, color.b);
+        bool animated = state.effect == LED_EFFECT_CHROMATIC || state.effect == LED_EFFECT_SHIFT_CHROMATIC;
+        if (animated && !clock_running) {
+            esp_timer_start_periodic(led_frame_timer, LED_FRAME_US);
+            clock_origin_us = now;
+            last_frame = 0;
+            clock_running = true;
+        } else if (!animated && clock_running) {
+            esp_timer_stop(led_frame_timer);
+            clock_running = false;
+        } else if (clock_running) {
+            /* Lateness against the ideal clock, and ticks that were skipped altogether */
+            uint32_t frame = (now - clock_origin_us) / LED_FRAME_US;
+            uint32_t jitter = (now - clock_origin_us) % LED_FRAME_US;
+            portENTER_CRITICAL(&render_stats_lock);
+            if (frame > last_frame + 1) render_stats.dropped_frames += frame - last_frame - 1;
+            if (jitter > render_stats.max_jitter_us) render_stats.max_jitter_us = jitter;
+            portEXIT_CRITICAL(&render_stats_lock);
+            last_frame = frame;
+        }
+        if (!animated && !changed) continue;
+
+        switch (state.effect) {
+        case LED_EFFECT_SOLID:
+            render_solid(&led_colors[state.color]);
+            break;
+        case LED_EFFECT_SPOT:
+            render_spot(&state);
+            break;
+        case LED_EFFECT_CHROMATIC:
+            render_chromatic(now - effect_start_us);
+            break;
+        case LED_EFFECT_SHIFT_CHROMATIC:
+            render_shift_chromatic(now - effect_start_us);
+            break;
+        default:
+            /* LED_EFFECT_HOLD: pixels stay as the previous effect left them */
+            break;
         }
         led_strip_refresh(led_strip);
-        vTaskDelay(pdMS_TO_TICKS(150)); // tweak speed here
 
-        shift_index = (shift_index + 1) % num_colors;
+        uint32_t frame_us = esp_timer_get_time() - now;
+        led_strip_refresh_stats_t strip_stats;
+        led_strip_get_refresh_stats(led_strip, &strip_stats);
+        uint32_t stream_gap_us = 0;
+#if LED_STRIP_STREAM
+        /* A WS2812 latches after 50 us of low, a gap near that cuts frames short */
+        led_strip_spi_get_stream_gap(spi_output, &stream_gap_us);
+#endif
+        portENTER_CRITICAL(&render_stats_lock);
+        render_stats.strip = strip_stats;
+        render_stats.stream_gap_us = stream_gap_us;
+        render_stats.frames++;
+        render_stats.total_frame_us += frame_us;
+        if (frame_us > render_stats.max_frame_us) render_stats.max_frame_us = frame_us;
+        portEXIT_CRITICAL(&render_stats_lock);
     }
-
-    led_strip_refresh(led_strip);
-    vTaskDelete(NULL);
-}
\ No newline at end of file
+}
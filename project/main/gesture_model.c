@@ -0,0 +1,30 @@
+// Generated by tools/train_gesture_model.py, do not edit by hand.
+// PLACEHOLDER: hand-written seed model (tools/train_gesture_model.py --seed), not trained on
+// recorded gestures and without a measured accuracy. Retrain from captured traces before relying on it.
+#include "../include/gesture_classifier.h"
+
+const gesture_tree_node_t gesture_model_nodes[] = {
+    /*   0 */ { .threshold = 16383, .feature = GESTURE_FEATURE_MOTION, .label = GESTURE_NONE, .right = 12 },
+    /*   1 */ { .threshold = 3, .feature = GESTURE_FEATURE_SAMPLES, .label = GESTURE_NONE, .right = 3 },
+    /*   2 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_NONE, .right = 0 },
+    /*   3 */ { .threshold = 12, .feature = GESTURE_FEATURE_SAMPLES, .label = GESTURE_NONE, .right = 7 },
+    /*   4 */ { .threshold = 400, .feature = GESTURE_FEATURE_PEAK_LEVEL, .label = GESTURE_NONE, .right = 6 },
+    /*   5 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_NONE, .right = 0 },
+    /*   6 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_TAP, .right = 0 },
+    /*   7 */ { .threshold = -200, .feature = GESTURE_FEATURE_LEVEL_DELTA, .label = GESTURE_NONE, .right = 9 },
+    /*   8 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_RETREAT, .right = 0 },
+    /*   9 */ { .threshold = 200, .feature = GESTURE_FEATURE_LEVEL_DELTA, .label = GESTURE_NONE, .right = 11 },
+    /*  10 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_HOLD, .right = 0 },
+    /*  11 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_APPROACH, .right = 0 },
+    /*  12 */ { .threshold = 3, .feature = GESTURE_FEATURE_SAMPLES, .label = GESTURE_NONE, .right = 14 },
+    /*  13 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_NONE, .right = 0 },
+    /*  14 */ { .threshold = -1, .feature = GESTURE_FEATURE_AXIS_MARGIN, .label = GESTURE_NONE, .right = 18 },
+    /*  15 */ { .threshold = -1, .feature = GESTURE_FEATURE_LR_DELTA, .label = GESTURE_NONE, .right = 17 },
+    /*  16 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_LEFT, .right = 0 },
+    /*  17 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_RIGHT, .right = 0 },
+    /*  18 */ { .threshold = -1, .feature = GESTURE_FEATURE_UD_DELTA, .label = GESTURE_NONE, .right = 20 },
+    /*  19 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_UP, .right = 0 },
+    /*  20 */ { .threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_DOWN, .right = 0 },
+};
+
+const uint16_t gesture_model_node_count = sizeof(gesture_model_nodes) / sizeof(gesture_model_nodes[0]);
@@ -0,0 +1,44 @@
+#include "../include/gesture_ring.h"
+
+#define GESTURE_RING_MASK (GESTURE_RING_SIZE - 1)
+
+void gesture_ring_init(gesture_ring_t *ring) {
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overflows, 0);
+    atomic_init(&ring->high_water, 0);
+}
+
+bool gesture_ring_push(gesture_ring_t *ring, const gesture_sample_t *sample) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire); // Slot is free once the consumer has copied it out
+    uint32_t level = head - tail;
+    if (level >= GESTURE_RING_SIZE) {
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+        return false;
+    }
+    ring->buf[head & GESTURE_RING_MASK] = *sample;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release); // Publish the sample
+    if (level + 1 > atomic_load_explicit(&ring->high_water, memory_order_relaxed)) {
+        atomic_store_explicit(&ring->high_water, level + 1, memory_order_relaxed);
+    }
+    return true;
+}
+
+bool gesture_ring_pop(gesture_ring_t *ring, gesture_sample_t *sample) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire); // See the sample the producer published
+    if (tail == head) return false;
+    *sample = ring->buf[tail & GESTURE_RING_MASK];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release); // Hand the slot back
+    return true;
+}
+
+void gesture_ring_get_stats(gesture_ring_t *ring, gesture_ring_stats_t *stats) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    stats->level = head - tail;
+    stats->high_water = atomic_load_explicit(&ring->high_water, memory_order_relaxed);
+    stats->overflows = atomic_load_explicit(&ring->overflows, memory_order_relaxed);
+    stats->pushed = head;
+}
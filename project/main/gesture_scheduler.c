@@ -0,0 +1,63 @@
+#include "../include/gesture_scheduler.h"
+#include "../include/apds9960_driver.h"
+
+// pdMS_TO_TICKS rounds down, a zero wait would turn the task into a busy loop
+static inline TickType_t gesture_sched_ticks(uint32_t ms) {
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+    return ticks ? ticks : 1;
+}
+
+void gesture_scheduler_init(gesture_scheduler_t *sched, int64_t now_us) {
+    *sched = (gesture_scheduler_t) {
+        .state = GESTURE_SCHED_IDLE,
+        .state_since_us = now_us,
+        .lock = portMUX_INITIALIZER_UNLOCKED,
+    };
+    sched->stats.entries[GESTURE_SCHED_IDLE] = 1;
+}
+
+static void gesture_sched_enter(gesture_scheduler_t *sched, gesture_sched_state_t state, int64_t now_us) {
+    if (state == sched->state) return;
+    portENTER_CRITICAL(&sched->lock);
+    sched->stats.dwell_us[sched->state] += now_us - sched->state_since_us;
+    sched->stats.entries[state]++;
+    sched->state = state;
+    sched->state_since_us = now_us;
+    portEXIT_CRITICAL(&sched->lock);
+}
+
+TickType_t gesture_scheduler_update(gesture_scheduler_t *sched, bool hand_present, int64_t now_us) {
+    if (hand_present) {
+        sched->last_activity_us = now_us;
+        gesture_sched_enter(sched, GESTURE_SCHED_ACTIVE, now_us);
+    } else if (sched->state == GESTURE_SCHED_ACTIVE) {
+        gesture_sched_enter(sched, GESTURE_SCHED_COOLDOWN, now_us);
+    } else if (sched->state == GESTURE_SCHED_COOLDOWN && now_us - sched->last_activity_us >= GESTURE_COOLDOWN_MS * 1000LL) {
+        gesture_sched_enter(sched, GESTURE_SCHED_IDLE, now_us);
+    }
+
+    portENTER_CRITICAL(&sched->lock);
+    sched->stats.polls[sched->state]++;
+    portEXIT_CRITICAL(&sched->lock);
+
+    switch (sched->state) {
+    case GESTURE_SCHED_ACTIVE: return gesture_sched_ticks(GESTURE_POLL_ACTIVE_MS);
+    case GESTURE_SCHED_COOLDOWN: return gesture_sched_ticks(GESTURE_POLL_COOLDOWN_MS);
+    default: return gesture_sched_ticks(APDS9960_INT_FALLBACK_MS);
+    }
+}
+
+void gesture_scheduler_get_stats(gesture_scheduler_t *sched, int64_t now_us, gesture_sched_stats_t *stats) {
+    portENTER_CRITICAL(&sched->lock);
+    *stats = sched->stats;
+    stats->dwell_us[sched->state] += now_us - sched->state_since_us;
+    portEXIT_CRITICAL(&sched->lock);
+}
+
+const char *gesture_scheduler_state_name(gesture_sched_state_t state) {
+    switch (state) {
+    case GESTURE_SCHED_ACTIVE: return "ACTIVE";
+    case GESTURE_SCHED_COOLDOWN: return "COOLDOWN";
+    default: return "IDLE";
+    }
+}
@@ -0,0 +1,91 @@
+#include "../include/gesture_trace.h"
+#include <string.h>
+
+esp_err_t gesture_trace_init(gesture_trace_t *trace, apds9960_dev_t *const *devs, size_t count) {
+    if (count > GESTURE_TRACE_MAX_SENSORS) return ESP_ERR_INVALID_ARG;
+    trace->sensor_count = count;
+    for (size_t n = 0; n < count; n++) {
+        gesture_trace_sensor_t *cfg = &trace->sensors[n];
+        cfg->mux_channel = devs[n]->config.mux_channel;
+        apds9960_config_get(devs[n], APDS9960_PPULSE, &cfg->ppulse);
+        apds9960_config_get(devs[n], APDS9960_CONTROL, &cfg->control);
+        apds9960_config_get(devs[n], APDS9960_GPENTH, &cfg->gpenth);
+        apds9960_config_get(devs[n], APDS9960_GEXTH, &cfg->gexth);
+        apds9960_config_get(devs[n], APDS9960_GCONF1, &cfg->gconf1);
+        apds9960_config_get(devs[n], APDS9960_GCONF2, &cfg->gconf2);
+        apds9960_config_get(devs[n], APDS9960_GPULSE, &cfg->gpulse);
+    }
+    gesture_trace_reset(trace);
+    return ESP_OK;
+}
+
+void gesture_trace_reset(gesture_trace_t *trace) {
+    trace->recorded = 0;
+    trace->start_us = 0;
+}
+
+void gesture_trace_record(gesture_trace_t *trace, const gesture_sample_t *sample) {
+    if (trace->recorded == 0) trace->start_us = sample->timestamp_us;
+    gesture_trace_record_t *rec = &trace->records[trace->recorded % GESTURE_TRACE_CAPACITY];
+    rec->time_us = (uint64_t)(sample->timestamp_us - trace->start_us);
+    rec->kind = (sample->kind & 0x0F) | (sample->sensor << 4);
+    rec->pdata = sample->pdata;
+    rec->data = sample->data;
+    trace->recorded++;
+}
+
+size_t gesture_trace_export(const gesture_trace_t *trace, uint8_t *out, size_t size) {
+    uint32_t count = trace->recorded < GESTURE_TRACE_CAPACITY ? trace->recorded : GESTURE_TRACE_CAPACITY;
+    size_t config_len = trace->sensor_count * sizeof(gesture_trace_sensor_t);
+    size_t total = sizeof(gesture_trace_header_t) + config_len + count * sizeof(gesture_trace_record_t);
+    if (size < total) return 0;
+
+    gesture_trace_header_t header = {
+        .magic = GESTURE_TRACE_MAGIC,
+        .version = GESTURE_TRACE_VERSION,
+        .record_size = sizeof(gesture_trace_record_t),
+        .sensor_count = trace->sensor_count,
+        .record_count = count,
+        .dropped = trace->recorded - count,
+        .start_us = trace->start_us,
+    };
+    memcpy(out, &header, sizeof(header));
+    out += sizeof(header);
+    memcpy(out, trace->sensors, config_len);
+    out += config_len;
+
+    // Unroll the ring: the oldest record sits right after the newest once it has wrapped
+    uint32_t first = trace->recorded - count;
+    for (uint32_t n = 0; n < count; n++) {
+        memcpy(out, &trace->records[(first + n) % GESTURE_TRACE_CAPACITY], sizeof(gesture_trace_record_t));
+        out += sizeof(gesture_trace_record_t);
+    }
+    return total;
+}
+
+esp_err_t gesture_trace_replay(const uint8_t *data, size_t size, gesture_trace_sink_t sink, void *ctx) {
+    gesture_trace_header_t header;
+    if (size < sizeof(header)) return ESP_ERR_INVALID_SIZE;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != GESTURE_TRACE_MAGIC || header.version != GESTURE_TRACE_VERSION ||
+        header.record_size != sizeof(gesture_trace_record_t)) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    size_t offset = sizeof(header) + header.sensor_count * sizeof(gesture_trace_sensor_t);
+    if (size < offset + (size_t)header.record_count * header.record_size) return ESP_ERR_INVALID_SIZE;
+
+    for (uint32_t n = 0; n < header.record_count; n++) {
+        gesture_trace_record_t rec;
+        memcpy(&rec, data + offset, sizeof(rec)); // Records are unaligned inside the trace
+        offset += header.record_size;
+        gesture_sample_t sample = {
+            .timestamp_us = header.start_us + (int64_t)rec.time_us,
+            .data = rec.data,
+            .kind = rec.kind & 0x0F,
+            .sensor = rec.kind >> 4,
+            .pdata = rec.pdata,
+        };
+        sink(&sample, ctx);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+#include "../include/hand_tracker.h"
+
+void hand_tracker_init(hand_tracker_t *tracker) {
+    *tracker = (hand_tracker_t) {0};
+}
+
+static inline int32_t hand_tracker_smooth(int32_t avg, int32_t sample) {
+    return avg + ((sample - avg) >> HAND_TRACKER_SMOOTH_SHIFT);
+}
+
+// Map value from [lo, hi] to Q15 0..1, clamped
+static inline int32_t hand_tracker_scale(int32_t value, int32_t lo, int32_t hi) {
+    if (value <= lo) return 0;
+    if (value >= hi) return GESTURE_Q15_ONE - 1;
+    return (value - lo) * (GESTURE_Q15_ONE - 1) / (hi - lo);
+}
+
+static void hand_tracker_combine(hand_tracker_t *tracker) {
+    tracker->closeness = tracker->pdata_valid ? (tracker->level_closeness + tracker->pdata_closeness) / 2
+                                              : tracker->level_closeness;
+}
+
+void hand_tracker_update(hand_tracker_t *tracker, const apds9960_gesture_dataset_t *dataset) {
+    if (dataset->u <= GESTURE_DECODER_THRESHOLD || dataset->d <= GESTURE_DECODER_THRESHOLD ||
+        dataset->l <= GESTURE_DECODER_THRESHOLD || dataset->r <= GESTURE_DECODER_THRESHOLD) {
+        return; // Edge of the field of view, the balance is meaningless here
+    }
+    int32_t position = gesture_ratio_q15(dataset->l, dataset->r);
+#if HAND_TRACKER_INVERT
+    position = -position;
+#endif
+    int32_t closeness = hand_tracker_scale(dataset->u + dataset->d + dataset->l + dataset->r,
+                                           HAND_TRACKER_LEVEL_MIN, HAND_TRACKER_LEVEL_MAX);
+    if (!tracker->present) {
+        // Start at the first sample instead of sliding in from the last position
+        tracker->present = true;
+        tracker->pdata_valid = false;
+        tracker->position = position;
+        tracker->level_closeness = closeness;
+    } else {
+        tracker->position = hand_tracker_smooth(tracker->position, position);
+        tracker->level_closeness = hand_tracker_smooth(tracker->level_closeness, closeness);
+    }
+    hand_tracker_combine(tracker);
+}
+
+void hand_tracker_update_proximity(hand_tracker_t *tracker, uint8_t pdata) {
+    if (!tracker->present) return;
+    int32_t closeness = hand_tracker_scale(pdata, HAND_TRACKER_PDATA_MIN, HAND_TRACKER_PDATA_MAX);
+    if (!tracker->pdata_valid) {
+        tracker->pdata_valid = true;
+        tracker->pdata_closeness = closeness;
+    } else {
+        tracker->pdata_closeness = hand_tracker_smooth(tracker->pdata_closeness, closeness);
+    }
+    hand_tracker_combine(tracker);
+}
+
+bool hand_tracker_lost(hand_tracker_t *tracker) {
+    bool was_present = tracker->present;
+    tracker->present = false;
+    return was_present;
+}
@@ -10,77 +10,267 @@
 #include "esp_event.h"
 #include "esp_netif.h"
 #include "../include/apds9960_driver.h"
+#include "../include/gesture_decoder.h"
+#include "../include/gesture_classifier.h"
+#include "../include/hand_tracker.h"
+#include "../include/gesture_scheduler.h"
+#include "../include/gesture_ring.h"
+#include "../include/gesture_trace.h"
 #include "../include/gesture_led_strip.h"
 #include "../include/comms.h"
+#include "esp_timer.h"
 
 static const char *TAG = "GESTURE";
 
 uint8_t gesture = 0;
 
-void gesture_task(void *pvParam) {
-    uint8_t gstatus = 0;
-    uint8_t gflvl = 0;
-    uint8_t fifo_data[4]; // Buffer for one gesture dataset (U, D, L, R)
-    uint8_t pdata = 0; // For proximity data
+// Sensors sharing the I2C bus, add entries (with their mux channels) to run several in parallel
+#define GESTURE_SENSOR_COUNT 1
+#define GESTURE_PROXIMITY_PUBLISH_MS 200 // Minimum interval between proximity logs/publishes
 
-    ESP_LOGI(TAG, "Gesture task started.");
+static apds9960_bus_t sensor_bus;
+static apds9960_dev_t sensors[GESTURE_SENSOR_COUNT];
+static apds9960_dev_t *sensor_list[GESTURE_SENSOR_COUNT];
+static const apds9960_dev_config_t sensor_configs[GESTURE_SENSOR_COUNT] = {
+    { .mux_channel = APDS9960_NO_MUX, .int_io = APDS9960_INT_IO },
+};
+
+static gesture_decoder_t decoders[GESTURE_SENSOR_COUNT];
+static gesture_classifier_t classifiers[GESTURE_SENSOR_COUNT];
+static hand_tracker_t trackers[GESTURE_SENSOR_COUNT];
+static bool tracking_mode = false; // HOLD starts the tracking spot, DOUBLE_TAP goes back to gesture commands
+static bool spot_dirty = false;    // Tracker state changed since the last spot frame
+static gesture_ring_t sample_ring; // Acquisition -> processing
+static TaskHandle_t process_task_handle = NULL;
+static gesture_scheduler_t scheduler;
+static int64_t proximity_published_us[GESTURE_SENSOR_COUNT];
+#if GESTURE_TRACE_CAPTURE
+static gesture_trace_t trace;                              // Flight recorder of the processed samples
+static uint8_t trace_export[GESTURE_TRACE_EXPORT_MAX];
+#endif
+
+static void gesture_report(size_t index, const gesture_result_t *result, int64_t end_us) {
+    // Q15 values printed as percent
+    ESP_LOGI(TAG, "Sensor %d trajectory: %d samples, dUD=%ld%%, dLR=%ld%%, level %d/%d/%d", (int)index, result->samples,
+             (long)(result->ud_delta * 100 / GESTURE_Q15_ONE), (long)(result->lr_delta * 100 / GESTURE_Q15_ONE),
+             result->entry_level, result->peak_level, result->exit_level);
+    gesture_t detected = gesture_classifier_run(&classifiers[index], result, end_us);
+    if (detected == GESTURE_NONE) {
+#if GESTURE_TRACE_CAPTURE
+        // Ship what led up to the miss so it can be replayed offline, then start a fresh capture
+        size_t len = gesture_trace_export(&trace, trace_export, sizeof(trace_export));
+        publish_binary("esp32/trace", trace_export, len);
+        gesture_trace_reset(&trace);
+#endif
+        return;
+    }
+    ESP_LOGW(TAG, "GESTURE: %s (swipe confidence %ld%%)", gesture_decoder_name(detected),
+             (long)(result->confidence * 100 / GESTURE_Q15_ONE));
+    publish("esp32/gesture", gesture_decoder_name(detected));
+    gesture = detected;
+    // A hand resting over the spot reads as HOLD again, so tracking only ends on a distinct gesture
+    if (detected == GESTURE_HOLD && !tracking_mode) {
+        tracking_mode = true;
+        ESP_LOGI(TAG, "Hand tracking on.");
+        blink_led(GESTURE_NONE); // Stops any running chromatic effect
+        spot_dirty = true;
+    } else if (detected == GESTURE_DOUBLE_TAP && tracking_mode) {
+        tracking_mode = false;
+        ESP_LOGI(TAG, "Hand tracking off.");
+        led_show_color();
+    } else if (detected <= GESTURE_RIGHT && !tracking_mode) {
+        blink_led(gesture); // The strip only has actions for swipes
+    }
+}
+
+// Draw the spot for the closest hand over any sensor, each sensor owns an equal stretch of the strip
+static void gesture_render_spot(void) {
+    int best = -1;
+    for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+        if (trackers[n].present && (best < 0 || trackers[n].closeness > trackers[best].closeness)) best = n;
+    }
+    if (best < 0) {
+        led_spot(0, 0);
+        return;
+    }
+    // Position -1..1 over sensor k maps to [k, k + 1) / GESTURE_SENSOR_COUNT of the strip, in 1/256 pixel
+    int64_t along = (int64_t)best * 2 * GESTURE_Q15_ONE + trackers[best].position + GESTURE_Q15_ONE;
+    uint32_t center = along * (LED_STRIP_PIXELS - 1) * 256 / (2 * GESTURE_Q15_ONE * GESTURE_SENSOR_COUNT);
+    led_spot(center, trackers[best].closeness >> 7);
+}
+
+static inline void gesture_push(uint8_t kind, size_t index, int64_t now_us, uint8_t pdata, const apds9960_gesture_dataset_t *data) {
+    gesture_sample_t sample = {
+        .timestamp_us = now_us,
+        .kind = kind,
+        .sensor = index,
+        .pdata = pdata,
+    };
+    if (data) sample.data = *data;
+    gesture_ring_push(&sample_ring, &sample); // Drops on overflow, counted in the ring stats
+}
+
+// Acquisition side: only talks to the sensor and the ring, nothing here may block on downstream work
+// Returns true if samples were pushed, *hand_present tells the scheduler whether the sensor sees a hand
+static bool gesture_poll_sensor(apds9960_dev_t *dev, size_t index, apds9960_gesture_dataset_t *fifo, bool *hand_present) {
+    apds9960_snapshot_t snap; // PDATA, GFLVL and GSTATUS from one poll
+
+    if (apds9960_read_snapshot(dev, &snap) != ESP_OK) {
+        apds9960_clear_interrupts(dev);
+        return false;
+    }
+    *hand_present |= snap.pdata > APDS9960_PROX_GATE || (snap.gstatus & APDS9960_GSTATUS_GVALID) || snap.gflvl > 0;
+    int64_t now_us = esp_timer_get_time();
+    gesture_push(GESTURE_SAMPLE_PROXIMITY, index, now_us, snap.pdata, NULL);
+
+    // PIHT/GPENTH gate in hardware, this only filters fallback wake-ups with no hand present
+    if (snap.pdata <= APDS9960_PROX_GATE && !(snap.gstatus & APDS9960_GSTATUS_GVALID)) {
+        gesture_push(GESTURE_SAMPLE_EXIT, index, now_us, snap.pdata, NULL); // The hand may have left between two polls
+        apds9960_clear_gesture_fifo(dev);
+        apds9960_clear_interrupts(dev);
+        return true;
+    }
+    if ((snap.gstatus & APDS9960_GSTATUS_GVALID) && snap.gflvl > 0 &&
+        apds9960_read_gesture_fifo(dev, snap.gflvl, fifo) == ESP_OK) {
+        now_us = esp_timer_get_time();
+        for (uint8_t n = 0; n < snap.gflvl; n++) {
+            gesture_push(GESTURE_SAMPLE_DATASET, index, now_us, snap.pdata, &fifo[n]);
+        }
+    }
+    // Draining the FIFO has released GINT, only PINT is left to clear
+    apds9960_clear_interrupts(dev);
+    return true;
+}
+
+void gesture_acquire_task(void *pvParam) {
+    apds9960_gesture_dataset_t fifo[APDS9960_GFIFO_DATASETS_MAX]; // Whole gesture FIFO (U, D, L, R per dataset)
+
+    TickType_t wait = pdMS_TO_TICKS(APDS9960_INT_FALLBACK_MS);
+
+    ESP_LOGI(TAG, "Gesture acquisition task started.");
     while (1) {
-        // Read Proximity Data
-        if (apds9960_read_byte(APDS9960_PDATA, &pdata) == ESP_OK) {
-            ESP_LOGI(TAG, "Proximity: %d", pdata);
-        } else {
-            ESP_LOGE(TAG, "Failed to read PDATA");
+        // Sleep until an APDS-9960 asserts INT or the scheduler wants the next poll
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        // Notifications from all sensors collapse into one wake, so poll each of them.
+        // Starting at the channel the mux already routes saves one switch per round.
+        bool pushed = false;
+        bool hand_present = false;
+        size_t first = apds9960_schedule_start(sensor_list, GESTURE_SENSOR_COUNT);
+        for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+            size_t index = (first + n) % GESTURE_SENSOR_COUNT;
+            pushed |= gesture_poll_sensor(&sensors[index], index, fifo, &hand_present);
         }
+        if (pushed) xTaskNotifyGive(process_task_handle);
+        wait = gesture_scheduler_update(&scheduler, hand_present, esp_timer_get_time());
+    }
+}
+
+// Processing side: decoding, MQTT and LED updates, free to take as long as they need.
+// Matches gesture_trace_sink_t so recorded traces can be replayed through the same path.
+static void gesture_process_sample(const gesture_sample_t *sample, void *ctx) {
+    // A trace recorded on a board with more sensors holds indexes this build has no state for
+    if (sample->sensor >= GESTURE_SENSOR_COUNT) return;
+    gesture_decoder_t *dec = &decoders[sample->sensor];
+    gesture_result_t result;
+
+    switch (sample->kind) {
+    case GESTURE_SAMPLE_PROXIMITY: {
+        hand_tracker_update_proximity(&trackers[sample->sensor], sample->pdata);
+        // Active polling reads proximity every tick, the log and MQTT only need a fraction of that
+        if (sample->timestamp_us - proximity_published_us[sample->sensor] < GESTURE_PROXIMITY_PUBLISH_MS * 1000LL) break;
+        proximity_published_us[sample->sensor] = sample->timestamp_us;
+        ESP_LOGI(TAG, "Sensor %d proximity: %d", sample->sensor, sample->pdata);
+        char proximity_str[10];
+        snprintf(proximity_str, sizeof(proximity_str), "%d", sample->pdata);
+        publish("esp32/proximity", proximity_str); // Publish proximity data
+        break;
+    }
+    case GESTURE_SAMPLE_EXIT:
+        spot_dirty |= hand_tracker_lost(&trackers[sample->sensor]);
+        if (gesture_decoder_finish(dec, &result)) {
+            gesture_report(sample->sensor, &result, sample->timestamp_us);
+        }
+        break;
+    case GESTURE_SAMPLE_DATASET:
+        hand_tracker_update(&trackers[sample->sensor], &sample->data);
+        spot_dirty |= trackers[sample->sensor].present;
+        if (gesture_decoder_push(dec, &sample->data, &result)) {
+            spot_dirty |= hand_tracker_lost(&trackers[sample->sensor]); // The hand has left the field of view
+            gesture_report(sample->sensor, &result, sample->timestamp_us);
+        }
+        break;
+    }
+}
+
+void gesture_process_task(void *pvParam) {
+    gesture_sample_t sample;
+    apds9960_stats_t stats;
+    gesture_ring_stats_t ring_stats;
+    gesture_sched_stats_t sched_stats;
+    led_render_stats_t render_stats;
+    uint32_t window_transactions = 0;
+    int64_t window_start_us = esp_timer_get_time();
 
-        if(pdata <= 140){
-            ESP_LOGI(TAG, "Proximity too low, skipping gesture detection.");
-            vTaskDelay(pdMS_TO_TICKS(200)); // Wait before next check
-            continue;
+    ESP_LOGI(TAG, "Gesture processing task started.");
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(APDS9960_INT_FALLBACK_MS));
+
+        while (gesture_ring_pop(&sample_ring, &sample)) {
+#if GESTURE_TRACE_CAPTURE
+            gesture_trace_record(&trace, &sample);
+#endif
+            gesture_process_sample(&sample, NULL);
+        }
+        // One spot frame per FIFO burst keeps the sample-to-light latency at one interrupt
+        if (tracking_mode && spot_dirty) {
+            spot_dirty = false;
+            gesture_render_spot();
         }
-        if (apds9960_read_byte(APDS9960_GSTATUS, &gstatus) == ESP_OK) {
-            ESP_LOGI(TAG, "GSTATUS: 0x%02X", gstatus); 
-            char proximity_str[10];
-            snprintf(proximity_str, sizeof(proximity_str), "%d", pdata);
-            publish("esp32/proximity", proximity_str); // Publish proximity data
-            if (gstatus & 0x01) { // Check GVALID bit
-                // ESP_LOGI(TAG, "GVALID set, checking FIFO level...");
-                if (apds9960_read_byte(APDS9960_GFLVL, &gflvl) == ESP_OK) {
-                    if (gflvl > 0) {
-                        ESP_LOGI(TAG, "Gesture data in FIFO! Level: %d", gflvl);
-                        if (apds9960_read_block(APDS9960_GFIFO_U, fifo_data, 4) == ESP_OK) {
-                            ESP_LOGI(TAG, "Gesture Data: U=%3d, D=%3d, L=%3d, R=%3d",
-                                     fifo_data[0], fifo_data[1], fifo_data[2], fifo_data[3]);
-                            if (fifo_data[0] > 50 && fifo_data[0] > fifo_data[1] && fifo_data[0] > fifo_data[2] && fifo_data[0] > fifo_data[3]) {
-                                ESP_LOGW(TAG, "Tentative GESTURE: UP");
-                                publish("esp32/gesture", "UP");                        
-                                gesture = 1;
-                            } else if (fifo_data[1] > 50 && fifo_data[1] > fifo_data[0] && fifo_data[1] > fifo_data[2] && fifo_data[1] > fifo_data[3]) {
-                                ESP_LOGW(TAG, "Tentative GESTURE: DOWN");
-                                publish("esp32/gesture", "DOWN");
-                                gesture = 2;
-                            } else if (fifo_data[2] > 50 && fifo_data[2] > fifo_data[0] && fifo_data[2] > fifo_data[1] && fifo_data[2] > fifo_data[3]) {
-                                ESP_LOGW(TAG, "Tentative GESTURE: LEFT");
-                                publish("esp32/gesture", "LEFT");
-                                gesture = 3;
-                            } else if (fifo_data[3] > 50 && fifo_data[3] > fifo_data[0] && fifo_data[3] > fifo_data[1] && fifo_data[3] > fifo_data[2]) {
-                                ESP_LOGW(TAG, "Tentative GESTURE: RIGHT");
-                                publish("esp32/gesture", "RIGHT");
-                                gesture = 4;
-                            }
-                            blink_led(gesture);
-                        } else {
-                            ESP_LOGE(TAG, "Failed to read gesture FIFO data.");
-                        }
-                    }
-                } else {
-                    ESP_LOGE(TAG, "Failed to read GFLVL.");
-                }
-            } else { 
+#if GESTURE_DECODER_PROFILE
+        for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+            if (decoders[n].profile_pushes) {
+                ESP_LOGI(TAG, "Decoder %d: %lu cycles per dataset", (int)n,
+                         (unsigned long)(decoders[n].profile_cycles / decoders[n].profile_pushes));
             }
-        } else {
-            ESP_LOGE(TAG, "Failed to read GSTATUS.");
         }
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Poll rate
+#endif
+#if GESTURE_CLASSIFIER_PROFILE
+        for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+            if (classifiers[n].profile_runs) {
+                ESP_LOGI(TAG, "Classifier %d: %lu cycles per trajectory", (int)n,
+                         (unsigned long)(classifiers[n].profile_cycles / classifiers[n].profile_runs));
+            }
+        }
+#endif
+
+        // Bus load and ring report, idle traffic should stay near zero with hardware gating
+        if (esp_timer_get_time() - window_start_us >= 60 * 1000 * 1000) {
+            uint32_t transactions = 0;
+            for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+                apds9960_get_stats(&sensors[n], &stats);
+                transactions += stats.transactions;
+            }
+            gesture_ring_get_stats(&sample_ring, &ring_stats);
+            gesture_scheduler_get_stats(&scheduler, esp_timer_get_time(), &sched_stats);
+            ESP_LOGI(TAG, "I2C transactions in the last minute: %lu", (unsigned long)(transactions - window_transactions));
+            ESP_LOGI(TAG, "Sample ring: high water %lu/%d, %lu overflows", (unsigned long)ring_stats.high_water,
+                     GESTURE_RING_SIZE, (unsigned long)ring_stats.overflows);
+            led_get_render_stats(&render_stats);
+            ESP_LOGI(TAG, "LED frames: %lu drawn, %lu dropped, %lu us avg / %lu us max, %lu us max jitter, %lu of %lu refreshes sent, %lu us max chunk gap",
+                     (unsigned long)render_stats.frames, (unsigned long)render_stats.dropped_frames,
+                     (unsigned long)(render_stats.frames ? render_stats.total_frame_us / render_stats.frames : 0),
+                     (unsigned long)render_stats.max_frame_us, (unsigned long)render_stats.max_jitter_us,
+                     (unsigned long)render_stats.strip.transmitted, (unsigned long)render_stats.strip.requested,
+                     (unsigned long)render_stats.stream_gap_us);
+            for (int st = 0; st < GESTURE_SCHED_STATES; st++) {
+                ESP_LOGI(TAG, "Scheduler %s: %llu ms total, entered %lu times, %lu polls", gesture_scheduler_state_name(st),
+                         (unsigned long long)(sched_stats.dwell_us[st] / 1000), (unsigned long)sched_stats.entries[st],
+                         (unsigned long)sched_stats.polls[st]);
+            }
+            window_transactions = transactions;
+            window_start_us = esp_timer_get_time();
+        }
     }
 }
 
@@ -95,9 +285,21 @@ void app_main(void) {
     // Initialize WiFi
     wifi_init();
     
-    // Initialize I2C and APDS-9960
-    apds9960_i2c_init();
-    apds9960_init();
+    // Initialize I2C and the APDS-9960 sensors on it
+    const apds9960_bus_config_t bus_config = {
+        .port = I2C_MASTER_NUM,
+        .sda_io = I2C_MASTER_SDA_IO,
+        .scl_io = I2C_MASTER_SCL_IO,
+        .mux_addr = 0, // Set to the TCA9548A address (0x70) when the sensors sit behind a mux
+    };
+    apds9960_bus_init(&sensor_bus, &bus_config);
+    for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+        sensor_list[n] = &sensors[n];
+        apds9960_init(&sensors[n], &sensor_bus, &sensor_configs[n]);
+        gesture_decoder_init(&decoders[n]);
+        gesture_classifier_init(&classifiers[n]);
+        hand_tracker_init(&trackers[n]);
+    }
 
     configure_led();
     vTaskDelay(pdMS_TO_TICKS(5000)); // 5-second delay
@@ -105,7 +307,18 @@ void app_main(void) {
     // Initialize MQTT
     mqtt_init();
 
-    xTaskCreate(gesture_task, "gesture_task", 4096, NULL, 3, NULL);  
+    // Acquisition runs above processing so a slow publish or LED update never delays a FIFO drain
+    gesture_ring_init(&sample_ring);
+    gesture_scheduler_init(&scheduler, esp_timer_get_time());
+#if GESTURE_TRACE_CAPTURE
+    gesture_trace_init(&trace, sensor_list, GESTURE_SENSOR_COUNT);
+#endif
+    xTaskCreate(gesture_process_task, "gesture_process", 4096, NULL, 3, &process_task_handle);
+    TaskHandle_t acquire_task_handle = NULL;
+    xTaskCreate(gesture_acquire_task, "gesture_acquire", 4096, NULL, 4, &acquire_task_handle);
+    for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+        apds9960_int_init(&sensors[n], acquire_task_handle);
+    }
     
     ESP_LOGI(TAG, "Both proximity and gesture tasks started");
 }
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "fake_apds9960.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/i2c_master.h"
+#include "fake_idf.h"
+
+#define FAKE_HANDLES_MAX 64
+#define FAKE_FIFO_DEPTH 32
+
+struct i2c_master_bus_t {
+    i2c_port_num_t port;
+    bool alive;
+    uint32_t devices;
+};
+
+struct i2c_master_dev_t {
+    struct i2c_master_bus_t *bus;
+    uint16_t addr;
+    uint32_t scl_speed_hz;
+    bool alive;
+};
+
+static struct {
+    // Handles stay allocated after removal so stale ones can be recognised
+    void *handles[FAKE_HANDLES_MAX];
+    size_t num_handles;
+    struct i2c_master_bus_t *bus;
+
+    uint8_t regs[256];
+    uint8_t fifo[FAKE_FIFO_DEPTH][4];
+    uint8_t fifo_head;
+    uint8_t fifo_level;
+    bool gvalid;
+    bool gfov;
+    bool gint;
+    bool pint;
+    uint8_t pers_count; // Consecutive proximity readings outside the PILT/PIHT window
+
+    gpio_num_t int_io;
+    uint8_t mux_addr;
+    int8_t mux_channel;
+    uint8_t mux_mask; // Channels the mux currently routes
+
+    uint32_t fail_transfers;
+    esp_err_t fail_err;
+    uint32_t setup_skip;
+    uint32_t setup_fail;
+    fake_i2c_stats_t stats;
+} s;
+
+void fake_apds9960_reset(gpio_num_t int_io, uint8_t mux_addr, int8_t mux_channel) {
+    for (size_t n = 0; n < s.num_handles; n++) free(s.handles[n]);
+    memset(&s, 0, sizeof(s));
+    s.int_io = int_io;
+    s.mux_addr = mux_addr;
+    s.mux_channel = mux_channel;
+    // Datasheet power-on values of the registers the driver touches
+    s.regs[0x81] = 0xFF; // ATIME
+    s.regs[0x83] = 0xFF; // WTIME
+    s.regs[0x8D] = 0x40; // CONFIG1
+    s.regs[0x90] = 0x01; // CONFIG2
+    s.regs[APDS9960_ID] = 0xAB;
+    if (int_io != GPIO_NUM_NC) fake_gpio_drive(int_io, 1);
+}
+
+const fake_i2c_stats_t *fake_i2c_stats(void) {
+    return &s.stats;
+}
+
+void fake_i2c_fail_transfers(uint32_t count, esp_err_t err) {
+    s.fail_transfers = count;
+    s.fail_err = err;
+}
+
+void fake_i2c_fail_setup(uint32_t skip, uint32_t count) {
+    s.setup_skip = skip;
+    s.setup_fail = count;
+}
+
+uint8_t fake_apds9960_reg(uint8_t reg) {
+    return s.regs[reg];
+}
+
+void fake_apds9960_set_reg(uint8_t reg, uint8_t value) {
+    s.regs[reg] = value;
+}
+
+uint8_t fake_apds9960_fifo_level(void) {
+    return s.fifo_level;
+}
+
+// INT is open drain and active low: asserted while an enabled interrupt is pending
+static void fake_apds9960_update_int(void) {
+    bool asserted = (s.pint && (s.regs[APDS9960_ENABLE] & APDS9960_ENABLE_PIEN)) ||
+                    (s.gint && (s.regs[APDS9960_GCONF4] & APDS9960_GCONF4_GIEN));
+    if (s.int_io != GPIO_NUM_NC) fake_gpio_drive(s.int_io, asserted ? 0 : 1);
+}
+
+static inline bool fake_apds9960_powered(uint8_t engine) {
+    return (s.regs[APDS9960_ENABLE] & APDS9960_ENABLE_PON) && (s.regs[APDS9960_ENABLE] & engine);
+}
+
+void fake_apds9960_set_proximity(uint8_t pdata) {
+    if (!fake_apds9960_powered(APDS9960_ENABLE_PEN)) return;
+    s.regs[APDS9960_PDATA] = pdata;
+    if (pdata < s.regs[APDS9960_PILT] || pdata > s.regs[APDS9960_PIHT]) {
+        if (s.pers_count < 255) s.pers_count++;
+        uint8_t ppers = s.regs[APDS9960_PERS] >> 4; // 0: every cycle, n: n consecutive cycles
+        if (s.pers_count >= (ppers ? ppers : 1)) s.pint = true;
+    } else {
+        s.pers_count = 0;
+    }
+    fake_apds9960_update_int();
+}
+
+static void fake_apds9960_fifo_clear(void) {
+    s.fifo_head = 0;
+    s.fifo_level = 0;
+    s.gvalid = false;
+    s.gfov = false;
+    s.gint = false;
+}
+
+void fake_apds9960_push(const apds9960_gesture_dataset_t *datasets, size_t count) {
+    if (!fake_apds9960_powered(APDS9960_ENABLE_GEN)) return;
+    static const uint8_t thresholds[4] = {1, 4, 8, 16}; // GFIFOTH in GCONF1 bits 7:6
+    for (size_t n = 0; n < count; n++) {
+        if (s.fifo_level == FAKE_FIFO_DEPTH) {
+            s.gfov = true;
+            continue;
+        }
+        uint8_t *slot = s.fifo[(s.fifo_head + s.fifo_level) % FAKE_FIFO_DEPTH];
+        slot[0] = datasets[n].u;
+        slot[1] = datasets[n].d;
+        slot[2] = datasets[n].l;
+        slot[3] = datasets[n].r;
+        s.fifo_level++;
+    }
+    if (s.fifo_level >= thresholds[s.regs[APDS9960_GCONF1] >> 6]) {
+        s.gvalid = true;
+        s.gint = true;
+    }
+    fake_apds9960_update_int();
+}
+
+static uint8_t fake_apds9960_read_reg(uint8_t reg) {
+    switch (reg) {
+    case APDS9960_STATUS:
+        return (s.pint ? APDS9960_STATUS_PINT : 0) | (s.gint ? APDS9960_STATUS_GINT : 0) | 0x02; // PVALID
+    case APDS9960_GFLVL:
+        return s.fifo_level;
+    case APDS9960_GSTATUS:
+        return (s.gvalid ? APDS9960_GSTATUS_GVALID : 0) | (s.gfov ? 0x02 : 0);
+    default:
+        return s.regs[reg];
+    }
+}
+
+static void fake_apds9960_write_reg(uint8_t reg, uint8_t value) {
+    if (reg == APDS9960_GCONF4 && (value & APDS9960_GCONF4_GFIFO_CLR)) {
+        fake_apds9960_fifo_clear();
+        value &= ~APDS9960_GCONF4_GFIFO_CLR; // Self clearing
+    }
+    if (reg != APDS9960_ID && reg != APDS9960_STATUS && reg != APDS9960_PDATA && reg < APDS9960_GFLVL) {
+        s.regs[reg] = value;
+    }
+}
+
+// Register pointer set by the first written byte, auto-incremented by every data byte
+static void fake_apds9960_transfer(const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len) {
+    uint8_t ptr = tx[0];
+    if (tx_len == 1 && rx_len == 0) {
+        // Address-only writes to the special function registers
+        if (ptr == APDS9960_PICLEAR || ptr == APDS9960_AICLEAR) s.pint = false;
+    }
+    for (size_t n = 1; n < tx_len; n++) {
+        fake_apds9960_write_reg(ptr++, tx[n]);
+    }
+    for (size_t n = 0; n < rx_len; n++) {
+        if (ptr >= APDS9960_GFIFO_U) {
+            // FIFO window: U, D, L, R of the oldest dataset, reading R pops it and wraps back to U
+            rx[n] = s.fifo_level ? s.fifo[s.fifo_head][ptr - APDS9960_GFIFO_U] : 0;
+            if (ptr == 0xFF) {
+                if (s.fifo_level) {
+                    s.fifo_head = (s.fifo_head + 1) % FAKE_FIFO_DEPTH;
+                    s.fifo_level--;
+                }
+                if (s.fifo_level == 0) {
+                    s.gvalid = false;
+                    s.gint = false;
+                }
+                ptr = APDS9960_GFIFO_U;
+            } else {
+                ptr++;
+            }
+        } else {
+            rx[n] = fake_apds9960_read_reg(ptr++);
+        }
+    }
+    fake_apds9960_update_int();
+}
+
+// Bus side
+
+static bool fake_handle_ok(const void *handle, bool alive) {
+    if (handle == NULL || !alive) {
+        s.stats.invalid_handles++;
+        return false;
+    }
+    return true;
+}
+
+static void *fake_handle_alloc(size_t size) {
+    if (s.num_handles == FAKE_HANDLES_MAX) {
+        fprintf(stderr, "fake_apds9960: out of handles\n");
+        abort();
+    }
+    void *handle = calloc(1, size);
+    s.handles[s.num_handles++] = handle;
+    return handle;
+}
+
+static bool fake_setup_fails(void) {
+    if (s.setup_skip) {
+        s.setup_skip--;
+        return false;
+    }
+    if (s.setup_fail) {
+        s.setup_fail--;
+        return true;
+    }
+    return false;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *bus_config, i2c_master_bus_handle_t *ret_bus_handle) {
+    if (bus_config == NULL || ret_bus_handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (s.bus && s.bus->alive) return ESP_ERR_INVALID_STATE; // Port still taken
+    if (fake_setup_fails()) return ESP_ERR_NO_MEM;
+    s.bus = fake_handle_alloc(sizeof(*s.bus));
+    s.bus->port = bus_config->i2c_port;
+    s.bus->alive = true;
+    s.stats.buses_created++;
+    *ret_bus_handle = s.bus;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus) {
+    if (!fake_handle_ok(bus, bus && bus->alive)) return ESP_ERR_INVALID_ARG;
+    if (bus->devices) return ESP_ERR_INVALID_STATE;
+    bus->alive = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *dev_config,
+                                    i2c_master_dev_handle_t *ret_handle) {
+    if (!fake_handle_ok(bus, bus && bus->alive) || dev_config == NULL || ret_handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (fake_setup_fails()) return ESP_ERR_NO_MEM;
+    struct i2c_master_dev_t *dev = fake_handle_alloc(sizeof(*dev));
+    dev->bus = bus;
+    dev->addr = dev_config->device_address;
+    dev->scl_speed_hz = dev_config->scl_speed_hz;
+    dev->alive = true;
+    bus->devices++;
+    s.stats.devices_added++;
+    *ret_handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev) {
+    if (!fake_handle_ok(dev, dev && dev->alive)) return ESP_ERR_INVALID_ARG;
+    dev->alive = false;
+    dev->bus->devices--;
+    s.stats.devices_removed++;
+    return ESP_OK;
+}
+
+// Address byte plus data bytes, 9 clocks each
+static void fake_i2c_wire_time(const struct i2c_master_dev_t *dev, size_t bytes) {
+    fake_time_advance((int64_t)bytes * 9 * 1000000 / dev->scl_speed_hz);
+}
+
+static esp_err_t fake_i2c_xfer(i2c_master_dev_handle_t dev, const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len,
+                               int timeout_ms) {
+    if (!fake_handle_ok(dev, dev && dev->alive && dev->bus->alive) || tx == NULL || tx_len == 0) return ESP_ERR_INVALID_ARG;
+    s.stats.transactions++;
+    if (s.fail_transfers) {
+        s.fail_transfers--;
+        if (s.fail_err == ESP_ERR_TIMEOUT) {
+            fake_time_advance((int64_t)timeout_ms * 1000);
+        } else {
+            fake_i2c_wire_time(dev, 1);
+        }
+        return s.fail_err;
+    }
+    if (s.mux_addr && dev->addr == s.mux_addr) {
+        s.stats.mux_writes++;
+        fake_i2c_wire_time(dev, 1 + tx_len);
+        s.mux_mask = tx[tx_len - 1];
+        return ESP_OK;
+    }
+    bool routed = !s.mux_addr || (s.mux_mask & (1 << s.mux_channel));
+    if (dev->addr != APDS9960_I2C_ADDR || !routed) {
+        fake_i2c_wire_time(dev, 1);
+        return ESP_ERR_INVALID_STATE; // Address NACK
+    }
+    fake_i2c_wire_time(dev, 1 + tx_len + (rx_len ? 1 + rx_len : 0));
+    if (rx_len) {
+        s.stats.sensor_reads++;
+    } else {
+        s.stats.sensor_writes++;
+    }
+    fake_apds9960_transfer(tx, tx_len, rx, rx_len);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size, int xfer_timeout_ms) {
+    return fake_i2c_xfer(dev, write_buffer, write_size, NULL, 0, xfer_timeout_ms);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size,
+                                      uint8_t *read_buffer, size_t read_size, int xfer_timeout_ms) {
+    if (read_buffer == NULL || read_size == 0) return ESP_ERR_INVALID_ARG;
+    return fake_i2c_xfer(dev, write_buffer, write_size, read_buffer, read_size, xfer_timeout_ms);
+}
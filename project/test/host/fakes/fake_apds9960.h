@@ -0,0 +1,95 @@
+/**
+ * @file fake_apds9960.h
+ * @brief Simulated I2C master bus with one APDS-9960 (optionally behind a TCA9548A mux).
+ *
+ * Implements the i2c_master handle API on top of a register model of the sensor:
+ * auto-incrementing register access, the 32-dataset gesture FIFO behind 0xFC-0xFF,
+ * the proximity and gesture interrupts with their clear commands, and the open-drain
+ * INT pin. Every transaction advances the simulated clock by its wire time. Faults
+ * (stuck bus, NACKs, failing bus/device creation) can be injected, and handles are
+ * checked for use after removal.
+ */
+
+#ifndef FAKE_APDS9960_H
+#define FAKE_APDS9960_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "../../../include/apds9960_driver.h"
+
+/**
+ * @struct fake_i2c_stats_t
+ * @brief Bus activity seen by the simulation.
+ */
+typedef struct {
+    uint32_t transactions;    // Transfers that reached the bus (failed ones included)
+    uint32_t sensor_reads;    // transmit_receive calls addressed to the sensor
+    uint32_t sensor_writes;   // transmit calls addressed to the sensor
+    uint32_t mux_writes;      // transmit calls addressed to the mux
+    uint32_t buses_created;
+    uint32_t devices_added;
+    uint32_t devices_removed;
+    uint32_t invalid_handles; // Calls made with a NULL, removed or deleted handle
+} fake_i2c_stats_t;
+
+/**
+ * @brief Power-on state: empty bus, sensor registers at their datasheet defaults
+ * @param int_io Pin the sensor's INT line is wired to, GPIO_NUM_NC if none
+ * @param mux_addr Address of the mux in front of the sensor, 0 if it sits directly on the bus
+ * @param mux_channel Mux channel the sensor is on (ignored without a mux)
+ */
+void fake_apds9960_reset(gpio_num_t int_io, uint8_t mux_addr, int8_t mux_channel);
+
+/**
+ * @brief Bus counters since the last reset
+ */
+const fake_i2c_stats_t *fake_i2c_stats(void);
+
+/**
+ * @brief Make the next transfers fail without reaching the sensor
+ * @param count Number of transfers to fail
+ * @param err Error they return (ESP_ERR_TIMEOUT for a stuck bus, ESP_ERR_INVALID_STATE for a NACK)
+ */
+void fake_i2c_fail_transfers(uint32_t count, esp_err_t err);
+
+/**
+ * @brief Make the next bus or device creations fail
+ * @param skip Creations that still succeed first
+ * @param count Creations that fail after those
+ */
+void fake_i2c_fail_setup(uint32_t skip, uint32_t count);
+
+/**
+ * @brief Raw register of the sensor, as the chip holds it
+ * @param reg Register address
+ */
+uint8_t fake_apds9960_reg(uint8_t reg);
+
+/**
+ * @brief Override a register from the chip side (e.g. a different ID)
+ * @param reg Register address
+ * @param value Value
+ */
+void fake_apds9960_set_reg(uint8_t reg, uint8_t value);
+
+/**
+ * @brief Feed one proximity measurement, asserting PINT when it crosses the PILT/PIHT window
+ * @param pdata Proximity value
+ */
+void fake_apds9960_set_proximity(uint8_t pdata);
+
+/**
+ * @brief Feed gesture datasets into the FIFO, asserting GINT once the GFIFOTH level is reached
+ * @param datasets U/D/L/R datasets
+ * @param count Number of datasets, the FIFO overflows (GFOV) beyond 32
+ */
+void fake_apds9960_push(const apds9960_gesture_dataset_t *datasets, size_t count);
+
+/**
+ * @brief Datasets waiting in the FIFO
+ */
+uint8_t fake_apds9960_fifo_level(void);
+
+#endif // FAKE_APDS9960_H
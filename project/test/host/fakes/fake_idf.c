@@ -0,0 +1,335 @@
+#include "fake_idf.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "esp_heap_caps.h"
+
+#define FAKE_EVENTS_MAX 256
+
+typedef struct {
+    int64_t at_us;
+    uint32_t seq; // Events due at the same time fire in scheduling order
+    fake_event_fn_t fn;
+    void *arg;
+} fake_event_t;
+
+static int64_t s_now_us;
+static fake_event_t s_events[FAKE_EVENTS_MAX];
+static size_t s_num_events;
+static uint32_t s_event_seq;
+
+fake_heap_stats_t fake_heap;
+
+void fake_rtos_reset(void);
+void fake_rtos_preempt(void);
+void fake_gpio_reset(void);
+
+// Log
+
+void fake_log(char level, const char *tag, const char *format, ...) {
+    static int verbose = -1;
+    if (verbose < 0) {
+        const char *env = getenv("HOST_TEST_VERBOSE");
+        verbose = env && env[0] == '1';
+    }
+    if (!verbose) return;
+    va_list args;
+    va_start(args, format);
+    printf("%c (%lld) %s: ", level, (long long)(s_now_us / 1000), tag);
+    vprintf(format, args);
+    printf("\n");
+    va_end(args);
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_FAIL: return "ESP_FAIL";
+    case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+    default: return "UNKNOWN ERROR";
+    }
+}
+
+// Clock and events
+
+void fake_idf_reset(void) {
+    s_now_us = 0;
+    s_num_events = 0;
+    fake_gpio_reset();
+    fake_rtos_reset();
+}
+
+int64_t fake_time_now(void) {
+    return s_now_us;
+}
+
+int64_t fake_event_next(void) {
+    return s_num_events ? s_events[0].at_us : INT64_MAX;
+}
+
+void fake_event_at(int64_t at_us, fake_event_fn_t fn, void *arg) {
+    if (s_num_events == FAKE_EVENTS_MAX) {
+        fprintf(stderr, "fake_event_at: too many pending events\n");
+        abort();
+    }
+    // Keep the list sorted, the earliest event first
+    size_t n = s_num_events++;
+    fake_event_t event = { .at_us = at_us, .seq = s_event_seq++, .fn = fn, .arg = arg };
+    while (n > 0 && s_events[n - 1].at_us > at_us) {
+        s_events[n] = s_events[n - 1];
+        n--;
+    }
+    s_events[n] = event;
+}
+
+void fake_time_advance(int64_t us) {
+    int64_t target = s_now_us + (us > 0 ? us : 0);
+    while (s_num_events && s_events[0].at_us <= target) {
+        fake_event_t event = s_events[0];
+        s_num_events--;
+        for (size_t n = 0; n < s_num_events; n++) s_events[n] = s_events[n + 1];
+        if (event.at_us > s_now_us) s_now_us = event.at_us;
+        event.fn(event.arg);
+    }
+    s_now_us = target;
+    fake_rtos_preempt(); // An event may have readied a higher priority task
+}
+
+int64_t esp_timer_get_time(void) {
+    return s_now_us;
+}
+
+void esp_rom_delay_us(uint32_t us) {
+    fake_time_advance(us);
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// Periodic esp_timer callbacks are events that reschedule themselves
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    uint64_t period_us;
+    uint32_t generation; // Bumped on stop so pending expiries of an older start are ignored
+    bool running;
+};
+
+typedef struct {
+    struct esp_timer *timer;
+    uint32_t generation;
+} fake_timer_expiry_t;
+
+static void fake_timer_expire(void *arg) {
+    fake_timer_expiry_t *expiry = arg;
+    struct esp_timer *timer = expiry->timer;
+    if (timer->running && expiry->generation == timer->generation) {
+        fake_event_at(s_now_us + timer->period_us, fake_timer_expire, expiry);
+        timer->args.callback(timer->args.arg);
+    } else {
+        free(expiry);
+    }
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (create_args == NULL || create_args->callback == NULL || out_handle == NULL) return ESP_ERR_INVALID_ARG;
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) return ESP_ERR_NO_MEM;
+    timer->args = *create_args;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    if (timer == NULL || period == 0) return ESP_ERR_INVALID_ARG;
+    if (timer->running) return ESP_ERR_INVALID_STATE;
+    fake_timer_expiry_t *expiry = malloc(sizeof(*expiry));
+    if (expiry == NULL) return ESP_ERR_NO_MEM;
+    timer->running = true;
+    timer->period_us = period;
+    *expiry = (fake_timer_expiry_t) { .timer = timer, .generation = timer->generation };
+    fake_event_at(s_now_us + period, fake_timer_expire, expiry);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (!timer->running) return ESP_ERR_INVALID_STATE;
+    timer->running = false;
+    timer->generation++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == NULL) return ESP_ERR_INVALID_ARG;
+    if (timer->running) return ESP_ERR_INVALID_STATE;
+    free(timer);
+    return ESP_OK;
+}
+
+// Heap: the Makefile links every test with --wrap for the malloc family
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+void *__wrap_malloc(size_t size) {
+    fake_heap.allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    fake_heap.allocs++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    fake_heap.allocs++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    if (ptr) fake_heap.frees++;
+    __real_free(ptr);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr) {
+    free(ptr);
+}
+
+// GPIO: a pin reads what an external driver forces onto it, otherwise its own output (pulled up when undriven)
+
+typedef struct {
+    int output;
+    int external; // -1 when nothing outside drives the pin
+    gpio_int_type_t intr_type;
+    gpio_isr_t isr;
+    void *isr_arg;
+} fake_gpio_t;
+
+static fake_gpio_t s_gpio[GPIO_NUM_MAX];
+static bool s_isr_service;
+static uint32_t s_isr_calls;
+
+void fake_gpio_reset(void) {
+    for (int n = 0; n < GPIO_NUM_MAX; n++) {
+        s_gpio[n] = (fake_gpio_t) { .output = 1, .external = -1 };
+    }
+    s_isr_service = false;
+    s_isr_calls = 0;
+}
+
+static inline bool fake_gpio_valid(gpio_num_t io) {
+    return io >= 0 && io < GPIO_NUM_MAX;
+}
+
+int fake_gpio_level(gpio_num_t io) {
+    if (!fake_gpio_valid(io)) return 0;
+    return s_gpio[io].external >= 0 ? s_gpio[io].external : s_gpio[io].output;
+}
+
+uint32_t fake_gpio_isr_calls(void) {
+    return s_isr_calls;
+}
+
+static void fake_gpio_changed(gpio_num_t io, int before) {
+    fake_gpio_t *pin = &s_gpio[io];
+    int after = fake_gpio_level(io);
+    if (!s_isr_service || pin->isr == NULL || before == after) return;
+    bool fire = false;
+    switch (pin->intr_type) {
+    case GPIO_INTR_POSEDGE: fire = after; break;
+    case GPIO_INTR_NEGEDGE: fire = !after; break;
+    case GPIO_INTR_ANYEDGE: fire = true; break;
+    case GPIO_INTR_LOW_LEVEL: fire = !after; break;
+    case GPIO_INTR_HIGH_LEVEL: fire = after; break;
+    default: break;
+    }
+    if (fire) {
+        s_isr_calls++;
+        pin->isr(pin->isr_arg);
+    }
+}
+
+void fake_gpio_drive(gpio_num_t io, int level) {
+    if (!fake_gpio_valid(io)) return;
+    int before = fake_gpio_level(io);
+    s_gpio[io].external = level;
+    fake_gpio_changed(io, before);
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    if (config == NULL || config->pin_bit_mask == 0 || config->pin_bit_mask >> GPIO_NUM_MAX) return ESP_ERR_INVALID_ARG;
+    for (int n = 0; n < GPIO_NUM_MAX; n++) {
+        if (config->pin_bit_mask & (1ULL << n)) s_gpio[n].intr_type = config->intr_type;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t io) {
+    if (!fake_gpio_valid(io)) return ESP_ERR_INVALID_ARG;
+    s_gpio[io].intr_type = GPIO_INTR_DISABLE;
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t io, gpio_mode_t mode) {
+    return fake_gpio_valid(io) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t io, uint32_t level) {
+    if (!fake_gpio_valid(io)) return ESP_ERR_INVALID_ARG;
+    int before = fake_gpio_level(io);
+    s_gpio[io].output = level ? 1 : 0;
+    fake_gpio_changed(io, before);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t io) {
+    return fake_gpio_level(io);
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    if (s_isr_service) return ESP_ERR_INVALID_STATE;
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t io, gpio_isr_t isr_handler, void *args) {
+    if (!fake_gpio_valid(io)) return ESP_ERR_INVALID_ARG;
+    if (!s_isr_service) return ESP_ERR_INVALID_STATE;
+    s_gpio[io].isr = isr_handler;
+    s_gpio[io].isr_arg = args;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t io) {
+    if (!fake_gpio_valid(io)) return ESP_ERR_INVALID_ARG;
+    s_gpio[io].isr = NULL;
+    return ESP_OK;
+}
@@ -0,0 +1,94 @@
+/**
+ * @file fake_idf.h
+ * @brief Control side of the simulated ESP-IDF runtime used by the host tests.
+ *
+ * Time only moves when the firmware waits: delays, blocking RTOS calls and bus
+ * transfers advance a simulated microsecond clock, and scheduled events (a sensor
+ * asserting INT, a hand entering the field) fire as the clock passes them. Tasks
+ * run as coroutines on the host thread with FreeRTOS priority rules, so a test can
+ * boot app_main and measure latencies in simulated time.
+ */
+
+#ifndef FAKE_IDF_H
+#define FAKE_IDF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+typedef void (*fake_event_fn_t)(void *arg);
+
+/**
+ * @struct fake_heap_stats_t
+ * @brief Heap calls made by the code under test (malloc family through the --wrap link flags, plus heap_caps_*).
+ */
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+} fake_heap_stats_t;
+
+extern fake_heap_stats_t fake_heap;
+
+/**
+ * @brief Reset the clock, events, GPIOs and tasks to power-on state
+ */
+void fake_idf_reset(void);
+
+/**
+ * @brief Current simulated time, what esp_timer_get_time() returns
+ */
+int64_t fake_time_now(void);
+
+/**
+ * @brief Let time pass, firing the events that fall due on the way
+ * @param us Microseconds to advance
+ */
+void fake_time_advance(int64_t us);
+
+/**
+ * @brief Schedule a callback at a simulated time, it runs in "interrupt" context
+ * @param at_us Absolute time, events in the past fire at the next advance
+ * @param fn Callback
+ * @param arg Passed to fn
+ */
+void fake_event_at(int64_t at_us, fake_event_fn_t fn, void *arg);
+
+/**
+ * @brief Time of the earliest pending event, INT64_MAX if there is none
+ */
+int64_t fake_event_next(void);
+
+/**
+ * @brief Drive an input pin from outside (e.g. a sensor's open-drain INT), firing its ISR on a matching edge
+ * @param io Pin
+ * @param level New level
+ */
+void fake_gpio_drive(gpio_num_t io, int level);
+
+/**
+ * @brief Level of a pin as the firmware sees it
+ * @param io Pin
+ */
+int fake_gpio_level(gpio_num_t io);
+
+/**
+ * @brief ISR handlers invoked so far by simulated edges
+ */
+uint32_t fake_gpio_isr_calls(void);
+
+/**
+ * @brief Run the created tasks until the simulated clock reaches end_us
+ * @param end_us Absolute time to stop at
+ */
+void fake_rtos_run_until(int64_t end_us);
+
+/**
+ * @brief Notification count of a task, as ulTaskNotifyTake() would see it
+ * @param task Task, or NULL for the test's own context
+ */
+uint32_t fake_rtos_notify_count(TaskHandle_t task);
+
+#endif // FAKE_IDF_H
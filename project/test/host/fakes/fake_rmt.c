@@ -0,0 +1,269 @@
+#include "fake_rmt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fake_idf.h"
+
+#define FAKE_RMT_CHANNELS 2 // TX channels of the ESP32-C3
+#define FAKE_RMT_QUEUE_MAX 8
+#define FAKE_RMT_FRAME_MAX 4096
+
+typedef struct {
+    struct rmt_channel_t *chan;
+    rmt_encoder_handle_t encoder;
+    const void *payload;
+    size_t size;
+    uint32_t hash; // Of the payload when queued, to catch it being rewritten while encoded
+    int64_t end_us;
+} fake_rmt_slot_t;
+
+struct rmt_channel_t {
+    rmt_tx_channel_config_t config;
+    bool enabled;
+    rmt_tx_done_callback_t on_trans_done;
+    void *user_data;
+    fake_rmt_slot_t queue[FAKE_RMT_QUEUE_MAX];
+    uint32_t head; // Transmission on the wire or next to go
+    uint32_t count;
+    int64_t busy_until_us;
+    uint64_t ticks;  // Symbol time emitted by the encoders in the current pass
+    bool recording;  // The encoders record the bytes, on the pass as a transmission ends
+    uint8_t frame[FAKE_RMT_FRAME_MAX];
+    size_t frame_len;
+    uint32_t frames;
+};
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_bytes_encoder_config_t config;
+} fake_rmt_bytes_encoder_t;
+
+static struct {
+    struct rmt_channel_t *channel[FAKE_RMT_CHANNELS];
+    fake_rmt_stats_t stats;
+} s;
+
+void fake_rmt_reset(void) {
+    for (int n = 0; n < FAKE_RMT_CHANNELS; n++) free(s.channel[n]);
+    memset(&s, 0, sizeof(s));
+}
+
+const fake_rmt_stats_t *fake_rmt_stats(void) {
+    return &s.stats;
+}
+
+static struct rmt_channel_t *fake_rmt_find(int gpio_num) {
+    for (int n = 0; n < FAKE_RMT_CHANNELS; n++) {
+        if (s.channel[n] && s.channel[n]->config.gpio_num == gpio_num) return s.channel[n];
+    }
+    return NULL;
+}
+
+const uint8_t *fake_rmt_frame(int gpio_num, size_t *len) {
+    struct rmt_channel_t *chan = fake_rmt_find(gpio_num);
+    *len = chan ? chan->frame_len : 0;
+    return chan ? chan->frame : NULL;
+}
+
+uint32_t fake_rmt_frames(int gpio_num) {
+    struct rmt_channel_t *chan = fake_rmt_find(gpio_num);
+    return chan ? chan->frames : 0;
+}
+
+static uint32_t fake_rmt_hash(const void *payload, size_t size) {
+    const uint8_t *data = payload;
+    uint32_t hash = 2166136261u;
+    for (size_t n = 0; n < size; n++) hash = (hash ^ data[n]) * 16777619u;
+    return hash;
+}
+
+static uint32_t fake_rmt_symbol_ticks(rmt_symbol_word_t symbol) {
+    return symbol.duration0 + symbol.duration1;
+}
+
+static size_t fake_rmt_bytes_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan, const void *primary_data, size_t data_size,
+                                    rmt_encode_state_t *ret_state) {
+    fake_rmt_bytes_encoder_t *bytes = (fake_rmt_bytes_encoder_t *)encoder;
+    const uint8_t *data = primary_data;
+    for (size_t n = 0; n < data_size; n++) {
+        for (int bit = 0; bit < 8; bit++) {
+            chan->ticks += fake_rmt_symbol_ticks((data[n] >> bit) & 1 ? bytes->config.bit1 : bytes->config.bit0);
+        }
+        if (chan->recording) {
+            if (chan->frame_len == FAKE_RMT_FRAME_MAX) {
+                fprintf(stderr, "fake_rmt: frame record full\n");
+                abort();
+            }
+            chan->frame[chan->frame_len++] = data[n];
+        }
+    }
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return data_size * 8;
+}
+
+static size_t fake_rmt_copy_encode(rmt_encoder_t *encoder, rmt_channel_handle_t chan, const void *primary_data, size_t data_size,
+                                   rmt_encode_state_t *ret_state) {
+    const rmt_symbol_word_t *symbols = primary_data;
+    for (size_t n = 0; n < data_size / sizeof(rmt_symbol_word_t); n++) chan->ticks += fake_rmt_symbol_ticks(symbols[n]);
+    *ret_state = RMT_ENCODING_COMPLETE;
+    return data_size / sizeof(rmt_symbol_word_t);
+}
+
+static esp_err_t fake_rmt_encoder_reset(rmt_encoder_t *encoder) {
+    return ESP_OK;
+}
+
+static esp_err_t fake_rmt_encoder_del(rmt_encoder_t *encoder) {
+    free(encoder);
+    s.stats.encoders_removed++;
+    return ESP_OK;
+}
+
+// One pass of the encoder over a payload, as the driver runs it for a transmission
+static void fake_rmt_encode(struct rmt_channel_t *chan, const fake_rmt_slot_t *slot) {
+    rmt_encode_state_t state = 0;
+    chan->ticks = 0;
+    rmt_encoder_reset(slot->encoder);
+    for (int pass = 0; pass < 16 && !(state & RMT_ENCODING_COMPLETE); pass++) {
+        slot->encoder->encode(slot->encoder, chan, slot->payload, slot->size, &state);
+    }
+    if (!(state & RMT_ENCODING_COMPLETE)) {
+        fprintf(stderr, "fake_rmt: encoder never completed\n");
+        abort();
+    }
+}
+
+static void fake_rmt_end(void *arg) {
+    struct rmt_channel_t *chan = arg;
+    fake_rmt_slot_t *slot = &chan->queue[chan->head];
+    if (fake_rmt_hash(slot->payload, slot->size) != slot->hash) s.stats.modified_in_flight++;
+    chan->frame_len = 0;
+    chan->recording = true;
+    fake_rmt_encode(chan, slot);
+    chan->recording = false;
+    chan->frames++;
+    chan->head = (chan->head + 1) % FAKE_RMT_QUEUE_MAX;
+    chan->count--;
+    if (chan->on_trans_done) {
+        rmt_tx_done_event_data_t edata = { .num_symbols = slot->size * 8 };
+        chan->on_trans_done(chan, &edata, chan->user_data);
+    }
+}
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan) {
+    if (config == NULL || ret_chan == NULL || config->resolution_hz == 0) return ESP_ERR_INVALID_ARG;
+    int n = 0;
+    while (n < FAKE_RMT_CHANNELS && s.channel[n]) n++;
+    if (n == FAKE_RMT_CHANNELS) return ESP_ERR_NOT_FOUND; // All TX channels in use
+    struct rmt_channel_t *chan = calloc(1, sizeof(*chan));
+    chan->config = *config;
+    s.channel[n] = chan;
+    s.stats.channels_added++;
+    *ret_chan = chan;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_channel(rmt_channel_handle_t channel) {
+    if (channel == NULL) return ESP_ERR_INVALID_ARG;
+    if (channel->enabled) return ESP_ERR_INVALID_STATE; // Deleted from the init state only
+    for (int n = 0; n < FAKE_RMT_CHANNELS; n++) {
+        if (s.channel[n] == channel) s.channel[n] = NULL;
+    }
+    free(channel);
+    s.stats.channels_removed++;
+    return ESP_OK;
+}
+
+esp_err_t rmt_enable(rmt_channel_handle_t channel) {
+    if (channel == NULL) return ESP_ERR_INVALID_ARG;
+    if (channel->enabled) return ESP_ERR_INVALID_STATE;
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_disable(rmt_channel_handle_t channel) {
+    if (channel == NULL) return ESP_ERR_INVALID_ARG;
+    if (!channel->enabled) return ESP_ERR_INVALID_STATE;
+    if (channel->count) {
+        // The driver would cut the frame short, nothing here expects that
+        fprintf(stderr, "fake_rmt: channel disabled with transmissions pending\n");
+        abort();
+    }
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t tx_channel, const rmt_tx_event_callbacks_t *cbs, void *user_data) {
+    if (tx_channel == NULL || cbs == NULL) return ESP_ERR_INVALID_ARG;
+    if (tx_channel->enabled) return ESP_ERR_INVALID_STATE;
+    tx_channel->on_trans_done = cbs->on_trans_done;
+    tx_channel->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload, size_t payload_bytes,
+                       const rmt_transmit_config_t *config) {
+    if (tx_channel == NULL || encoder == NULL || payload == NULL || payload_bytes == 0 || config == NULL) return ESP_ERR_INVALID_ARG;
+    if (!tx_channel->enabled) return ESP_ERR_INVALID_STATE;
+    if (tx_channel->count == tx_channel->config.trans_queue_depth || tx_channel->count == FAKE_RMT_QUEUE_MAX) {
+        // Blocks until the oldest transmission is done
+        fake_time_advance(tx_channel->queue[tx_channel->head].end_us - fake_time_now());
+    }
+    fake_rmt_slot_t *slot = &tx_channel->queue[(tx_channel->head + tx_channel->count) % FAKE_RMT_QUEUE_MAX];
+    slot->chan = tx_channel;
+    slot->encoder = encoder;
+    slot->payload = payload;
+    slot->size = payload_bytes;
+    slot->hash = fake_rmt_hash(payload, payload_bytes);
+    fake_rmt_encode(tx_channel, slot);
+    int64_t now = fake_time_now();
+    int64_t start = (tx_channel->busy_until_us > now ? tx_channel->busy_until_us : now) + FAKE_RMT_SETUP_US;
+    uint32_t resolution = tx_channel->config.resolution_hz;
+    slot->end_us = start + (int64_t)((tx_channel->ticks * 1000000 + resolution - 1) / resolution);
+    tx_channel->busy_until_us = slot->end_us;
+    tx_channel->count++;
+    s.stats.transmissions++;
+    fake_event_at(tx_channel->busy_until_us, fake_rmt_end, tx_channel);
+    return ESP_OK;
+}
+
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms) {
+    if (tx_channel == NULL) return ESP_ERR_INVALID_ARG;
+    if (tx_channel->count == 0) return ESP_OK;
+    int64_t now = fake_time_now();
+    if (timeout_ms >= 0 && now + (int64_t)timeout_ms * 1000 < tx_channel->busy_until_us) {
+        fake_time_advance((int64_t)timeout_ms * 1000);
+        return ESP_ERR_TIMEOUT;
+    }
+    fake_time_advance(tx_channel->busy_until_us - now);
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder) {
+    if (config == NULL || ret_encoder == NULL) return ESP_ERR_INVALID_ARG;
+    fake_rmt_bytes_encoder_t *encoder = calloc(1, sizeof(*encoder));
+    encoder->base = (rmt_encoder_t) { fake_rmt_bytes_encode, fake_rmt_encoder_reset, fake_rmt_encoder_del };
+    encoder->config = *config;
+    s.stats.encoders_added++;
+    *ret_encoder = &encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder) {
+    if (config == NULL || ret_encoder == NULL) return ESP_ERR_INVALID_ARG;
+    rmt_encoder_t *encoder = calloc(1, sizeof(*encoder));
+    *encoder = (rmt_encoder_t) { fake_rmt_copy_encode, fake_rmt_encoder_reset, fake_rmt_encoder_del };
+    s.stats.encoders_added++;
+    *ret_encoder = encoder;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder) {
+    if (encoder == NULL) return ESP_ERR_INVALID_ARG;
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder) {
+    if (encoder == NULL) return ESP_ERR_INVALID_ARG;
+    return encoder->reset(encoder);
+}
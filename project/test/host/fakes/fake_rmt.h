@@ -0,0 +1,59 @@
+/**
+ * @file fake_rmt.h
+ * @brief Simulated RMT TX driver with an LED strip on each channel's GPIO.
+ *
+ * rmt_transmit() runs the encoder over the payload to size the transmission:
+ * the fake bytes encoder emits one symbol per bit and the copy encoder copies
+ * symbols, their durations at the channel resolution give the wire time. The
+ * transmissions of a channel go out one after the other in simulated time, and
+ * the payload is encoded again as each one ends, so what is recorded is what the
+ * buffer held while it was on the wire; the done callback runs then too.
+ * rmt_tx_wait_all_done() waits on the simulated clock.
+ */
+
+#ifndef FAKE_RMT_H
+#define FAKE_RMT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "driver/rmt_tx.h"
+
+#define FAKE_RMT_SETUP_US 5 // Time the driver takes to start a queued transmission, an assumption of the model
+
+/**
+ * @struct fake_rmt_stats_t
+ * @brief RMT activity seen by the simulation.
+ */
+typedef struct {
+    uint32_t transmissions;      // rmt_transmit() calls accepted
+    uint32_t modified_in_flight; // Transmissions whose payload changed between being queued and leaving the wire
+    uint32_t channels_added;
+    uint32_t channels_removed;
+    uint32_t encoders_added;
+    uint32_t encoders_removed;
+} fake_rmt_stats_t;
+
+/**
+ * @brief Power-on state: no channel, nothing on the wire
+ */
+void fake_rmt_reset(void);
+
+/**
+ * @brief Counters since the last reset
+ */
+const fake_rmt_stats_t *fake_rmt_stats(void);
+
+/**
+ * @brief Payload bytes of the last transmission that left the channel on a GPIO, what its strip shows
+ * @param gpio_num GPIO of the channel
+ * @param[out] len Number of bytes, 0 if nothing was sent
+ */
+const uint8_t *fake_rmt_frame(int gpio_num, size_t *len);
+
+/**
+ * @brief Transmissions that left the channel on a GPIO
+ * @param gpio_num GPIO of the channel
+ */
+uint32_t fake_rmt_frames(int gpio_num);
+
+#endif // FAKE_RMT_H
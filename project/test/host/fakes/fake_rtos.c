@@ -0,0 +1,314 @@
+// FreeRTOS tasks, notifications and queues as coroutines on the host thread.
+// The highest priority ready task runs until it blocks; blocking calls return to the
+// scheduler in fake_rtos_run_until(), which moves the clock to the next wake-up or event.
+// Code running outside any task (the test itself) blocks by advancing the clock in place.
+#include "fake_idf.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+#include "freertos/queue.h"
+
+#define FAKE_TASK_STACK_SIZE (256 * 1024)
+#define FAKE_TASKS_MAX 16
+#define FAKE_TICK_US (1000000 / configTICK_RATE_HZ)
+
+typedef enum {
+    FAKE_TASK_READY,
+    FAKE_TASK_BLOCKED,
+    FAKE_TASK_DELETED,
+} fake_task_state_t;
+
+struct fake_task {
+    ucontext_t ctx;
+    void *stack;
+    TaskFunction_t fn;
+    void *arg;
+    UBaseType_t priority;
+    char name[16];
+    fake_task_state_t state;
+    bool (*unblock)(struct fake_task *task); // Wait condition while blocked, NULL for a plain delay
+    void *wait_obj;
+    int64_t wake_us;                          // Timeout of the current block, INT64_MAX for none
+    uint64_t last_run;                        // Round robin among equal priorities
+    uint32_t notify_value;
+    bool notify_pending;
+};
+
+struct fake_queue {
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+};
+
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+
+static struct fake_task s_tasks[FAKE_TASKS_MAX];
+static size_t s_num_tasks;
+static struct fake_task s_outside; // The test's own context
+static struct fake_task *s_current;
+static ucontext_t s_scheduler_ctx;
+static uint64_t s_switches;
+
+void fake_rtos_reset(void) {
+    for (size_t n = 0; n < s_num_tasks; n++) __real_free(s_tasks[n].stack);
+    memset(s_tasks, 0, sizeof(s_tasks));
+    s_num_tasks = 0;
+    s_outside = (struct fake_task) { .state = FAKE_TASK_READY };
+    strcpy(s_outside.name, "test");
+    s_current = NULL;
+}
+
+static inline struct fake_task *fake_rtos_self(void) {
+    return s_current ? s_current : &s_outside;
+}
+
+static inline bool fake_task_runnable(struct fake_task *task) {
+    if (task->state == FAKE_TASK_READY) return true;
+    if (task->state != FAKE_TASK_BLOCKED) return false;
+    return (task->unblock && task->unblock(task)) || task->wake_us <= fake_time_now();
+}
+
+static struct fake_task *fake_rtos_pick(void) {
+    struct fake_task *best = NULL;
+    for (size_t n = 0; n < s_num_tasks; n++) {
+        struct fake_task *task = &s_tasks[n];
+        if (!fake_task_runnable(task)) continue;
+        if (best == NULL || task->priority > best->priority ||
+            (task->priority == best->priority && task->last_run < best->last_run)) {
+            best = task;
+        }
+    }
+    return best;
+}
+
+// Block the caller until unblock() holds or the timeout passes
+static void fake_rtos_block(bool (*unblock)(struct fake_task *), void *wait_obj, TickType_t ticks) {
+    struct fake_task *self = fake_rtos_self();
+    self->unblock = unblock;
+    self->wait_obj = wait_obj;
+    self->wake_us = ticks == portMAX_DELAY ? INT64_MAX : fake_time_now() + (int64_t)ticks * FAKE_TICK_US;
+    if (unblock && unblock(self)) return;
+    if (ticks == 0) return;
+    self->state = FAKE_TASK_BLOCKED;
+    if (s_current) {
+        swapcontext(&s_current->ctx, &s_scheduler_ctx);
+    } else {
+        // Outside the scheduler nothing else runs, only events can end the wait
+        while (!fake_task_runnable(self)) {
+            int64_t next = fake_event_next();
+            if (next > self->wake_us) next = self->wake_us;
+            if (next == INT64_MAX) {
+                fprintf(stderr, "fake_rtos: test context blocked forever\n");
+                abort();
+            }
+            fake_time_advance(next - fake_time_now());
+        }
+    }
+    self->state = FAKE_TASK_READY;
+    self->unblock = NULL;
+}
+
+void fake_rtos_preempt(void) {
+    if (s_current == NULL) return;
+    struct fake_task *best = fake_rtos_pick();
+    if (best && best != s_current && best->priority > s_current->priority) {
+        swapcontext(&s_current->ctx, &s_scheduler_ctx);
+    }
+}
+
+static void fake_task_entry(void) {
+    struct fake_task *task = s_current;
+    task->fn(task->arg);
+    task->state = FAKE_TASK_DELETED; // Returning from a task is only legal for app_main, treat it as vTaskDelete(NULL)
+    setcontext(&s_scheduler_ctx);
+}
+
+void fake_rtos_run_until(int64_t end_us) {
+    while (1) {
+        struct fake_task *task = fake_rtos_pick();
+        if (task) {
+            task->state = FAKE_TASK_READY;
+            task->last_run = ++s_switches;
+            s_current = task;
+            swapcontext(&s_scheduler_ctx, &task->ctx);
+            s_current = NULL;
+            continue;
+        }
+        int64_t next = fake_event_next();
+        for (size_t n = 0; n < s_num_tasks; n++) {
+            if (s_tasks[n].state == FAKE_TASK_BLOCKED && s_tasks[n].wake_us < next) next = s_tasks[n].wake_us;
+        }
+        if (next > end_us) {
+            if (end_us > fake_time_now()) fake_time_advance(end_us - fake_time_now());
+            return;
+        }
+        fake_time_advance(next - fake_time_now());
+    }
+}
+
+uint32_t fake_rtos_notify_count(TaskHandle_t task) {
+    return (task ? task : &s_outside)->notify_value;
+}
+
+// Tasks
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created) {
+    if (s_num_tasks == FAKE_TASKS_MAX) return pdFAIL;
+    struct fake_task *task = &s_tasks[s_num_tasks++];
+    *task = (struct fake_task) {
+        .fn = fn,
+        .arg = arg,
+        .priority = priority,
+        .state = FAKE_TASK_READY,
+        .wake_us = INT64_MAX,
+    };
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    task->stack = __real_malloc(FAKE_TASK_STACK_SIZE);
+    getcontext(&task->ctx);
+    task->ctx.uc_stack.ss_sp = task->stack;
+    task->ctx.uc_stack.ss_size = FAKE_TASK_STACK_SIZE;
+    task->ctx.uc_link = &s_scheduler_ctx;
+    makecontext(&task->ctx, fake_task_entry, 0);
+    if (created) *created = task;
+    fake_rtos_preempt();
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    struct fake_task *target = task ? task : fake_rtos_self();
+    target->state = FAKE_TASK_DELETED;
+    if (target == s_current) swapcontext(&s_current->ctx, &s_scheduler_ctx);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return fake_rtos_self();
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(fake_time_now() / FAKE_TICK_US);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    fake_rtos_block(NULL, NULL, ticks);
+}
+
+void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    TickType_t now = xTaskGetTickCount();
+    *previous_wake = wake;
+    if ((int32_t)(wake - now) > 0) vTaskDelay(wake - now);
+}
+
+// Notifications
+
+static bool fake_notify_given(struct fake_task *task) {
+    return task->notify_value > 0;
+}
+
+static bool fake_notify_pending(struct fake_task *task) {
+    return task->notify_pending;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    struct fake_task *self = fake_rtos_self();
+    fake_rtos_block(fake_notify_given, NULL, ticks);
+    uint32_t value = self->notify_value;
+    if (value) self->notify_value = clear_on_exit ? 0 : value - 1;
+    self->notify_pending = false;
+    return value;
+}
+
+static void fake_notify(struct fake_task *task, uint32_t value, eNotifyAction action) {
+    switch (action) {
+    case eSetBits: task->notify_value |= value; break;
+    case eIncrement: task->notify_value++; break;
+    case eSetValueWithOverwrite: task->notify_value = value; break;
+    case eSetValueWithoutOverwrite:
+        if (!task->notify_pending) task->notify_value = value;
+        break;
+    default: break;
+    }
+    task->notify_pending = true;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    fake_notify(task, 0, eIncrement);
+    fake_rtos_preempt();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higher_priority_task_woken) {
+    fake_notify(task, 0, eIncrement);
+    if (higher_priority_task_woken && s_current && task->priority > s_current->priority) *higher_priority_task_woken = pdTRUE;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action) {
+    fake_notify(task, value, action);
+    fake_rtos_preempt();
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clear_on_entry, uint32_t clear_on_exit, uint32_t *value, TickType_t ticks) {
+    struct fake_task *self = fake_rtos_self();
+    if (!self->notify_pending) self->notify_value &= ~clear_on_entry;
+    fake_rtos_block(fake_notify_pending, NULL, ticks);
+    bool received = self->notify_pending;
+    if (value) *value = self->notify_value;
+    if (received) self->notify_value &= ~clear_on_exit;
+    self->notify_pending = false;
+    return received ? pdTRUE : pdFALSE;
+}
+
+// Queues
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct fake_queue *queue = calloc(1, sizeof(*queue));
+    if (queue == NULL) return NULL;
+    queue->items = calloc(length, item_size);
+    if (queue->items == NULL) {
+        free(queue);
+        return NULL;
+    }
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    free(queue->items);
+    free(queue);
+}
+
+static bool fake_queue_has_space(struct fake_task *task) {
+    struct fake_queue *queue = task->wait_obj;
+    return queue->count < queue->length;
+}
+
+static bool fake_queue_has_item(struct fake_task *task) {
+    struct fake_queue *queue = task->wait_obj;
+    return queue->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks) {
+    fake_rtos_block(fake_queue_has_space, queue, ticks);
+    if (queue->count == queue->length) return pdFAIL;
+    memcpy(queue->items + ((queue->head + queue->count) % queue->length) * queue->item_size, item, queue->item_size);
+    queue->count++;
+    fake_rtos_preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks) {
+    fake_rtos_block(fake_queue_has_item, queue, ticks);
+    if (queue->count == 0) return pdFAIL;
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    fake_rtos_preempt();
+    return pdPASS;
+}
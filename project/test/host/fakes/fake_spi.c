@@ -0,0 +1,243 @@
+#include "fake_spi.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_rom_gpio.h"
+#include "soc/spi_periph.h"
+#include "fake_idf.h"
+
+#define FAKE_SPI_HOSTS 3
+#define FAKE_SPI_QUEUE_MAX 8
+#define FAKE_SPI_WIRE_MAX (256 * 1024)
+
+const spi_signal_conn_t spi_periph_signal[FAKE_SPI_HOSTS];
+
+typedef struct {
+    struct spi_device_t *dev;
+    spi_transaction_t *desc;
+    uint32_t hash; // Of the buffer when queued, to catch it being rewritten under DMA
+    int64_t start_us;
+    int64_t end_us;
+    bool done;
+} fake_spi_slot_t;
+
+struct spi_device_t {
+    spi_host_device_t host;
+    spi_device_interface_config_t config;
+    fake_spi_slot_t queue[FAKE_SPI_QUEUE_MAX];
+    uint32_t head; // Oldest transaction whose result has not been collected
+    uint32_t count;
+    int64_t busy_until_us;
+};
+
+static struct {
+    bool bus[FAKE_SPI_HOSTS];
+    bool dma[FAKE_SPI_HOSTS];
+    struct spi_device_t *device[FAKE_SPI_HOSTS];
+    uint8_t wire[FAKE_SPI_WIRE_MAX];
+    size_t wire_len;
+    size_t pending;        // Start of the data the strip has not latched yet
+    size_t latched;        // Start and length of the data it latched last
+    size_t latched_len;
+    int64_t line_idle_us;  // When the last transaction ended
+    uint32_t delay_skip;
+    uint32_t delay_count;
+    int64_t delay_us;
+    uint32_t fail_skip;
+    esp_err_t fail_err;
+    fake_spi_stats_t stats;
+} s;
+
+void fake_spi_reset(void) {
+    for (int n = 0; n < FAKE_SPI_HOSTS; n++) free(s.device[n]);
+    memset(&s, 0, sizeof(s));
+}
+
+const fake_spi_stats_t *fake_spi_stats(void) {
+    return &s.stats;
+}
+
+const uint8_t *fake_spi_wire(size_t *len) {
+    *len = s.wire_len;
+    return s.wire;
+}
+
+void fake_spi_wire_clear(void) {
+    s.wire_len = 0;
+    s.pending = 0;
+    s.latched_len = 0;
+}
+
+// The strip latches the data it got once the line has been low for FAKE_SPI_LATCH_US
+static void fake_spi_latch(int64_t now) {
+    if (s.wire_len > s.pending && now - s.line_idle_us >= FAKE_SPI_LATCH_US) {
+        s.latched = s.pending;
+        s.latched_len = s.wire_len - s.pending;
+        s.pending = s.wire_len;
+        s.stats.frames_latched++;
+    }
+}
+
+const uint8_t *fake_spi_latched(size_t *len) {
+    fake_spi_latch(fake_time_now());
+    *len = s.latched_len;
+    return s.wire + s.latched;
+}
+
+void fake_spi_delay_queue(uint32_t skip, uint32_t count, int64_t us) {
+    s.delay_skip = skip;
+    s.delay_count = count;
+    s.delay_us = us;
+}
+
+void fake_spi_fail_queue(uint32_t skip, esp_err_t err) {
+    s.fail_skip = skip;
+    s.fail_err = err;
+}
+
+static uint32_t fake_spi_hash(const spi_transaction_t *desc) {
+    const uint8_t *data = desc->tx_buffer;
+    uint32_t hash = 2166136261u;
+    for (size_t n = 0; n < (desc->length + 7) / 8; n++) hash = (hash ^ data[n]) * 16777619u;
+    return hash;
+}
+
+static void fake_spi_start(void *arg) {
+    fake_spi_slot_t *slot = arg;
+    fake_spi_latch(slot->start_us);
+    if (slot->dev->config.pre_cb) slot->dev->config.pre_cb(slot->desc);
+}
+
+static void fake_spi_end(void *arg) {
+    fake_spi_slot_t *slot = arg;
+    size_t len = (slot->desc->length + 7) / 8;
+    if (fake_spi_hash(slot->desc) != slot->hash) s.stats.modified_in_flight++;
+    if (s.wire_len + len > FAKE_SPI_WIRE_MAX) {
+        fprintf(stderr, "fake_spi: wire record full\n");
+        abort();
+    }
+    memcpy(s.wire + s.wire_len, slot->desc->tx_buffer, len);
+    s.wire_len += len;
+    s.line_idle_us = slot->end_us;
+    slot->done = true;
+    if (slot->dev->config.post_cb) slot->dev->config.post_cb(slot->desc);
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_common_dma_t dma_chan) {
+    if (host_id < 0 || host_id >= FAKE_SPI_HOSTS || bus_config == NULL) return ESP_ERR_INVALID_ARG;
+    if (s.bus[host_id]) return ESP_ERR_INVALID_STATE;
+    s.bus[host_id] = true;
+    s.dma[host_id] = dma_chan != SPI_DMA_DISABLED;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id) {
+    if (host_id < 0 || host_id >= FAKE_SPI_HOSTS || !s.bus[host_id]) return ESP_ERR_INVALID_STATE;
+    if (s.device[host_id]) return ESP_ERR_INVALID_STATE;
+    s.bus[host_id] = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle) {
+    if (host_id < 0 || host_id >= FAKE_SPI_HOSTS || dev_config == NULL || handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (!s.bus[host_id] || s.device[host_id]) return ESP_ERR_INVALID_STATE; // One LED strip per bus
+    struct spi_device_t *dev = calloc(1, sizeof(*dev));
+    dev->host = host_id;
+    dev->config = *dev_config;
+    s.device[host_id] = dev;
+    s.stats.devices_added++;
+    *handle = dev;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    if (handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (handle->count) return ESP_ERR_INVALID_STATE; // Results must be collected first
+    s.device[handle->host] = NULL;
+    free(handle);
+    s.stats.devices_removed++;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_actual_freq(spi_device_handle_t handle, int *freq_khz) {
+    if (handle == NULL || freq_khz == NULL) return ESP_ERR_INVALID_ARG;
+    *freq_khz = handle->config.clock_speed_hz / 1000;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc, TickType_t ticks_to_wait) {
+    if (handle == NULL || trans_desc == NULL || trans_desc->tx_buffer == NULL || trans_desc->length == 0) return ESP_ERR_INVALID_ARG;
+    if (s.delay_skip) {
+        s.delay_skip--;
+    } else if (s.delay_count) {
+        s.delay_count--;
+        fake_time_advance(s.delay_us);
+    }
+    if (s.fail_err != ESP_OK && s.fail_skip-- == 0) {
+        esp_err_t err = s.fail_err;
+        s.fail_err = ESP_OK;
+        return err;
+    }
+    if (handle->count == FAKE_SPI_QUEUE_MAX || handle->count == (uint32_t)handle->config.queue_size) return ESP_ERR_TIMEOUT;
+    s.stats.transactions++;
+    size_t len = (trans_desc->length + 7) / 8;
+    if (s.dma[handle->host] && (((uintptr_t)trans_desc->tx_buffer | len) & 3)) {
+        // What spi_master does with it, the transaction is sent from the copy
+        void *bounce = heap_caps_malloc(len, MALLOC_CAP_DMA);
+        memcpy(bounce, trans_desc->tx_buffer, len);
+        heap_caps_free(bounce);
+        s.stats.bounce_copies++;
+    }
+    fake_spi_slot_t *slot = &handle->queue[(handle->head + handle->count++) % FAKE_SPI_QUEUE_MAX];
+    int64_t now = fake_time_now();
+    slot->dev = handle;
+    slot->desc = trans_desc;
+    slot->hash = fake_spi_hash(trans_desc);
+    slot->start_us = (handle->busy_until_us > now ? handle->busy_until_us : now) + FAKE_SPI_SETUP_US;
+    slot->end_us = slot->start_us + ((int64_t)trans_desc->length * 1000000 + handle->config.clock_speed_hz - 1) / handle->config.clock_speed_hz;
+    slot->done = false;
+    handle->busy_until_us = slot->end_us;
+    s.stats.in_flight++;
+    fake_event_at(slot->start_us, fake_spi_start, slot);
+    fake_event_at(slot->end_us, fake_spi_end, slot);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc, TickType_t ticks_to_wait) {
+    if (handle == NULL || trans_desc == NULL) return ESP_ERR_INVALID_ARG;
+    int64_t limit = ticks_to_wait == portMAX_DELAY ? INT64_MAX : fake_time_now() + (int64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+    if (handle->count == 0) {
+        if (limit == INT64_MAX) {
+            fprintf(stderr, "fake_spi: waiting forever for a result with nothing queued\n");
+            abort();
+        }
+        fake_time_advance(limit - fake_time_now());
+        return ESP_ERR_TIMEOUT;
+    }
+    fake_spi_slot_t *slot = &handle->queue[handle->head];
+    if (!slot->done) {
+        if (slot->end_us > limit) {
+            fake_time_advance(limit - fake_time_now());
+            return ESP_ERR_TIMEOUT;
+        }
+        fake_time_advance(slot->end_us - fake_time_now());
+    }
+    *trans_desc = slot->desc;
+    handle->head = (handle->head + 1) % FAKE_SPI_QUEUE_MAX;
+    handle->count--;
+    s.stats.in_flight--;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc) {
+    if (handle == NULL) return ESP_ERR_INVALID_ARG;
+    if (handle->count) return ESP_ERR_INVALID_STATE; // Not while queued transactions are pending
+    esp_err_t ret = spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+    if (ret != ESP_OK) return ret;
+    spi_transaction_t *done = NULL;
+    return spi_device_get_trans_result(handle, &done, portMAX_DELAY);
+}
+
+void esp_rom_gpio_connect_out_signal(uint32_t gpio_num, uint32_t signal_idx, bool out_inv, bool oen_inv) {
+}
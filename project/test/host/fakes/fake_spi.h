@@ -0,0 +1,81 @@
+/**
+ * @file fake_spi.h
+ * @brief Simulated spi_master driver with an LED strip on the MOSI line.
+ *
+ * Queued transactions go on the wire one after the other at the device's clock
+ * rate, in simulated time: the pre and post callbacks run as each one starts and
+ * ends, and spi_device_get_trans_result() waits on the simulated clock. The bytes
+ * are recorded as they leave, and the strip on the line latches what it got
+ * whenever the line idles long enough. Like spi_master with DMA, a transmit
+ * buffer whose address or length is not word aligned is first copied into a
+ * temporary allocation; the copies are counted. Queue calls can be held off (the
+ * calling task being preempted) or made to fail.
+ */
+
+#ifndef FAKE_SPI_H
+#define FAKE_SPI_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "driver/spi_master.h"
+
+#define FAKE_SPI_SETUP_US 8  // Time the driver takes to start a queued transaction, an assumption of the model
+#define FAKE_SPI_LATCH_US 50 // Low time after which the strip latches the data it got (WS2812 reset time)
+
+/**
+ * @struct fake_spi_stats_t
+ * @brief SPI activity seen by the simulation.
+ */
+typedef struct {
+    uint32_t transactions;       // Transactions queued or transmitted
+    uint32_t bounce_copies;      // DMA transactions copied to an aligned buffer first (an allocation each)
+    uint32_t modified_in_flight; // Transactions whose buffer changed between being queued and leaving the wire
+    uint32_t in_flight;          // Transactions whose result has not been collected yet
+    uint32_t frames_latched;     // Times the strip latched data, complete frames or not
+    uint32_t devices_added;
+    uint32_t devices_removed;
+} fake_spi_stats_t;
+
+/**
+ * @brief Power-on state: no bus, no device, nothing on the wire
+ */
+void fake_spi_reset(void);
+
+/**
+ * @brief Counters since the last reset
+ */
+const fake_spi_stats_t *fake_spi_stats(void);
+
+/**
+ * @brief Bytes that left the MOSI line since the last fake_spi_wire_clear()
+ * @param[out] len Number of bytes
+ */
+const uint8_t *fake_spi_wire(size_t *len);
+
+/**
+ * @brief Forget the recorded bytes
+ */
+void fake_spi_wire_clear(void);
+
+/**
+ * @brief Data the strip latched last, what it shows (latching what is pending if the line has been idle long enough)
+ * @param[out] len Number of bytes, 0 if nothing was latched since the last fake_spi_wire_clear()
+ */
+const uint8_t *fake_spi_latched(size_t *len);
+
+/**
+ * @brief Hold off queue calls, as if the calling task were preempted before it got to them
+ * @param skip Queue calls that still go through at once first
+ * @param count Queue calls delayed after those
+ * @param us Delay of each
+ */
+void fake_spi_delay_queue(uint32_t skip, uint32_t count, int64_t us);
+
+/**
+ * @brief Make a queue call fail
+ * @param skip Queue calls that still succeed first
+ * @param err Error the next one returns
+ */
+void fake_spi_fail_queue(uint32_t skip, esp_err_t err);
+
+#endif // FAKE_SPI_H
@@ -0,0 +1,70 @@
+// Replay traces captured on esp32/trace through the firmware's decoder and classifier and print
+// what the device decided for every trajectory:
+//
+//   make -C project/test/host replay TRACES="path/to/miss-*.gtrc"
+#include <stdio.h>
+#include <stdlib.h>
+#include "../../include/gesture_trace.h"
+#include "../../include/gesture_classifier.h"
+
+typedef struct {
+    gesture_decoder_t decoders[GESTURE_TRACE_MAX_SENSORS];
+    gesture_classifier_t classifiers[GESTURE_TRACE_MAX_SENSORS];
+    int64_t first_us;
+    uint32_t records;
+} replay_t;
+
+static void replay_sample(const gesture_sample_t *sample, void *ctx) {
+    replay_t *replay = ctx;
+    if (replay->records++ == 0) replay->first_us = sample->timestamp_us;
+    gesture_result_t result;
+    bool done = false;
+    if (sample->kind == GESTURE_SAMPLE_DATASET) {
+        done = gesture_decoder_push(&replay->decoders[sample->sensor], &sample->data, &result);
+    } else if (sample->kind == GESTURE_SAMPLE_EXIT) {
+        done = gesture_decoder_finish(&replay->decoders[sample->sensor], &result);
+    }
+    if (!done) return;
+    gesture_t tree = gesture_classifier_predict(&result);
+    gesture_t acted = gesture_classifier_run(&replay->classifiers[sample->sensor], &result, sample->timestamp_us);
+    printf("  %10.3f s  sensor %d  %-10s (tree %-8s) samples %3d  dUD %6ld  dLR %6ld  level %d/%d/%d\n",
+           (sample->timestamp_us - replay->first_us) / 1e6, sample->sensor, gesture_decoder_name(acted),
+           gesture_decoder_name(tree), result.samples, (long)result.ud_delta, (long)result.lr_delta,
+           result.entry_level, result.peak_level, result.exit_level);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s trace.gtrc...\n", argv[0]);
+        return 2;
+    }
+    int failed = 0;
+    for (int n = 1; n < argc; n++) {
+        FILE *f = fopen(argv[n], "rb");
+        if (f == NULL) {
+            perror(argv[n]);
+            failed = 1;
+            continue;
+        }
+        static uint8_t data[4 * GESTURE_TRACE_EXPORT_MAX]; // Also fits captures from builds with a larger GESTURE_TRACE_CAPACITY
+        size_t size = fread(data, 1, sizeof(data), f);
+        fclose(f);
+
+        replay_t replay = {0};
+        printf("%s\n", argv[n]);
+        esp_err_t ret = gesture_trace_replay(data, size, replay_sample, &replay);
+        if (ret != ESP_OK) {
+            printf("  not a readable gesture trace: %s\n", esp_err_to_name(ret));
+            failed = 1;
+            continue;
+        }
+        for (size_t s = 0; s < GESTURE_TRACE_MAX_SENSORS; s++) {
+            gesture_result_t result;
+            if (gesture_decoder_finish(&replay.decoders[s], &result)) {
+                printf("  (sensor %d still had an open trajectory of %d samples at the end)\n", (int)s, result.samples);
+            }
+        }
+        printf("  %lu records\n", (unsigned long)replay.records);
+    }
+    return failed;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file host_test.h
+ * @brief Minimal assertion and runner macros for the host tests.
+ *
+ * A failed check prints its location and marks the running test as failed, the
+ * test carries on so one run reports every broken expectation. main() returns
+ * non-zero if any test failed, which fails `make`.
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+static int host_test_failures;
+static int host_test_current_failed;
+
+#define TEST_CHECK(cond) do { \
+        if (!(cond)) { \
+            printf("  %s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_current_failed = 1; \
+        } \
+    } while (0)
+
+#define TEST_CHECK_EQ(expected, actual) do { \
+        long long e_ = (long long)(expected), a_ = (long long)(actual); \
+        if (e_ != a_) { \
+            printf("  %s:%d: %s == %s failed: expected %lld, got %lld\n", __FILE__, __LINE__, #expected, #actual, e_, a_); \
+            host_test_current_failed = 1; \
+        } \
+    } while (0)
+
+#define RUN_TEST(fn) do { \
+        host_test_current_failed = 0; \
+        fn(); \
+        printf("%s %s\n", host_test_current_failed ? "FAIL" : "ok  ", #fn); \
+        host_test_failures += host_test_current_failed; \
+    } while (0)
+
+#define TEST_EXIT_CODE() (host_test_failures ? 1 : 0)
+
+// Benchmark figures are printed with this prefix so they can be grepped out of the test log
+#define TEST_REPORT(fmt, ...) printf("  bench: " fmt "\n", ##__VA_ARGS__)
+
+/**
+ * @brief Host monotonic time in nanoseconds, for benchmarks
+ */
+static inline uint64_t host_test_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#endif // HOST_TEST_H
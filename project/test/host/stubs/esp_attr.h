@@ -0,0 +1,5 @@
+// Host stand-in for ESP-IDF's esp_attr.h, placement attributes have no meaning on the host
+#pragma once
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define WORD_ALIGNED_ATTR __attribute__((aligned(4)))
@@ -0,0 +1,5 @@
+// Host stand-in for ESP-IDF's esp_cpu.h, the cycle counter runs at the host clock in nanoseconds
+#pragma once
+#include <stdint.h>
+typedef uint32_t esp_cpu_cycle_count_t;
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void);
@@ -0,0 +1,11 @@
+// Host stand-in for ESP-IDF's esp_heap_caps.h, allocations are counted by fakes/fake_idf.c
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#define MALLOC_CAP_DEFAULT (1 << 12)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_8BIT (1 << 2)
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *heap_caps_malloc(size_t size, uint32_t caps);
+void heap_caps_free(void *ptr);
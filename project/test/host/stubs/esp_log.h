@@ -0,0 +1,12 @@
+// Host stand-in for ESP-IDF's esp_log.h, output only shows with HOST_TEST_VERBOSE=1 in the environment
+#pragma once
+#include "esp_err.h"
+#include "esp_rom_sys.h"
+
+void fake_log(char level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) fake_log('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fake_log('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fake_log('I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) fake_log('D', tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) fake_log('V', tag, format, ##__VA_ARGS__)
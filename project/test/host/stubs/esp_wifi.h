@@ -0,0 +1,4 @@
+// Host stand-in for ESP-IDF's esp_wifi.h, the tests never bring the network up
+#pragma once
+#include "esp_err.h"
+#include "esp_event.h"
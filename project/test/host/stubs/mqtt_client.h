@@ -0,0 +1,6 @@
+// Host stand-in for ESP-MQTT's mqtt_client.h, the tests never bring the network up
+#pragma once
+#include "esp_err.h"
+#include "esp_event.h"
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain);
@@ -0,0 +1,7 @@
+// Host stand-in for ESP-IDF's soc/spi_periph.h
+#pragma once
+#include <stdint.h>
+typedef struct {
+    uint8_t spid_out;
+} spi_signal_conn_t;
+extern const spi_signal_conn_t spi_periph_signal[];
@@ -0,0 +1,6 @@
+// Host stand-in adding newlib's __containerof to the host's sys/cdefs.h
+#include_next <sys/cdefs.h>
+#include <stddef.h>
+#ifndef __containerof
+#define __containerof(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+#endif
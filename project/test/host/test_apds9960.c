@@ -0,0 +1,230 @@
+// APDS-9960 driver against the simulated bus and sensor (fakes/fake_apds9960.c)
+#include <string.h>
+#include "host_test.h"
+#include "fake_idf.h"
+#include "fake_apds9960.h"
+#include "../../include/apds9960_driver.h"
+
+static apds9960_bus_t bus;
+static apds9960_dev_t dev;
+
+static const apds9960_bus_config_t bus_config = {
+    .port = I2C_MASTER_NUM,
+    .sda_io = I2C_MASTER_SDA_IO,
+    .scl_io = I2C_MASTER_SCL_IO,
+};
+
+static const apds9960_dev_config_t dev_config = {
+    .mux_channel = APDS9960_NO_MUX,
+    .int_io = APDS9960_INT_IO,
+};
+
+static const apds9960_gesture_dataset_t hand[4] = {
+    {120, 80, 100, 100}, {110, 90, 100, 100}, {100, 100, 100, 100}, {90, 110, 100, 100},
+};
+
+// Power-on sensor, initialised driver, INT routed to the test's own context
+static void setup(void) {
+    fake_idf_reset();
+    fake_apds9960_reset(APDS9960_INT_IO, 0, APDS9960_NO_MUX);
+    TEST_CHECK_EQ(ESP_OK, apds9960_bus_init(&bus, &bus_config));
+    TEST_CHECK_EQ(ESP_OK, apds9960_init(&dev, &bus, &dev_config));
+    TEST_CHECK_EQ(ESP_OK, apds9960_int_init(&dev, xTaskGetCurrentTaskHandle()));
+}
+
+static void test_init_programs_gesture_mode(void) {
+    setup();
+    TEST_CHECK_EQ(APDS9960_ENABLE_PON | APDS9960_ENABLE_PEN | APDS9960_ENABLE_PIEN | APDS9960_ENABLE_GEN,
+                  fake_apds9960_reg(APDS9960_ENABLE));
+    TEST_CHECK_EQ(APDS9960_GCONF4_GMODE | APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+    TEST_CHECK_EQ(1, fake_gpio_level(APDS9960_INT_IO)); // Nothing pending after init
+}
+
+// A hand crossing PIHT pulls INT low, the ISR has to notify the task passed to apds9960_int_init
+static void test_proximity_int_notifies_task(void) {
+    setup();
+    for (int n = 0; n < APDS9960_PPERS_DEFAULT; n++) fake_apds9960_set_proximity(APDS9960_PROX_GATE + 20);
+    TEST_CHECK_EQ(0, fake_gpio_level(APDS9960_INT_IO));
+    TEST_CHECK_EQ(1, fake_gpio_isr_calls());
+    TEST_CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, 0));
+
+    // INT stays low until the interrupt is cleared, no further edge in between
+    fake_apds9960_set_proximity(APDS9960_PROX_GATE + 30);
+    TEST_CHECK_EQ(1, fake_gpio_isr_calls());
+    TEST_CHECK_EQ(ESP_OK, apds9960_clear_interrupts(&dev));
+    TEST_CHECK_EQ(1, fake_gpio_level(APDS9960_INT_IO));
+    TEST_CHECK_EQ(0, ulTaskNotifyTake(pdTRUE, 0));
+}
+
+static void test_gesture_int_notifies_task(void) {
+    setup();
+    apds9960_enable_proximity_interrupt(&dev, false);
+    fake_apds9960_push(hand, 3); // Below GFIFOTH (4 datasets)
+    TEST_CHECK_EQ(0, ulTaskNotifyTake(pdTRUE, 0));
+    fake_apds9960_push(&hand[3], 1);
+    TEST_CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, 0));
+
+    // Draining the FIFO releases INT
+    apds9960_gesture_dataset_t fifo[APDS9960_GFIFO_DATASETS_MAX];
+    uint8_t level = 0;
+    TEST_CHECK_EQ(ESP_OK, apds9960_read_gesture_fifo_level(&dev, &level));
+    TEST_CHECK_EQ(4, level);
+    TEST_CHECK_EQ(ESP_OK, apds9960_read_gesture_fifo(&dev, level, fifo));
+    TEST_CHECK(memcmp(fifo, hand, sizeof(hand)) == 0);
+    TEST_CHECK_EQ(1, fake_gpio_level(APDS9960_INT_IO));
+}
+
+static void test_disabled_interrupts_stay_quiet(void) {
+    setup();
+    TEST_CHECK_EQ(ESP_OK, apds9960_enable_gesture_interrupt(&dev, false));
+    TEST_CHECK_EQ(ESP_OK, apds9960_enable_proximity_interrupt(&dev, false));
+    for (int n = 0; n < APDS9960_PPERS_DEFAULT; n++) fake_apds9960_set_proximity(255);
+    fake_apds9960_push(hand, 4);
+    TEST_CHECK_EQ(1, fake_gpio_level(APDS9960_INT_IO));
+    TEST_CHECK_EQ(0, fake_gpio_isr_calls());
+
+    // Re-enabling with the condition still pending asserts INT at once
+    TEST_CHECK_EQ(ESP_OK, apds9960_enable_gesture_interrupt(&dev, true));
+    TEST_CHECK_EQ(0, fake_gpio_level(APDS9960_INT_IO));
+    TEST_CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, 0));
+}
+
+static void hand_arrives(void *arg) {
+    for (int n = 0; n < APDS9960_PPERS_DEFAULT; n++) fake_apds9960_set_proximity(APDS9960_PROX_GATE + 20);
+}
+
+// A task blocked on the notification wakes at the edge, not at its timeout
+static void test_blocked_wait_ends_at_int_edge(void) {
+    setup();
+    int64_t start = fake_time_now();
+    fake_event_at(start + 3000, hand_arrives, NULL);
+    TEST_CHECK_EQ(1, ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(APDS9960_INT_FALLBACK_MS)));
+    TEST_CHECK_EQ(start + 3000, fake_time_now());
+}
+
+// Clearing the FIFO after the sensor left the gesture engine does not put it back in gesture mode
+static void test_fifo_clear_leaves_gesture_mode_off(void) {
+    setup();
+    fake_apds9960_push(hand, 4);
+    TEST_CHECK(fake_apds9960_fifo_level() > 0);
+    fake_apds9960_set_reg(APDS9960_GCONF4, APDS9960_GCONF4_GIEN); // The hand left, the sensor cleared GMODE
+    TEST_CHECK_EQ(ESP_OK, apds9960_clear_gesture_fifo(&dev));
+    TEST_CHECK_EQ(0, fake_apds9960_fifo_level());
+    TEST_CHECK_EQ(APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+
+    // Nor does a later change of the gesture interrupt
+    TEST_CHECK_EQ(ESP_OK, apds9960_enable_gesture_interrupt(&dev, true));
+    TEST_CHECK_EQ(APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+}
+
+// A stuck bus is recovered transparently, the sensor comes back with its configuration
+static void test_timeout_recovers_and_restores(void) {
+    setup();
+    uint8_t value = 0;
+    fake_i2c_fail_transfers(1, ESP_ERR_TIMEOUT);
+    TEST_CHECK_EQ(ESP_OK, apds9960_read_byte(&dev, APDS9960_PDATA, &value));
+    apds9960_stats_t stats;
+    apds9960_get_stats(&dev, &stats);
+    TEST_CHECK_EQ(1, stats.recoveries);
+    TEST_CHECK_EQ(2, fake_i2c_stats()->buses_created);
+    TEST_CHECK_EQ(APDS9960_GCONF4_GMODE | APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+    TEST_CHECK_EQ(0, fake_i2c_stats()->invalid_handles);
+}
+
+// Outside the gesture engine the restore leaves GMODE clear, it does not wake the engine with no hand present
+static void test_recovery_keeps_gesture_mode_off(void) {
+    setup();
+    fake_apds9960_set_reg(APDS9960_GCONF4, APDS9960_GCONF4_GIEN); // The hand left, the sensor cleared GMODE
+    uint8_t value = 0;
+    fake_i2c_fail_transfers(1, ESP_ERR_TIMEOUT);
+    TEST_CHECK_EQ(ESP_OK, apds9960_read_byte(&dev, APDS9960_PDATA, &value));
+    apds9960_stats_t stats;
+    apds9960_get_stats(&dev, &stats);
+    TEST_CHECK_EQ(1, stats.recoveries);
+    TEST_CHECK_EQ(APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+}
+
+// A recovery that cannot re-add the sensor leaves no half-built bus behind, and the next access retries it
+static void test_failed_recovery_is_retried(void) {
+    setup();
+    uint8_t value = 0;
+    fake_i2c_fail_transfers(1, ESP_ERR_TIMEOUT);
+    fake_i2c_fail_setup(1, 1); // New bus comes up, adding the sensor to it fails
+    TEST_CHECK(apds9960_read_byte(&dev, APDS9960_PDATA, &value) != ESP_OK);
+    TEST_CHECK(dev.handle == NULL && bus.handle == NULL);
+    TEST_CHECK_EQ(fake_i2c_stats()->devices_added, fake_i2c_stats()->devices_removed);
+
+    TEST_CHECK_EQ(ESP_OK, apds9960_read_byte(&dev, APDS9960_PDATA, &value));
+    apds9960_stats_t stats;
+    apds9960_get_stats(&dev, &stats);
+    TEST_CHECK_EQ(1, stats.recovery_failures);
+    TEST_CHECK_EQ(1, stats.recoveries);
+    TEST_CHECK_EQ(APDS9960_GCONF4_GMODE | APDS9960_GCONF4_GIEN, fake_apds9960_reg(APDS9960_GCONF4));
+    TEST_CHECK_EQ(0, fake_i2c_stats()->invalid_handles);
+}
+
+// A chip that fails the ID check is not left registered on the bus
+static void test_wrong_id_unregisters(void) {
+    fake_idf_reset();
+    fake_apds9960_reset(APDS9960_INT_IO, 0, APDS9960_NO_MUX);
+    uint8_t id = fake_apds9960_reg(APDS9960_ID);
+    fake_apds9960_set_reg(APDS9960_ID, 0x12);
+    TEST_CHECK_EQ(ESP_OK, apds9960_bus_init(&bus, &bus_config));
+    TEST_CHECK_EQ(ESP_FAIL, apds9960_init(&dev, &bus, &dev_config));
+    TEST_CHECK_EQ(0, bus.num_devs);
+    TEST_CHECK(dev.handle == NULL);
+    TEST_CHECK_EQ(fake_i2c_stats()->devices_added, fake_i2c_stats()->devices_removed);
+
+    fake_apds9960_set_reg(APDS9960_ID, id);
+    TEST_CHECK_EQ(ESP_OK, apds9960_init(&dev, &bus, &dev_config));
+    TEST_CHECK_EQ(1, bus.num_devs);
+    TEST_CHECK_EQ(0, fake_i2c_stats()->invalid_handles);
+}
+
+// Steady-state accesses must not touch the heap, the handles are created once at init
+static void test_accesses_do_not_allocate(void) {
+    setup();
+    apds9960_snapshot_t snap;
+    apds9960_gesture_dataset_t fifo[APDS9960_GFIFO_DATASETS_MAX];
+    uint32_t allocs = fake_heap.allocs;
+    uint32_t transactions = fake_i2c_stats()->transactions;
+    for (int n = 0; n < 1000; n++) {
+        fake_apds9960_push(hand, 4);
+        TEST_CHECK_EQ(ESP_OK, apds9960_read_snapshot(&dev, &snap));
+        TEST_CHECK_EQ(ESP_OK, apds9960_read_gesture_fifo(&dev, snap.gflvl, fifo));
+        TEST_CHECK_EQ(ESP_OK, apds9960_clear_interrupts(&dev));
+        apds9960_config_update(&dev, APDS9960_GCONF4, APDS9960_GCONF4_GIEN, n & 1 ? APDS9960_GCONF4_GIEN : 0);
+        TEST_CHECK_EQ(ESP_OK, apds9960_config_commit(&dev));
+    }
+    uint32_t count = fake_i2c_stats()->transactions - transactions;
+    TEST_CHECK_EQ(5000, count);
+    TEST_CHECK_EQ(0, fake_heap.allocs - allocs);
+    TEST_REPORT("%lu heap allocations over %lu transactions", (unsigned long)(fake_heap.allocs - allocs), (unsigned long)count);
+}
+
+// Host CPU time of one register read through the driver, the simulated bus itself costs next to nothing
+static void test_register_read_cost(void) {
+    setup();
+    uint8_t value;
+    const int reads = 200000;
+    uint64_t start = host_test_ns();
+    for (int n = 0; n < reads; n++) apds9960_read_byte(&dev, APDS9960_PDATA, &value);
+    uint64_t elapsed = host_test_ns() - start;
+    TEST_REPORT("apds9960_read_byte: %.1f ns per call on the host", (double)elapsed / reads);
+}
+
+int main(void) {
+    RUN_TEST(test_init_programs_gesture_mode);
+    RUN_TEST(test_proximity_int_notifies_task);
+    RUN_TEST(test_gesture_int_notifies_task);
+    RUN_TEST(test_disabled_interrupts_stay_quiet);
+    RUN_TEST(test_blocked_wait_ends_at_int_edge);
+    RUN_TEST(test_fifo_clear_leaves_gesture_mode_off);
+    RUN_TEST(test_timeout_recovers_and_restores);
+    RUN_TEST(test_recovery_keeps_gesture_mode_off);
+    RUN_TEST(test_failed_recovery_is_retried);
+    RUN_TEST(test_wrong_id_unregisters);
+    RUN_TEST(test_accesses_do_not_allocate);
+    RUN_TEST(test_register_read_cost);
+    return TEST_EXIT_CODE();
+}
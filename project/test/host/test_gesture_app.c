@@ -0,0 +1,282 @@
+// The whole gesture pipeline of project_main.c (acquisition and processing tasks, scheduler,
+// decoder, classifier) booted through app_main on the simulated RTOS, bus and sensor.
+// Network and LED output are replaced by recorders below.
+#include "../../main/project_main.c"
+#include "host_test.h"
+#include "fake_idf.h"
+#include "fake_apds9960.h"
+#include "trace_fixtures.h"
+
+#define DATASET_PERIOD_US 2800 // Gesture engine cycle with the driver's GPULSE/GCONF2 settings
+
+// Recorders for the collaborators outside the gesture pipeline
+
+static struct {
+    int count;
+    uint8_t gesture;
+    int64_t at_us;
+} blinks;
+
+static int spots;
+
+const char *blink_led(uint8_t code) {
+    if (code != GESTURE_NONE) {
+        blinks.count++;
+        blinks.gesture = code;
+        blinks.at_us = fake_time_now();
+    }
+    return gesture_decoder_name(code);
+}
+
+void led_show_color(void) {}
+void led_spot(uint32_t center, uint8_t level) { spots++; }
+void led_get_render_stats(led_render_stats_t *stats) { *stats = (led_render_stats_t) {0}; }
+void configure_led(void) {}
+// Gestures published on esp32/gesture, space separated
+static char published[256];
+
+void publish(const char *topic, const char *message) {
+    if (strcmp(topic, "esp32/gesture") == 0 && strlen(published) + strlen(message) + 2 < sizeof(published)) {
+        strcat(published, published[0] ? " " : "");
+        strcat(published, message);
+    }
+}
+void publish_binary(const char *topic, const void *data, size_t len) {}
+void wifi_init() {}
+void mqtt_init() {}
+esp_err_t nvs_flash_init(void) { return ESP_OK; }
+
+// A scripted hand: proximity above the gate while the datasets stream in, then gone
+
+typedef struct {
+    const apds9960_gesture_dataset_t *datasets;
+    size_t count;
+    size_t next;
+    int64_t last_int_us; // When the sensor last pulled INT low for this hand
+} hand_script_t;
+
+static hand_script_t hand;
+
+static void hand_step(void *arg) {
+    hand_script_t *script = arg;
+    if (script->next == script->count) {
+        fake_apds9960_set_proximity(0);
+        return;
+    }
+    int before = fake_gpio_level(APDS9960_INT_IO);
+    fake_apds9960_set_proximity(200);
+    fake_apds9960_push(&script->datasets[script->next++], 1);
+    if (before && !fake_gpio_level(APDS9960_INT_IO)) script->last_int_us = fake_time_now();
+    fake_event_at(fake_time_now() + DATASET_PERIOD_US, hand_step, script);
+}
+
+static void hand_start(const apds9960_gesture_dataset_t *datasets, size_t count, int64_t at_us) {
+    hand = (hand_script_t) { .datasets = datasets, .count = count };
+    fake_event_at(at_us, hand_step, &hand);
+}
+
+// Hand enters over U and leaves over D, the last dataset is the exit below the decoder threshold
+static const apds9960_gesture_dataset_t swipe_up[12] = {
+    {200, 20, 90, 90}, {190, 40, 100, 100}, {170, 60, 110, 110}, {150, 80, 120, 120},
+    {130, 100, 120, 120}, {110, 120, 120, 120}, {90, 140, 120, 120}, {70, 160, 110, 110},
+    {50, 180, 100, 100}, {30, 190, 90, 90}, {20, 200, 80, 80}, {0, 0, 0, 0},
+};
+
+// Background reflection with no hand over the sensor: below APDS9960_PROX_GATE but above the pre-gate PIHT of 40
+#define AMBIENT_PDATA 60
+#define AMBIENT_PERIOD_US 10000 // One proximity cycle every 10 ms
+
+static void ambient_step(void *arg) {
+    fake_apds9960_set_proximity(AMBIENT_PDATA);
+    fake_event_at(fake_time_now() + AMBIENT_PERIOD_US, ambient_step, NULL);
+}
+
+// Bus transactions made by the firmware during one minute of ambient-only proximity
+static uint32_t idle_minute_transactions(void) {
+    int64_t start = fake_time_now();
+    uint32_t before = fake_i2c_stats()->transactions;
+    fake_event_at(start + AMBIENT_PERIOD_US, ambient_step, NULL);
+    fake_rtos_run_until(start + 60 * 1000 * 1000LL);
+    return fake_i2c_stats()->transactions - before;
+}
+
+static void main_task(void *arg) {
+    app_main();
+}
+
+// Power up the sensor and boot the firmware up to the point where both gesture tasks wait for INT
+static void boot(void) {
+    fake_idf_reset();
+    fake_apds9960_reset(APDS9960_INT_IO, 0, APDS9960_NO_MUX);
+    blinks = (typeof(blinks)) {0};
+    spots = 0;
+    tracking_mode = false;
+    spot_dirty = false;
+    xTaskCreate(main_task, "main", 3584, NULL, 1, NULL);
+    fake_rtos_run_until(10 * 1000 * 1000);
+}
+
+// Swipe latency: from the sensor asserting INT for the batch that holds the exit to blink_led()
+static void test_swipe_reaches_leds_within_20ms(void) {
+    boot();
+    int64_t start = fake_time_now();
+    hand_start(swipe_up, 12, start + 1000);
+    fake_rtos_run_until(start + 1000 * 1000);
+
+    TEST_CHECK_EQ(1, blinks.count);
+    TEST_CHECK_EQ(GESTURE_UP, blinks.gesture);
+    int64_t latency_us = blinks.at_us - hand.last_int_us;
+    TEST_CHECK(latency_us >= 0 && latency_us < 20 * 1000);
+    TEST_REPORT("INT to blink_led: %lld us (simulated I2C wire time at %d Hz)", (long long)latency_us, I2C_MASTER_FREQ_HZ);
+}
+
+// Without INT wired the same swipe is only seen by the scheduler's polls
+static void test_swipe_with_int_edges_dropped_is_late(void) {
+    boot();
+    gpio_isr_handler_remove(APDS9960_INT_IO);
+    int64_t start = fake_time_now();
+    hand_start(swipe_up, 12, start + 1000);
+    fake_rtos_run_until(start + 2 * APDS9960_INT_FALLBACK_MS * 1000LL);
+
+    // The fallback poll still catches the hand, long after the fact
+    TEST_CHECK_EQ(1, blinks.count);
+    TEST_CHECK(blinks.at_us - hand.last_int_us > 20 * 1000);
+}
+
+// With the PIHT/GPENTH gate only the missed-edge fallback touches the bus while nobody is there
+static void test_idle_bus_traffic(void) {
+    boot();
+    uint32_t gated = idle_minute_transactions();
+    TEST_CHECK_EQ(0, blinks.count);
+    TEST_CHECK(gated <= 60 / (APDS9960_INT_FALLBACK_MS / 1000) * 4); // Snapshot (2), FIFO clear, interrupt clear per wake
+    TEST_REPORT("idle I2C transactions per minute: %lu with the proximity gate", (unsigned long)gated);
+
+    // Same firmware with the sensor programmed the way it was before the gate: PIHT 40, no persistence, no GPENTH
+    apds9960_config_set(&sensors[0], APDS9960_PIHT, 40);
+    apds9960_config_set(&sensors[0], APDS9960_PERS, 0);
+    apds9960_config_set(&sensors[0], APDS9960_GPENTH, 0);
+    TEST_CHECK_EQ(ESP_OK, apds9960_config_commit(&sensors[0]));
+    uint32_t ungated = idle_minute_transactions();
+    TEST_CHECK(ungated > 10 * gated);
+    TEST_REPORT("idle I2C transactions per minute: %lu with the old thresholds", (unsigned long)ungated);
+}
+
+// Processing state as app_main leaves it, without booting
+static void reset_processing(void) {
+    for (size_t n = 0; n < GESTURE_SENSOR_COUNT; n++) {
+        gesture_decoder_init(&decoders[n]);
+        gesture_classifier_init(&classifiers[n]);
+        hand_tracker_init(&trackers[n]);
+        proximity_published_us[n] = 0;
+    }
+    tracking_mode = false;
+    spot_dirty = false;
+    published[0] = 0;
+}
+
+static void replay_file(const char *name) {
+    char path[64];
+    snprintf(path, sizeof(path), TRACE_DIR "%s", name);
+    size_t size = 0;
+    uint8_t *data = trace_fixture_load(path, &size);
+    TEST_CHECK(data != NULL);
+    if (data == NULL) return;
+    TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(data, size, gesture_process_sample, NULL));
+    free(data);
+}
+
+// Recorded traces go through the firmware's own sink, as they would on the device
+static void test_traces_replay_through_process_sample(void) {
+    static const struct {
+        const char *trace;
+        const char *published;
+    } cases[] = {
+        {"up_01.gtrc", "UP UP"},
+        {"right_02.gtrc", "RIGHT RIGHT"},
+        {"tap_01.gtrc", "TAP DOUBLE_TAP"},
+        {"approach_01.gtrc", "APPROACH APPROACH"},
+    };
+    for (size_t n = 0; n < sizeof(cases) / sizeof(cases[0]); n++) {
+        reset_processing();
+        replay_file(cases[n].trace);
+        if (strcmp(cases[n].published, published) != 0) {
+            printf("  %s: published \"%s\", expected \"%s\"\n", cases[n].trace, published, cases[n].published);
+            TEST_CHECK(!"unexpected gestures");
+        }
+    }
+}
+
+// HOLD starts tracking; the hand resting over the spot holds again without ending it, a double tap does
+static void test_tracking_ends_only_on_double_tap(void) {
+    reset_processing();
+    replay_file("hold_01.gtrc"); // Two holds
+    TEST_CHECK(tracking_mode);
+    replay_file("up_01.gtrc");   // Swipes drive the spot, not the strip effects
+    TEST_CHECK(tracking_mode);
+    int blinked = blinks.count;
+    replay_file("tap_01.gtrc");  // Tap, then double tap
+    TEST_CHECK(!tracking_mode);
+    TEST_CHECK_EQ(blinked, blinks.count);
+    TEST_CHECK(strcmp("HOLD HOLD UP UP TAP DOUBLE_TAP", published) == 0);
+
+    // A double tap outside tracking does nothing special
+    replay_file("tap_01.gtrc");
+    TEST_CHECK(!tracking_mode);
+}
+
+static void count_record(const gesture_sample_t *sample, void *ctx) {
+    (*(uint32_t *)ctx)++;
+    gesture_process_sample(sample, NULL);
+}
+
+// Host throughput of the processing path: every fixture this build has sensors for replayed through gesture_process_sample
+static void test_replay_throughput(void) {
+    glob_t traces;
+    TEST_CHECK_EQ(0, glob(TRACE_DIR "*.gtrc", 0, NULL, &traces));
+    const int passes = 200;
+    uint32_t records = 0;
+    uint64_t elapsed = 0;
+    for (size_t n = 0; n < traces.gl_pathc; n++) {
+        size_t size = 0;
+        uint8_t *data = trace_fixture_load(traces.gl_pathv[n], &size);
+        TEST_CHECK(data != NULL && size >= sizeof(gesture_trace_header_t));
+        if (data == NULL) continue;
+        if (size >= sizeof(gesture_trace_header_t) && ((gesture_trace_header_t *)data)->sensor_count <= GESTURE_SENSOR_COUNT) {
+            uint64_t start = host_test_ns();
+            for (int pass = 0; pass < passes; pass++) {
+                reset_processing();
+                TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(data, size, count_record, &records));
+            }
+            elapsed += host_test_ns() - start;
+        }
+        free(data);
+    }
+    globfree(&traces);
+    TEST_CHECK(records > 0);
+    if (records == 0) return;
+    TEST_REPORT("trace replay through gesture_process_sample: %.0f ns per record, %.1f M records/s on the host",
+                (double)elapsed / records, records * 1000.0 / elapsed);
+}
+
+// Records of sensors the build does not have are dropped, not processed with another sensor's state
+static void test_unknown_sensor_is_dropped(void) {
+    reset_processing();
+    gesture_sample_t sample = { .kind = GESTURE_SAMPLE_DATASET, .sensor = GESTURE_SENSOR_COUNT, .timestamp_us = 1000 };
+    memset(&sample.data, 0xFF, sizeof(sample.data));
+    gesture_process_sample(&sample, NULL);
+    sample.kind = GESTURE_SAMPLE_EXIT;
+    gesture_process_sample(&sample, NULL);
+    TEST_CHECK(published[0] == 0);
+    TEST_CHECK(!spot_dirty);
+}
+
+int main(void) {
+    RUN_TEST(test_swipe_reaches_leds_within_20ms);
+    RUN_TEST(test_swipe_with_int_edges_dropped_is_late);
+    RUN_TEST(test_idle_bus_traffic);
+    RUN_TEST(test_traces_replay_through_process_sample);
+    RUN_TEST(test_tracking_ends_only_on_double_tap);
+    RUN_TEST(test_replay_throughput);
+    RUN_TEST(test_unknown_sensor_is_dropped);
+    return TEST_EXIT_CODE();
+}
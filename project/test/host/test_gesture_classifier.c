@@ -0,0 +1,150 @@
+// Decision-tree classifier over the decoded traces in traces/, against the Python port's features and
+// its walk of the same model table (traces/classifier.golden)
+#include <ctype.h>
+#include "host_test.h"
+#include "trace_fixtures.h"
+#include "../../include/gesture_classifier.h"
+
+typedef struct {
+    const char *name;
+    gesture_decoder_t decoders[GESTURE_TRACE_MAX_SENSORS];
+    gesture_classifier_t classifiers[GESTURE_TRACE_MAX_SENSORS];
+    char *out;
+    size_t len;
+    gesture_t run[8]; // gesture_classifier_run() results of the current trace
+    size_t runs;
+} replay_t;
+
+// "tap_01.gtrc" -> "TAP", compared with gesture_decoder_name()
+static bool label_matches(const char *name, gesture_t gesture) {
+    const char *label = gesture_decoder_name(gesture);
+    size_t n = 0;
+    for (; label[n]; n++) {
+        if (toupper((unsigned char)name[n]) != label[n]) return false;
+    }
+    return name[n] == '_';
+}
+
+static void begin_trace(const char *name, void *ctx) {
+    replay_t *replay = ctx;
+    replay->name = name;
+    replay->runs = 0;
+    for (size_t n = 0; n < GESTURE_TRACE_MAX_SENSORS; n++) {
+        gesture_decoder_init(&replay->decoders[n]);
+        gesture_classifier_init(&replay->classifiers[n]);
+    }
+}
+
+// Decode like gesture_process_sample(), then classify every trajectory, printed like `--dump classifier`
+static void classify_sample(const gesture_sample_t *sample, void *ctx) {
+    replay_t *replay = ctx;
+    gesture_result_t result;
+    bool done = false;
+    if (sample->kind == GESTURE_SAMPLE_DATASET) {
+        done = gesture_decoder_push(&replay->decoders[sample->sensor], &sample->data, &result);
+    } else if (sample->kind == GESTURE_SAMPLE_EXIT) {
+        done = gesture_decoder_finish(&replay->decoders[sample->sensor], &result);
+    }
+    if (!done) return;
+
+    int32_t features[GESTURE_FEATURE_COUNT];
+    gesture_classifier_features(&result, features);
+    gesture_t predicted = gesture_classifier_predict(&result);
+    replay->len += snprintf(replay->out + replay->len, TRACE_DUMP_MAX - replay->len, "%s %d", replay->name, sample->sensor);
+    for (int f = 0; f < GESTURE_FEATURE_COUNT; f++) {
+        replay->len += snprintf(replay->out + replay->len, TRACE_DUMP_MAX - replay->len, " %ld", (long)features[f]);
+    }
+    replay->len += snprintf(replay->out + replay->len, TRACE_DUMP_MAX - replay->len, " %s\n", gesture_decoder_name(predicted));
+
+    // Labelled fixtures must come out as their label, NONE ones only test the maths
+    if (strncmp(replay->name, "none_", 5) != 0) TEST_CHECK(label_matches(replay->name, predicted));
+    if (replay->runs < 8) {
+        replay->run[replay->runs++] = gesture_classifier_run(&replay->classifiers[sample->sensor], &result, sample->timestamp_us);
+    }
+}
+
+// Features and predictions for every trajectory, bit for bit what the Python port computes
+static void test_traces_match_python_port(void) {
+    static char dump[TRACE_DUMP_MAX];
+    replay_t replay = { .out = dump };
+    TEST_CHECK(trace_fixture_replay_all(begin_trace, classify_sample, &replay) > 0);
+    trace_fixture_check_golden(dump, "classifier.golden");
+}
+
+static void check_tap_pairs(const char *name, void *ctx) {
+    replay_t *replay = ctx;
+    // The previous trace is complete: each tap fixture holds two taps 400 ms apart
+    if (replay->name && strncmp(replay->name, "tap_", 4) == 0) {
+        TEST_CHECK_EQ(2, replay->runs);
+        TEST_CHECK_EQ(GESTURE_TAP, replay->run[0]);
+        TEST_CHECK_EQ(GESTURE_DOUBLE_TAP, replay->run[1]);
+    }
+    if (name) begin_trace(name, ctx);
+}
+
+static void test_taps_pair_into_double_tap(void) {
+    static char dump[TRACE_DUMP_MAX];
+    replay_t replay = { .out = dump };
+    trace_fixture_replay_all(check_tap_pairs, classify_sample, &replay);
+    check_tap_pairs(NULL, &replay);
+
+    // Outside the window the second tap starts a new pair
+    gesture_classifier_t cls;
+    gesture_classifier_init(&cls);
+    gesture_result_t tap = { .samples = 9, .entry_level = 240, .peak_level = 800, .exit_level = 780 };
+    TEST_CHECK_EQ(GESTURE_TAP, gesture_classifier_run(&cls, &tap, 1000000));
+    TEST_CHECK_EQ(GESTURE_TAP, gesture_classifier_run(&cls, &tap, 1000001 + GESTURE_DOUBLE_TAP_WINDOW_US));
+    TEST_CHECK_EQ(GESTURE_DOUBLE_TAP, gesture_classifier_run(&cls, &tap, 1000001 + 2 * GESTURE_DOUBLE_TAP_WINDOW_US));
+}
+
+static void collect_result(const gesture_sample_t *sample, void *ctx) {
+    replay_t *replay = ctx;
+    gesture_result_t result;
+    bool done = false;
+    if (sample->kind == GESTURE_SAMPLE_DATASET) {
+        done = gesture_decoder_push(&replay->decoders[sample->sensor], &sample->data, &result);
+    } else if (sample->kind == GESTURE_SAMPLE_EXIT) {
+        done = gesture_decoder_finish(&replay->decoders[sample->sensor], &result);
+    }
+    if (done && replay->len + sizeof(result) <= TRACE_DUMP_MAX) {
+        memcpy(replay->out + replay->len, &result, sizeof(result));
+        replay->len += sizeof(result);
+    }
+}
+
+static int tree_depth(uint16_t idx) {
+    const gesture_tree_node_t *node = &gesture_model_nodes[idx];
+    if (node->feature == GESTURE_TREE_LEAF) return 0;
+    int left = tree_depth(idx + 1), right = tree_depth(node->right);
+    return 1 + (left > right ? left : right);
+}
+
+// Host CPU time of one inference over the fixture trajectories; the walk is bounded by the tree depth
+static void test_inference_cost(void) {
+    static gesture_result_t results[TRACE_DUMP_MAX / sizeof(gesture_result_t)];
+    replay_t replay = { .out = (char *)results };
+    trace_fixture_replay_all(begin_trace, collect_result, &replay);
+    size_t count = replay.len / sizeof(gesture_result_t);
+    TEST_CHECK(count > 0);
+    if (count == 0) return;
+
+    const int passes = 20000;
+    uint32_t swipes = 0;
+    uint64_t start = host_test_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t n = 0; n < count; n++) swipes += gesture_classifier_predict(&results[n]) <= GESTURE_RIGHT;
+    }
+    uint64_t elapsed = host_test_ns() - start;
+    TEST_CHECK(swipes > 0);
+    int depth = tree_depth(0);
+    TEST_CHECK(depth <= GESTURE_TREE_MAX_DEPTH);
+    TEST_REPORT("gesture_classifier_predict: %.1f ns per trajectory on the host (%d nodes, depth %d)",
+                (double)elapsed / ((double)count * passes), gesture_model_node_count, depth);
+}
+
+int main(void) {
+    RUN_TEST(test_traces_match_python_port);
+    RUN_TEST(test_taps_pair_into_double_tap);
+    RUN_TEST(test_inference_cost);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,112 @@
+// Swipe decoder replayed over the traces in traces/, against the output of the Python port in
+// tools/train_gesture_model.py (traces/decoder.golden). `make check-golden` guards the Python side.
+#include "host_test.h"
+#include "trace_fixtures.h"
+#include "../../include/gesture_decoder.h"
+
+typedef struct {
+    const char *name;
+    gesture_decoder_t decoders[GESTURE_TRACE_MAX_SENSORS];
+    char *out;
+    size_t len;
+    uint32_t trajectories;
+    uint32_t swipes[GESTURE_RIGHT + 1];
+} replay_t;
+
+static const char *gesture_prefix(gesture_t gesture) {
+    switch (gesture) {
+    case GESTURE_UP: return "up_";
+    case GESTURE_DOWN: return "down_";
+    case GESTURE_LEFT: return "left_";
+    case GESTURE_RIGHT: return "right_";
+    default: return NULL;
+    }
+}
+
+// The swipe fixtures also have to decode as what their name says
+static void check_swipe_labels(const replay_t *replay) {
+    if (replay->name == NULL) return;
+    for (gesture_t g = GESTURE_UP; g <= GESTURE_RIGHT; g++) {
+        if (strncmp(replay->name, gesture_prefix(g), strlen(gesture_prefix(g))) == 0) {
+            TEST_CHECK_EQ(replay->trajectories, replay->swipes[g]);
+        }
+    }
+}
+
+static void begin_trace(const char *name, void *ctx) {
+    replay_t *replay = ctx;
+    check_swipe_labels(replay);
+    replay->name = name;
+    replay->trajectories = 0;
+    memset(replay->decoders, 0, sizeof(replay->decoders));
+    memset(replay->swipes, 0, sizeof(replay->swipes));
+}
+
+// Same handling as gesture_process_sample() in project_main.c, printed like `--dump decoder`
+static void decode_sample(const gesture_sample_t *sample, void *ctx) {
+    replay_t *replay = ctx;
+    gesture_decoder_t *dec = &replay->decoders[sample->sensor];
+    gesture_result_t result;
+    bool done;
+    if (sample->kind == GESTURE_SAMPLE_DATASET) {
+        done = gesture_decoder_push(dec, &sample->data, &result);
+    } else if (sample->kind == GESTURE_SAMPLE_EXIT) {
+        done = gesture_decoder_finish(dec, &result);
+    } else {
+        return;
+    }
+    if (!done) return;
+    replay->len += snprintf(replay->out + replay->len, TRACE_DUMP_MAX - replay->len, "%s %d %ld %ld %d %d %d %d\n",
+                            replay->name, sample->sensor, (long)result.ud_delta, (long)result.lr_delta, result.samples,
+                            result.entry_level, result.peak_level, result.exit_level);
+    replay->trajectories++;
+    if (result.gesture <= GESTURE_RIGHT) replay->swipes[result.gesture]++;
+}
+
+// Every trajectory of every trace, bit for bit what the Python port computes
+static void test_traces_match_python_port(void) {
+    static char dump[TRACE_DUMP_MAX];
+    replay_t replay = { .out = dump };
+    TEST_CHECK(trace_fixture_replay_all(begin_trace, decode_sample, &replay) > 0);
+    check_swipe_labels(&replay);
+    trace_fixture_check_golden(dump, "decoder.golden");
+}
+
+static void collect_dataset(const gesture_sample_t *sample, void *ctx) {
+    replay_t *replay = ctx;
+    if (sample->kind == GESTURE_SAMPLE_DATASET) {
+        memcpy(replay->out + replay->len, &sample->data, sizeof(sample->data));
+        replay->len += sizeof(sample->data);
+    }
+}
+
+// Host CPU time per dataset over every dataset of the traces
+static void test_decoder_cost(void) {
+    static char datasets[TRACE_DUMP_MAX];
+    replay_t replay = { .out = datasets };
+    trace_fixture_replay_all(NULL, collect_dataset, &replay);
+    size_t count = replay.len / sizeof(apds9960_gesture_dataset_t);
+    TEST_CHECK(count > 0);
+    if (count == 0) return;
+
+    const apds9960_gesture_dataset_t *all = (const apds9960_gesture_dataset_t *)datasets;
+    const int passes = 2000;
+    gesture_decoder_t dec;
+    gesture_result_t result;
+    uint32_t ended = 0;
+    gesture_decoder_init(&dec);
+    uint64_t start = host_test_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        for (size_t n = 0; n < count; n++) ended += gesture_decoder_push(&dec, &all[n], &result);
+    }
+    uint64_t elapsed = host_test_ns() - start;
+    TEST_CHECK(ended > 0);
+    TEST_REPORT("gesture_decoder_push: %.1f ns per dataset on the host (%lu datasets x %d)",
+                (double)elapsed / ((double)count * passes), (unsigned long)count, passes);
+}
+
+int main(void) {
+    RUN_TEST(test_traces_match_python_port);
+    RUN_TEST(test_decoder_cost);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,112 @@
+// Trace capture, export and replay round trips
+#include <string.h>
+#include "host_test.h"
+#include "../../include/gesture_trace.h"
+
+static gesture_trace_t trace;
+static uint8_t exported[GESTURE_TRACE_EXPORT_MAX];
+
+typedef struct {
+    gesture_sample_t samples[GESTURE_TRACE_CAPACITY];
+    size_t count;
+} collected_t;
+
+static void collect(const gesture_sample_t *sample, void *ctx) {
+    collected_t *out = ctx;
+    if (out->count < GESTURE_TRACE_CAPACITY) out->samples[out->count++] = *sample;
+}
+
+static gesture_sample_t sample_at(int64_t timestamp_us, uint8_t u) {
+    return (gesture_sample_t) {
+        .timestamp_us = timestamp_us,
+        .data = {u, 20, 30, 40},
+        .kind = GESTURE_SAMPLE_DATASET,
+        .sensor = 1,
+        .pdata = 150,
+    };
+}
+
+// A capture left running for hours keeps exact timestamps, past where 32-bit offsets would wrap (71.6 minutes)
+static void test_offsets_do_not_wrap(void) {
+    gesture_trace_init(&trace, NULL, 0);
+    const int64_t start = 3 * 1000 * 1000LL;
+    const int64_t later[] = {start, start + 4295 * 1000 * 1000LL, start + 30 * 24 * 3600 * 1000000LL};
+    for (int n = 0; n < 3; n++) {
+        gesture_sample_t sample = sample_at(later[n], 100 + n);
+        gesture_trace_record(&trace, &sample);
+    }
+    size_t len = gesture_trace_export(&trace, exported, sizeof(exported));
+    TEST_CHECK(len > 0);
+
+    static collected_t out;
+    out.count = 0;
+    TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(exported, len, collect, &out));
+    TEST_CHECK_EQ(3, out.count);
+    for (int n = 0; n < 3; n++) {
+        TEST_CHECK_EQ(later[n], out.samples[n].timestamp_us);
+        TEST_CHECK_EQ(100 + n, out.samples[n].data.u);
+        TEST_CHECK_EQ(1, out.samples[n].sensor);
+    }
+}
+
+// The flight recorder keeps the newest records and exports them oldest first
+static void test_ring_exports_newest_in_order(void) {
+    gesture_trace_init(&trace, NULL, 0);
+    const int total = GESTURE_TRACE_CAPACITY + 10;
+    for (int n = 0; n < total; n++) {
+        gesture_sample_t sample = sample_at(1000 + n * 2800LL, n & 0xFF);
+        gesture_trace_record(&trace, &sample);
+    }
+    size_t len = gesture_trace_export(&trace, exported, sizeof(exported));
+    gesture_trace_header_t header;
+    memcpy(&header, exported, sizeof(header));
+    TEST_CHECK_EQ(GESTURE_TRACE_CAPACITY, header.record_count);
+    TEST_CHECK_EQ(10, header.dropped);
+
+    static collected_t out;
+    out.count = 0;
+    TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(exported, len, collect, &out));
+    TEST_CHECK_EQ(GESTURE_TRACE_CAPACITY, out.count);
+    TEST_CHECK_EQ(1000 + 10 * 2800LL, out.samples[0].timestamp_us);
+    TEST_CHECK_EQ(1000 + (total - 1) * 2800LL, out.samples[GESTURE_TRACE_CAPACITY - 1].timestamp_us);
+}
+
+// Only the current layout is replayed; anything else is refused rather than guessed at
+static void test_foreign_traces_are_refused(void) {
+    uint8_t buf[sizeof(gesture_trace_header_t) + sizeof(gesture_trace_record_t)] = {0};
+    gesture_trace_header_t header = {
+        .magic = GESTURE_TRACE_MAGIC,
+        .version = GESTURE_TRACE_VERSION,
+        .record_size = sizeof(gesture_trace_record_t),
+        .record_count = 1,
+    };
+    static collected_t out;
+    out.count = 0;
+    memcpy(buf, &header, sizeof(header));
+    TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(buf, sizeof(buf), collect, &out));
+    TEST_CHECK_EQ(1, out.count);
+
+    header.version = GESTURE_TRACE_VERSION + 1;
+    memcpy(buf, &header, sizeof(header));
+    TEST_CHECK_EQ(ESP_ERR_INVALID_VERSION, gesture_trace_replay(buf, sizeof(buf), collect, &out));
+    header.version = GESTURE_TRACE_VERSION;
+    header.record_size = 10;
+    memcpy(buf, &header, sizeof(header));
+    TEST_CHECK_EQ(ESP_ERR_INVALID_VERSION, gesture_trace_replay(buf, sizeof(buf), collect, &out));
+    header.record_size = sizeof(gesture_trace_record_t);
+    header.magic = 0;
+    memcpy(buf, &header, sizeof(header));
+    TEST_CHECK_EQ(ESP_ERR_INVALID_VERSION, gesture_trace_replay(buf, sizeof(buf), collect, &out));
+    header.magic = GESTURE_TRACE_MAGIC;
+    memcpy(buf, &header, sizeof(header));
+    TEST_CHECK_EQ(ESP_ERR_INVALID_SIZE, gesture_trace_replay(buf, sizeof(buf) - 1, collect, &out));
+    TEST_CHECK_EQ(ESP_ERR_INVALID_SIZE, gesture_trace_replay(buf, sizeof(header) - 1, collect, &out));
+    TEST_CHECK_EQ(1, out.count);
+}
+
+int main(void) {
+    RUN_TEST(test_offsets_do_not_wrap);
+    RUN_TEST(test_ring_exports_newest_in_order);
+    RUN_TEST(test_foreign_traces_are_refused);
+    return TEST_EXIT_CODE();
+}
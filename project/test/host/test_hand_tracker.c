@@ -0,0 +1,61 @@
+// Hand tracker closeness and position
+#include "host_test.h"
+#include "../../include/hand_tracker.h"
+
+#define Q15_PERCENT(v) ((v) * 100 / GESTURE_Q15_ONE)
+
+// A hand at the edge of detection reads near 0 from both sources, however the FIFO and PDATA reads interleave
+static void test_sources_share_one_scale(void) {
+    static const struct {
+        apds9960_gesture_dataset_t dataset;
+        uint8_t pdata;
+        int min_percent, max_percent;
+    } cases[] = {
+        {{11, 11, 11, 11}, APDS9960_PROX_GATE + 1, 0, 5},  // Just inside both ranges
+        {{255, 255, 255, 255}, 255, 95, 100},              // Saturated on both
+        {{140, 140, 140, 140}, 200, 40, 60},               // Half way on both
+    };
+    for (size_t n = 0; n < sizeof(cases) / sizeof(cases[0]); n++) {
+        hand_tracker_t tracker;
+        hand_tracker_init(&tracker);
+        int32_t low = GESTURE_Q15_ONE, high = 0;
+        for (int step = 0; step < 40; step++) {
+            hand_tracker_update(&tracker, &cases[n].dataset);
+            if (step % 4 == 3) hand_tracker_update_proximity(&tracker, cases[n].pdata);
+            if (step >= 8) {
+                if (tracker.closeness < low) low = tracker.closeness;
+                if (tracker.closeness > high) high = tracker.closeness;
+            }
+        }
+        TEST_CHECK(Q15_PERCENT(low) >= cases[n].min_percent && Q15_PERCENT(high) <= cases[n].max_percent);
+        // Once settled, a proximity read between bursts does not yank the estimate around
+        TEST_CHECK(Q15_PERCENT(high - low) <= 2);
+    }
+}
+
+static void test_proximity_only_counts_while_present(void) {
+    hand_tracker_t tracker;
+    hand_tracker_init(&tracker);
+    hand_tracker_update_proximity(&tracker, 255);
+    TEST_CHECK(!tracker.present);
+    TEST_CHECK_EQ(0, tracker.closeness);
+
+    const apds9960_gesture_dataset_t centred = {100, 100, 100, 100};
+    hand_tracker_update(&tracker, &centred);
+    int32_t from_level = tracker.closeness;
+    TEST_CHECK_EQ(0, tracker.position);
+    hand_tracker_update_proximity(&tracker, APDS9960_PROX_GATE); // Below the span, reads as far
+    TEST_CHECK_EQ(from_level / 2, tracker.closeness);
+    TEST_CHECK_EQ(0, tracker.position);
+
+    // A new hand starts from its own first samples, not from the last one's proximity
+    TEST_CHECK(hand_tracker_lost(&tracker));
+    hand_tracker_update(&tracker, &centred);
+    TEST_CHECK_EQ(from_level, tracker.closeness);
+}
+
+int main(void) {
+    RUN_TEST(test_sources_share_one_scale);
+    RUN_TEST(test_proximity_only_counts_while_present);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,565 @@
+// SPI backend of the led_strip fork on the simulated spi_master: what reaches the MOSI line, in which buffers.
+// The encoder is benched on its own, so the backend is included for its statics.
+#include "../../components/led_strip/src/led_strip_spi_dev.c"
+#include <string.h>
+#include "host_test.h"
+#include "fake_idf.h"
+#include "fake_spi.h"
+
+#define STRIP_GPIO 8
+#define STRIP_MAX_LEDS 300
+
+// Bit by bit, as the WS2812 reads it: 1 is 110 and 0 is 100 on the 2.5 MHz line, MSB first
+static void expect_byte(uint8_t value, uint8_t *out) {
+    uint32_t bits = 0;
+    for (int n = 7; n >= 0; n--) bits = bits << 3 | ((value >> n) & 1 ? 6 : 4);
+    out[0] = bits >> 16;
+    out[1] = bits >> 8;
+    out[2] = bits;
+}
+
+// Encoded frame of `count` pixels in the strip's component order, returns its length
+static size_t expect_frame(led_color_component_format_t fmt, const uint8_t (*pixels)[4], uint32_t count, uint8_t *out) {
+    int num = fmt.format.num_components;
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t *px = out + i * num * 3;
+        expect_byte(pixels[i][0], px + 3 * fmt.format.r_pos);
+        expect_byte(pixels[i][1], px + 3 * fmt.format.g_pos);
+        expect_byte(pixels[i][2], px + 3 * fmt.format.b_pos);
+        if (num > 3) expect_byte(pixels[i][3], px + 3 * fmt.format.w_pos);
+    }
+    return count * num * 3;
+}
+
+// The encoder of espressif/led_strip 3.0.1 that the table replaced, kept as the reference
+static void upstream_spi_bit(uint8_t data, uint8_t *buf) {
+    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
+    *(buf + 1) |= BIT(0);
+    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+// Upstream led_strip_spi_set_pixel_rgbw() into a frame buffer (set_pixel() is the same with white 0)
+static void upstream_set_pixel(led_color_component_format_t fmt, uint8_t *frame, uint32_t index, uint8_t red, uint8_t green,
+                               uint8_t blue, uint8_t white) {
+    uint32_t start = index * fmt.format.num_components * 3;
+    memset(frame + start, 0, fmt.format.num_components * 3);
+    upstream_spi_bit(red, &frame[start + 3 * fmt.format.r_pos]);
+    upstream_spi_bit(green, &frame[start + 3 * fmt.format.g_pos]);
+    upstream_spi_bit(blue, &frame[start + 3 * fmt.format.b_pos]);
+    if (fmt.format.num_components > 3) upstream_spi_bit(white, &frame[start + 3 * fmt.format.w_pos]);
+}
+
+// Every valid led_color_component_format_t: each order of R, G, B, and of R, G, B, W
+static size_t all_formats(led_color_component_format_t *formats) {
+    size_t count = 0;
+    for (int num = 3; num <= 4; num++) {
+        for (int r = 0; r < num; r++) {
+            for (int g = 0; g < num; g++) {
+                for (int b = 0; b < num; b++) {
+                    for (int w = 0; w < 4; w++) {
+                        int used = 1 << r | 1 << g | 1 << b | (num > 3 ? 1 << w : 0);
+                        if (used != (1 << num) - 1 || (num == 3 && w != 3)) continue;
+                        formats[count++] = (led_color_component_format_t) {
+                            .format = { .r_pos = r, .g_pos = g, .b_pos = b, .w_pos = w, .num_components = num },
+                        };
+                    }
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static void reset_bus(void) {
+    fake_idf_reset();
+    fake_spi_reset();
+}
+
+static led_strip_handle_t new_strip(uint32_t leds, led_color_component_format_t fmt, bool async, bool stream, uint32_t chunk_leds) {
+    led_strip_config_t strip_config = {
+        .strip_gpio_num = STRIP_GPIO,
+        .max_leds = leds,
+        .color_component_format = fmt,
+    };
+    led_strip_spi_config_t spi_config = {
+        .spi_bus = SPI2_HOST,
+        .flags.with_dma = true,
+        .flags.async_refresh = async,
+        .flags.stream_encode = stream,
+        .stream_chunk_leds = chunk_leds,
+    };
+    led_strip_handle_t strip = NULL;
+    TEST_CHECK_EQ(ESP_OK, led_strip_new_spi_device(&strip_config, &spi_config, &strip));
+    return strip;
+}
+
+static void random_pixels(uint8_t (*pixels)[4], uint32_t count, bool white) {
+    for (uint32_t i = 0; i < count; i++) {
+        for (int c = 0; c < 4; c++) pixels[i][c] = rand();
+        if (!white) pixels[i][3] = 0;
+    }
+}
+
+static void write_pixels(led_strip_handle_t strip, const uint8_t (*pixels)[4], uint32_t count, bool white) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (white) {
+            led_strip_set_pixel_rgbw(strip, i, pixels[i][0], pixels[i][1], pixels[i][2], pixels[i][3]);
+        } else {
+            led_strip_set_pixel(strip, i, pixels[i][0], pixels[i][1], pixels[i][2]);
+        }
+    }
+}
+
+// The wire holds the expected frame, followed by nothing but the zero padding up to a whole word
+static void check_wire(const uint8_t *expected, size_t len) {
+    size_t wire_len = 0;
+    const uint8_t *wire = fake_spi_wire(&wire_len);
+    TEST_CHECK(wire_len >= len && wire_len < len + 4);
+    TEST_CHECK(memcmp(wire, expected, len) == 0);
+    for (size_t n = len; n < wire_len; n++) TEST_CHECK_EQ(0, wire[n]);
+}
+
+// Whatever the strip length, DMA reads both async buffers in place: no bounce copy, no allocation per frame
+static void test_frames_are_sent_from_aligned_buffers(void) {
+    static const uint32_t lengths[] = {1, 2, 3, 4, 5, 6, 7, 29, 30, 31};
+    const led_color_component_format_t formats[] = { LED_STRIP_COLOR_COMPONENT_FMT_GRB, LED_STRIP_COLOR_COMPONENT_FMT_GRBW };
+    static uint8_t pixels[STRIP_MAX_LEDS][4];
+    static uint8_t expected[STRIP_MAX_LEDS * 12];
+    for (size_t f = 0; f < 2; f++) {
+        bool white = formats[f].format.num_components == 4;
+        for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++) {
+            for (int async = 0; async < 2; async++) {
+                reset_bus();
+                led_strip_handle_t strip = new_strip(lengths[n], formats[f], async, false, 0);
+                if (strip == NULL) continue;
+                uint32_t allocs = fake_heap.allocs;
+                for (int frame = 0; frame < 3; frame++) {
+                    random_pixels(pixels, lengths[n], white);
+                    write_pixels(strip, pixels, lengths[n], white);
+                    fake_spi_wire_clear();
+                    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+                    TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+                    check_wire(expected, expect_frame(formats[f], pixels, lengths[n], expected));
+                }
+                TEST_CHECK_EQ(0, fake_spi_stats()->bounce_copies);
+                TEST_CHECK_EQ(allocs, fake_heap.allocs);
+                TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+            }
+        }
+    }
+}
+
+// An async refresh returns once queued; the next frame is drawn meanwhile without touching what DMA reads
+static void test_async_refresh_overlaps_the_wire(void) {
+    reset_bus();
+    const uint32_t leds = 30;
+    led_strip_handle_t strip = new_strip(leds, LED_STRIP_COLOR_COMPONENT_FMT_GRB, true, false, 0);
+    static uint8_t first[30][4], second[30][4];
+    random_pixels(first, leds, false);
+    random_pixels(second, leds, false);
+
+    write_pixels(strip, first, leds, false);
+    int64_t start = fake_time_now();
+    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+    TEST_CHECK_EQ(start, fake_time_now());
+    TEST_CHECK_EQ(1, fake_spi_stats()->in_flight);
+    TEST_CHECK_EQ(ESP_ERR_TIMEOUT, led_strip_wait_refresh_done(strip, 0));
+
+    write_pixels(strip, second, leds, false);
+    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+    TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+    TEST_CHECK_EQ(0, fake_spi_stats()->in_flight);
+    TEST_CHECK_EQ(0, fake_spi_stats()->modified_in_flight);
+
+    // 30 LEDs are 270 bytes, 864 us at 2.5 MHz; the two frames went out back to back
+    static uint8_t expected[2 * 272];
+    size_t len = expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, first, leds, expected);
+    expected[len] = expected[len + 1] = 0;
+    len = 272 + expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, second, leds, expected + 272);
+    check_wire(expected, len);
+    TEST_CHECK(fake_time_now() - start >= 2 * 870);
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+// Writing what the pixels already hold leaves nothing to send; a real change does, in every mode
+static void test_unchanged_pixels_skip_the_frame(void) {
+    for (int mode = 0; mode < 3; mode++) {
+        reset_bus();
+        const uint32_t leds = 40;
+        led_strip_handle_t strip = new_strip(leds, LED_STRIP_COLOR_COMPONENT_FMT_GRB, mode == 1, mode == 2, 0);
+        static led_strip_rgb_t colors[40];
+        for (uint32_t i = 0; i < leds; i++) colors[i] = (led_strip_rgb_t) { i, 2 * i, 3 * i };
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_pixels(strip, 0, colors, leds));
+        TEST_CHECK_EQ(ESP_OK, led_strip_fill(strip, 30, 10, (led_strip_rgb_t) { 7, 8, 9 }));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+        uint32_t sent = fake_spi_stats()->transactions;
+
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_pixels(strip, 0, colors, 30));
+        TEST_CHECK_EQ(ESP_OK, led_strip_fill(strip, 30, 10, (led_strip_rgb_t) { 7, 8, 9 }));
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_pixel(strip, 5, 5, 10, 15));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(sent, fake_spi_stats()->transactions);
+
+        // Part of a fill run already had the color, the rest did not
+        TEST_CHECK_EQ(ESP_OK, led_strip_fill(strip, 25, 10, (led_strip_rgb_t) { 7, 8, 9 }));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+        TEST_CHECK(fake_spi_stats()->transactions > sent);
+        sent = fake_spi_stats()->transactions;
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_pixel(strip, 39, 0, 0, 1));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+        TEST_CHECK(fake_spi_stats()->transactions > sent);
+
+        led_strip_refresh_stats_t stats;
+        TEST_CHECK_EQ(ESP_OK, led_strip_get_refresh_stats(strip, &stats));
+        TEST_CHECK_EQ(4, stats.requested);
+        TEST_CHECK_EQ(3, stats.transmitted);
+        TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+    }
+}
+
+// What the strip shows once the line has been idle long enough: the expected frame and its padding, latched exactly once
+static void check_latched_once(const uint8_t *expected, size_t len) {
+    size_t wire_len = 0, latched_len = 0;
+    fake_spi_wire(&wire_len);
+    fake_time_advance(FAKE_SPI_LATCH_US);
+    const uint8_t *latched = fake_spi_latched(&latched_len);
+    TEST_CHECK_EQ(1, fake_spi_stats()->frames_latched);
+    TEST_CHECK_EQ(wire_len, latched_len);
+    TEST_CHECK(latched_len >= len && memcmp(latched, expected, len) == 0);
+}
+
+// Streamed chunk by chunk, the strip gets the same bytes as from one encoded frame, without latching in between
+static void test_stream_is_one_frame_on_the_wire(void) {
+    static const uint32_t lengths[] = {1, 5, 31, 32, 33, 100, 257};
+    static const uint32_t chunks[] = {0, 1, 7, 32, 64};
+    const led_color_component_format_t formats[] = { LED_STRIP_COLOR_COMPONENT_FMT_GRB, LED_STRIP_COLOR_COMPONENT_FMT_GRBW };
+    static uint8_t pixels[STRIP_MAX_LEDS][4];
+    static uint8_t expected[STRIP_MAX_LEDS * 12];
+    for (size_t f = 0; f < 2; f++) {
+        bool white = formats[f].format.num_components == 4;
+        for (size_t n = 0; n < sizeof(lengths) / sizeof(lengths[0]); n++) {
+            for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+                reset_bus();
+                led_strip_handle_t strip = new_strip(lengths[n], formats[f], false, true, chunks[c]);
+                if (strip == NULL) continue;
+                random_pixels(pixels, lengths[n], white);
+                write_pixels(strip, pixels, lengths[n], white);
+                TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+                size_t len = expect_frame(formats[f], pixels, lengths[n], expected);
+                check_wire(expected, len);
+                check_latched_once(expected, len);
+                TEST_CHECK_EQ(0, fake_spi_stats()->bounce_copies);
+                // Between chunks the line is only low while the driver starts the next transaction
+                uint32_t gap_us = 0;
+                TEST_CHECK_EQ(ESP_OK, led_strip_spi_get_stream_gap(strip, &gap_us));
+                TEST_CHECK(gap_us <= FAKE_SPI_SETUP_US);
+                TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+            }
+        }
+    }
+    reset_bus();
+    uint32_t gap_us = 0;
+    led_strip_handle_t strip = new_strip(100, LED_STRIP_COLOR_COMPONENT_FMT_GRB, false, false, 0);
+    TEST_CHECK_EQ(ESP_ERR_INVALID_STATE, led_strip_spi_get_stream_gap(strip, &gap_us));
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+// A chunk queued after the previous one ended lets the strip latch half a frame: the whole frame goes out again
+static void test_stream_underrun_resends_the_frame(void) {
+    reset_bus();
+    const uint32_t leds = 100; // 4 chunks of 32, 922 us each
+    led_strip_handle_t strip = new_strip(leds, LED_STRIP_COLOR_COMPONENT_FMT_GRB, false, true, 32);
+    static uint8_t pixels[100][4];
+    static uint8_t expected[100 * 9];
+    random_pixels(pixels, leds, false);
+    write_pixels(strip, pixels, leds, false);
+    size_t len = expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, pixels, leds, expected);
+
+    fake_spi_delay_queue(2, 1, 2000); // The third chunk is queued 2 ms late
+    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+    size_t wire_len = 0, latched_len = 0;
+    const uint8_t *wire = fake_spi_wire(&wire_len);
+    TEST_CHECK_EQ(2 * len, wire_len);
+    TEST_CHECK(memcmp(wire + len, expected, len) == 0);
+    fake_time_advance(FAKE_SPI_LATCH_US);
+    const uint8_t *latched = fake_spi_latched(&latched_len);
+    TEST_CHECK_EQ(len, latched_len);
+    TEST_CHECK(memcmp(latched, expected, len) == 0);
+    uint32_t gap_us = 0;
+    TEST_CHECK_EQ(ESP_OK, led_strip_spi_get_stream_gap(strip, &gap_us));
+    TEST_CHECK(gap_us > FAKE_SPI_LATCH_US);
+
+    // Held off on every chunk, refresh gives up and the frame stays pending for the next one
+    fake_spi_delay_queue(2, 1000, 2000);
+    led_strip_set_pixel(strip, 0, 1, 2, 3);
+    pixels[0][0] = 1, pixels[0][1] = 2, pixels[0][2] = 3;
+    TEST_CHECK_EQ(ESP_ERR_TIMEOUT, led_strip_refresh(strip));
+    fake_spi_delay_queue(0, 0, 0);
+    fake_spi_wire_clear();
+    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+    len = expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, pixels, leds, expected);
+    check_wire(expected, len);
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+// A failed queue call leaves no chunk with the driver, the next refresh starts clean
+static void test_stream_error_collects_queued_chunks(void) {
+    reset_bus();
+    const uint32_t leds = 100;
+    led_strip_handle_t strip = new_strip(leds, LED_STRIP_COLOR_COMPONENT_FMT_GRB, false, true, 32);
+    static uint8_t pixels[100][4];
+    static uint8_t expected[100 * 9];
+    random_pixels(pixels, leds, false);
+    write_pixels(strip, pixels, leds, false);
+
+    fake_spi_fail_queue(2, ESP_ERR_NO_MEM);
+    TEST_CHECK_EQ(ESP_ERR_NO_MEM, led_strip_refresh(strip));
+    TEST_CHECK_EQ(0, fake_spi_stats()->in_flight);
+
+    fake_time_advance(FAKE_SPI_LATCH_US);
+    fake_spi_wire_clear();
+    TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+    size_t len = expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, pixels, leds, expected);
+    check_wire(expected, len);
+    check_latched_once(expected, len);
+    TEST_CHECK_EQ(0, fake_spi_stats()->modified_in_flight);
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+// A strip without LEDs has no frame to send and no chunk size to split it by, it is refused up front
+static void test_empty_strip_is_refused(void) {
+    for (int stream = 0; stream < 2; stream++) {
+        reset_bus();
+        led_strip_config_t strip_config = { .strip_gpio_num = STRIP_GPIO, .max_leds = 0 };
+        led_strip_spi_config_t spi_config = { .spi_bus = SPI2_HOST, .flags.with_dma = true, .flags.stream_encode = stream };
+        led_strip_handle_t strip = NULL;
+        TEST_CHECK_EQ(ESP_ERR_INVALID_ARG, led_strip_new_spi_device(&strip_config, &spi_config, &strip));
+        TEST_CHECK(strip == NULL);
+        TEST_CHECK_EQ(fake_heap.allocs, fake_heap.frees);
+    }
+}
+
+// Each component of pixel i takes a different permutation of 0-255, so every value goes through every slot
+static inline void test_pixel(uint32_t i, uint8_t *px) {
+    px[0] = i;
+    px[1] = 255 - i;
+    px[2] = i * 7;
+    px[3] = i * 13 + 5;
+}
+
+// The table encoder is bit for bit the upstream one, for all 256 values in every component order,
+// whether the frame is encoded by set_pixel or chunk by chunk in stream mode
+static void test_table_matches_upstream_encoder(void) {
+    led_color_component_format_t formats[32];
+    size_t num_formats = all_formats(formats);
+    TEST_CHECK_EQ(6 + 24, num_formats);
+    static uint8_t expected[256 * 12];
+    for (size_t f = 0; f < num_formats; f++) {
+        bool white = formats[f].format.num_components == 4;
+        for (int stream = 0; stream < 2; stream++) {
+            // With white, once through set_pixel_rgbw and once through set_pixel, which sends white as 0
+            for (int rgbw = white; rgbw >= 0; rgbw--) {
+                reset_bus();
+                led_strip_handle_t strip = new_strip(256, formats[f], false, stream, 0);
+                if (strip == NULL) continue;
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint8_t px[4];
+                    test_pixel(i, px);
+                    if (rgbw) {
+                        led_strip_set_pixel_rgbw(strip, i, px[0], px[1], px[2], px[3]);
+                    } else {
+                        led_strip_set_pixel(strip, i, px[0], px[1], px[2]);
+                    }
+                    upstream_set_pixel(formats[f], expected, i, px[0], px[1], px[2], rgbw ? px[3] : 0);
+                }
+                TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+                check_wire(expected, 256 * formats[f].format.num_components * 3);
+
+                // Upstream clear() encoded 0 into every component
+                for (uint32_t i = 0; i < 256; i++) upstream_set_pixel(formats[f], expected, i, 0, 0, 0, 0);
+                fake_spi_wire_clear();
+                TEST_CHECK_EQ(ESP_OK, led_strip_clear(strip));
+                check_wire(expected, 256 * formats[f].format.num_components * 3);
+                TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+            }
+        }
+    }
+}
+
+// Brightness scaling of led_strip_api.c with a linear gamma and no white point, worked out independently
+static uint8_t scaled(uint8_t value, uint8_t brightness) {
+    return (value * brightness * 255 + 255 * 255 / 2) / (255 * 255);
+}
+
+// A new correction applies to the pixels already written: the next refresh sends them all again, in every mode
+static void test_correction_change_resends_the_frame(void) {
+    const uint32_t leds = 40;
+    static uint8_t pixels[40][4], corrected[40][4];
+    static uint8_t expected[40 * 9];
+    for (int mode = 0; mode < 3; mode++) {
+        reset_bus();
+        led_strip_handle_t strip = new_strip(leds, LED_STRIP_COLOR_COMPONENT_FMT_GRB, mode == 1, mode == 2, 8);
+        random_pixels(pixels, leds, false);
+        write_pixels(strip, pixels, leds, false);
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+
+        fake_spi_wire_clear();
+        uint32_t sent = fake_spi_stats()->transactions;
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_brightness(strip, 100));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+        TEST_CHECK(fake_spi_stats()->transactions > sent);
+        for (uint32_t i = 0; i < leds; i++) {
+            for (int c = 0; c < 4; c++) corrected[i][c] = scaled(pixels[i][c], 100);
+        }
+        check_wire(expected, expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, corrected, leds, expected));
+
+        // The same correction again changes nothing on the strip
+        sent = fake_spi_stats()->transactions;
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_brightness(strip, 100));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(sent, fake_spi_stats()->transactions);
+
+        // Without a correction the pixels go out as written
+        fake_spi_wire_clear();
+        TEST_CHECK_EQ(ESP_OK, led_strip_set_color_correction(strip, NULL));
+        TEST_CHECK_EQ(ESP_OK, led_strip_refresh(strip));
+        TEST_CHECK_EQ(ESP_OK, led_strip_wait_refresh_done(strip, -1));
+        check_wire(expected, expect_frame(LED_STRIP_COLOR_COMPONENT_FMT_GRB, pixels, leds, expected));
+        TEST_CHECK_EQ(0, fake_spi_stats()->modified_in_flight);
+
+        led_strip_refresh_stats_t stats;
+        TEST_CHECK_EQ(ESP_OK, led_strip_get_refresh_stats(strip, &stats));
+        TEST_CHECK_EQ(4, stats.requested);
+        TEST_CHECK_EQ(3, stats.transmitted);
+        TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+    }
+}
+
+static void test_pixels(led_strip_rgb_t *colors, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t px[4];
+        test_pixel(i, px);
+        colors[i] = (led_strip_rgb_t) { px[0], px[1], px[2] };
+    }
+}
+
+// Host CPU time to encode a frame, through the table (what refresh runs) and through the upstream encoder,
+// nothing but the encode loops: the transmit and the simulated driver are left out
+static void test_encode_cost(void) {
+    reset_bus();
+    const led_color_component_format_t fmt = LED_STRIP_COLOR_COMPONENT_FMT_GRB;
+    led_strip_handle_t strip = new_strip(256, fmt, false, false, 0);
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    static led_strip_rgb_t colors[256];
+    static uint8_t frame[256 * 9];
+    test_pixels(colors, 256);
+    TEST_CHECK_EQ(ESP_OK, led_strip_set_pixels(strip, 0, colors, 256));
+    const int passes = 20000;
+    uint64_t start = host_test_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        spi_strip->pixel_buf[pass % (256 * 3)] ^= 0x80; // Something changes every frame
+        led_strip_spi_encode(spi_strip, frame, spi_strip->pixel_buf, 256);
+        __asm__ volatile("" : : "r"(frame) : "memory"); // Keep the frame from being optimized away
+    }
+    double table_ns = (double)(host_test_ns() - start) / (256.0 * passes);
+
+    start = host_test_ns();
+    for (int pass = 0; pass < passes; pass++) {
+        colors[pass & 255].r ^= 0x80;
+        for (uint32_t i = 0; i < 256; i++) upstream_set_pixel(fmt, frame, i, colors[i].r, colors[i].g, colors[i].b, 0);
+        __asm__ volatile("" : : "r"(frame) : "memory");
+    }
+    double upstream_ns = (double)(host_test_ns() - start) / (256.0 * passes);
+    TEST_REPORT("SPI encode per RGB pixel on the host: %.1f ns through the table, %.1f ns with the upstream bit encoder",
+                table_ns, upstream_ns);
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+// Host CPU time of led_strip_spi_encode() per pixel of the strip's pixel_buf, into `frame`; the best of a few
+// batches, each toggling every byte an even number of times so pixel_buf ends as it started
+static double encode_ns(led_strip_spi_obj *spi_strip, uint8_t *frame, const uint8_t (*separate_lut)[256]) {
+    static uint8_t corrected[256 * 3];
+    const uint32_t count = spi_strip->strip_len;
+    const int passes = count * 3 * 8;
+    double best_ns = 0;
+    for (int batch = 0; batch < 8; batch++) {
+        uint64_t start = host_test_ns();
+        for (int pass = 0; pass < passes; pass++) {
+            spi_strip->pixel_buf[pass % (count * 3)] ^= 0x80; // Something changes every frame
+            const uint8_t *pixels = spi_strip->pixel_buf;
+            if (separate_lut) {
+                // GRB as stored
+                for (uint32_t i = 0; i < count * 3; i += 3) {
+                    corrected[i] = separate_lut[LED_STRIP_COMPONENT_G][pixels[i]];
+                    corrected[i + 1] = separate_lut[LED_STRIP_COMPONENT_R][pixels[i + 1]];
+                    corrected[i + 2] = separate_lut[LED_STRIP_COMPONENT_B][pixels[i + 2]];
+                }
+                pixels = corrected;
+            }
+            led_strip_spi_encode(spi_strip, frame, pixels, count);
+            __asm__ volatile("" : : "r"(frame) : "memory"); // Keep the frame from being optimized away
+        }
+        double ns = (double)(host_test_ns() - start) / ((double)count * passes);
+        if (batch == 0 || ns < best_ns) best_ns = ns;
+    }
+    return best_ns;
+}
+
+// Color correction fused into the encode, against correcting the colors in a pass of their own before encoding them
+static void test_correction_cost(void) {
+    reset_bus();
+    led_strip_handle_t strip = new_strip(256, LED_STRIP_COLOR_COMPONENT_FMT_GRB, false, false, 0);
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    static led_strip_rgb_t colors[256];
+    static uint8_t frame[256 * 9];
+    test_pixels(colors, 256);
+    TEST_CHECK_EQ(ESP_OK, led_strip_set_pixels(strip, 0, colors, 256));
+    double plain_ns = encode_ns(spi_strip, frame, NULL);
+
+    const led_strip_color_correction_t correction = {
+        .brightness = 160,
+        .gamma = { 2.2f, 2.2f, 2.2f, 2.2f },
+        .white_point = { 255, 220, 180 },
+    };
+    TEST_CHECK_EQ(ESP_OK, led_strip_set_color_correction(strip, &correction));
+    TEST_CHECK(strip->color_lut != NULL);
+    double fused_ns = encode_ns(spi_strip, frame, NULL);
+    static uint8_t fused[256 * 9];
+    memcpy(fused, frame, sizeof(fused));
+
+    // The same tables, applied by the caller before an encode without correction
+    static uint8_t lut[4][256];
+    memcpy(lut, strip->color_lut, sizeof(lut));
+    TEST_CHECK_EQ(ESP_OK, led_strip_set_color_correction(strip, NULL));
+    double separate_ns = encode_ns(spi_strip, frame, (const uint8_t (*)[256])lut);
+    TEST_CHECK(memcmp(fused, frame, sizeof(fused)) == 0);
+    TEST_REPORT("SPI encode per RGB pixel on the host: %.1f ns uncorrected, %.1f ns with the correction fused "
+                "into the encode, %.1f ns with it as a separate pass", plain_ns, fused_ns, separate_ns);
+    TEST_CHECK_EQ(ESP_OK, led_strip_del(strip));
+}
+
+int main(void) {
+    RUN_TEST(test_frames_are_sent_from_aligned_buffers);
+    RUN_TEST(test_async_refresh_overlaps_the_wire);
+    RUN_TEST(test_unchanged_pixels_skip_the_frame);
+    RUN_TEST(test_stream_is_one_frame_on_the_wire);
+    RUN_TEST(test_stream_underrun_resends_the_frame);
+    RUN_TEST(test_stream_error_collects_queued_chunks);
+    RUN_TEST(test_empty_strip_is_refused);
+    RUN_TEST(test_table_matches_upstream_encoder);
+    RUN_TEST(test_correction_change_resends_the_frame);
+    RUN_TEST(test_encode_cost);
+    RUN_TEST(test_correction_cost);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,90 @@
+/**
+ * @file trace_fixtures.h
+ * @brief Replay of the trace fixtures in traces/ and comparison with golden output.
+ *
+ * The golden files are written by tools/train_gesture_model.py --dump (see
+ * `make golden`); a test prints its own side in the same format into a buffer
+ * and compares the two.
+ */
+
+#ifndef TRACE_FIXTURES_H
+#define TRACE_FIXTURES_H
+
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "../../include/gesture_trace.h"
+
+#define TRACE_DIR "traces/"
+#define TRACE_DUMP_MAX (64 * 1024)
+
+static inline uint8_t *trace_fixture_load(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(*size + 1);
+    if (fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    } else {
+        data[*size] = 0; // Golden files are read as text
+    }
+    fclose(f);
+    return data;
+}
+
+/**
+ * @brief Replay every traces/ *.gtrc file, in name order (the order --dump uses)
+ * @param begin Called with the file name before its records, may be NULL
+ * @param sink Called for every record
+ * @param ctx Passed to both
+ * @return Number of traces replayed
+ */
+static inline size_t trace_fixture_replay_all(void (*begin)(const char *name, void *ctx), gesture_trace_sink_t sink, void *ctx) {
+    glob_t traces;
+    if (glob(TRACE_DIR "*.gtrc", 0, NULL, &traces) != 0) return 0;
+    for (size_t n = 0; n < traces.gl_pathc; n++) {
+        size_t size = 0;
+        uint8_t *data = trace_fixture_load(traces.gl_pathv[n], &size);
+        TEST_CHECK(data != NULL);
+        if (data == NULL) continue;
+        if (begin) begin(traces.gl_pathv[n] + strlen(TRACE_DIR), ctx);
+        TEST_CHECK_EQ(ESP_OK, gesture_trace_replay(data, size, sink, ctx));
+        free(data);
+    }
+    size_t count = traces.gl_pathc;
+    globfree(&traces);
+    return count;
+}
+
+/**
+ * @brief Compare a dump with traces/<golden>, printing the first line that differs
+ * @param dump Output of the C side, one line per trajectory
+ * @param golden File name inside traces/
+ */
+static inline void trace_fixture_check_golden(const char *dump, const char *golden) {
+    char path[64];
+    snprintf(path, sizeof(path), TRACE_DIR "%s", golden);
+    size_t size = 0;
+    char *expected = (char *)trace_fixture_load(path, &size);
+    TEST_CHECK(expected != NULL);
+    if (expected == NULL) return;
+    const char *c = dump, *p = expected;
+    while (*c || *p) {
+        size_t c_len = strcspn(c, "\n"), p_len = strcspn(p, "\n");
+        if (c_len != p_len || memcmp(c, p, c_len) != 0) {
+            printf("  C:      %.*s\n  Python: %.*s\n", (int)c_len, c, (int)p_len, p);
+            TEST_CHECK(!"output differs from the golden file");
+            break;
+        }
+        c += c_len + (c[c_len] != 0);
+        p += p_len + (p[p_len] != 0);
+    }
+    free(expected);
+}
+
+#endif // TRACE_FIXTURES_H
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Write the synthetic gesture traces used by the host regression tests.
+
+These are not recordings: every trajectory is drawn from a simple model of the
+four photodiodes (a hand crossing, hovering, approaching...) plus seeded noise, so
+the files are reproducible byte for byte. They cover the decoder's corner cases
+(threshold edges, saturated channels, short trajectories, exits without a low
+dataset, two sensors interleaved) rather than realistic gesture statistics.
+Replace or extend them with real captures from esp32/trace when available.
+
+    test/host/traces/make_traces.py     # rewrite every .gtrc next to this script
+"""
+
+import os
+import random
+import struct
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, os.path.join(HERE, "..", "..", "..", "tools"))
+import train_gesture_model as model  # noqa: E402
+
+DATASET_PERIOD_US = 2800  # Gesture engine cycle with the driver's settings
+SENSOR_CONFIG = struct.pack("<bBBBBBBB", -1, 0x5F, 0x0C, 140, 30, 0x40, 0x20, 0xC9)
+START_US = 10_000_000
+
+
+class Trace:
+    def __init__(self, sensors=1):
+        self.sensors = sensors
+        self.records = []
+        self.time_us = 0
+
+    def dataset(self, u, d, l, r, sensor=0):
+        clamp = lambda v: max(0, min(255, int(v)))
+        self.records.append((self.time_us, model.SAMPLE_DATASET | sensor << 4, 200, clamp(u), clamp(d), clamp(l), clamp(r)))
+        self.time_us += DATASET_PERIOD_US
+
+    def proximity(self, pdata, sensor=0):
+        self.records.append((self.time_us, model.SAMPLE_PROXIMITY | sensor << 4, pdata, 0, 0, 0, 0))
+
+    def exit(self, sensor=0):
+        self.records.append((self.time_us, model.SAMPLE_EXIT | sensor << 4, 0, 0, 0, 0, 0))
+
+    def pause(self, us):
+        self.time_us += us
+
+    def write(self, path):
+        header = model.HEADER.pack(model.TRACE_MAGIC, model.TRACE_VERSION, model.RECORD.size, self.sensors,
+                                   len(self.records), 0, START_US)
+        with open(path, "wb") as f:
+            f.write(header + SENSOR_CONFIG * self.sensors)
+            for rec in self.records:
+                f.write(model.RECORD.pack(*rec))
+
+
+def swipe(trace, rng, axis, forward, samples=12, level=130, sensor=0):
+    """Hand crossing the sensor: one photodiode leads, its opposite trails."""
+    for n in range(samples):
+        t = n / (samples - 1)
+        lead, trail = level * (1.2 - t), level * (0.2 + t)  # An upward swipe covers U first, see gesture_decoder.c
+        a, b = (lead, trail) if forward else (trail, lead)
+        side = level * (0.8 + 0.2 * (1 - abs(2 * t - 1)))
+        noise = lambda: rng.randint(-8, 8)
+        if axis == "ud":
+            trace.dataset(a + noise(), b + noise(), side + noise(), side + noise(), sensor)
+        else:
+            trace.dataset(side + noise(), side + noise(), a + noise(), b + noise(), sensor)
+        if n % 4 == 3:
+            trace.proximity(min(255, int(level * 1.5)), sensor)
+
+
+def still(trace, rng, start, end, samples, sensor=0):
+    """Hand over the middle of the sensor, overall level going from start to end."""
+    for n in range(samples):
+        level = start + (end - start) * n / (samples - 1)
+        trace.dataset(*(level + rng.randint(-6, 6) for _ in range(4)), sensor=sensor)
+        if n % 4 == 3:
+            trace.proximity(min(255, int(level * 1.5)), sensor)
+
+
+def low(trace, sensor=0):
+    trace.dataset(0, 0, 0, 0, sensor)
+
+
+def build():
+    traces = {}
+    for label, axis, forward in (("up", "ud", True), ("down", "ud", False), ("left", "lr", True), ("right", "lr", False)):
+        for take in range(1, 4):
+            rng = random.Random(f"{label}{take}")
+            trace = Trace()
+            for _ in range(2):
+                swipe(trace, rng, axis, forward, samples=8 + 3 * take, level=90 + 30 * take)
+                low(trace)
+                trace.pause(300_000)
+            traces[f"{label}_{take:02d}.gtrc"] = trace
+    for label, start, end, samples in (("hold", 150, 160, 24), ("approach", 40, 240, 20), ("retreat", 240, 40, 20), ("tap", 60, 200, 8)):
+        for take in range(1, 3):
+            rng = random.Random(f"{label}{take}")
+            trace = Trace()
+            for _ in range(2):
+                still(trace, rng, start, end, samples + take)
+                low(trace)
+                trace.pause(400_000)
+            traces[f"{label}_{take:02d}.gtrc"] = trace
+
+    # Corner cases, labelled NONE because the label is not what they test
+    trace = Trace()
+    trace.dataset(11, 11, 11, 11)  # Just above the threshold on every channel
+    trace.dataset(255, 11, 255, 11)  # Ratio clamped below 1.0
+    trace.dataset(11, 255, 11, 255)
+    trace.dataset(255, 255, 255, 255)  # Peak level 1020
+    trace.dataset(10, 200, 200, 200)  # One channel at the threshold ends the trajectory
+    trace.dataset(12, 13, 14, 15)  # Too short to be a gesture
+    trace.dataset(200, 12, 90, 90)
+    trace.exit()  # Hand gone without a low dataset
+    trace.exit()  # Nothing open any more
+    traces["none_edges.gtrc"] = trace
+
+    # Trajectories landing exactly on split points of the seed model (SAMPLES <= 3, SAMPLES <= 12)
+    rng = random.Random("ties")
+    trace = Trace()
+    for samples in (3, 4, 12, 13):
+        still(trace, rng, 150, 160, samples)
+        low(trace)
+    traces["none_ties.gtrc"] = trace
+
+    rng = random.Random("two sensors")
+    trace = Trace(sensors=2)
+    a, b = Trace(), Trace()
+    swipe(a, rng, "lr", True, sensor=0)
+    swipe(b, rng, "ud", False, sensor=1)
+    trace.records = sorted(a.records + b.records, key=lambda rec: rec[0])  # Stable: sensor 0 first on equal times
+    trace.time_us = max(a.time_us, b.time_us)
+    trace.exit(0)
+    trace.exit(1)
+    traces["none_two_sensors.gtrc"] = trace
+    return traces
+
+
+def main():
+    for name, trace in sorted(build().items()):
+        trace.write(os.path.join(HERE, name))
+        print(f"{name}: {len(trace.records)} records")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
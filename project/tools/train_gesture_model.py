@@ -0,0 +1,356 @@
+#!/usr/bin/env python3
+"""Train the gesture decision tree from recorded traces and emit main/gesture_model.c.
+
+Traces are the binary files published on esp32/trace (see include/gesture_trace.h).
+The label of every trajectory in a file is taken from the file name prefix, e.g.
+``left_03.gtrc`` or ``double_tap-kitchen.gtrc``. Double taps are learned as taps: the
+tree sees one trajectory at a time and gesture_classifier_run() pairs them.
+
+Feature extraction mirrors gesture_decoder.c and gesture_classifier.c bit for bit
+(same integer maths, C truncating division, arithmetic shifts), so the thresholds
+learned here mean the same thing on the device.
+
+    tools/train_gesture_model.py traces/*.gtrc            # train, report held-out accuracy, write the model
+    tools/train_gesture_model.py --seed                   # write the hand-written seed model (a placeholder)
+    tools/train_gesture_model.py --evaluate traces/*.gtrc # accuracy of the committed main/gesture_model.c
+    tools/train_gesture_model.py --dump decoder traces/*.gtrc  # print every trajectory, for the host regression tests
+    tools/train_gesture_model.py --dump classifier traces/*.gtrc  # features and main/gesture_model.c's prediction
+"""
+
+import argparse
+import os
+import random
+import re
+import struct
+import sys
+from collections import Counter
+
+# include/gesture_trace.h
+TRACE_MAGIC = 0x43525447
+TRACE_VERSION = 1
+HEADER = struct.Struct("<IHBBIIq")
+SENSOR_SIZE = 8
+RECORD = struct.Struct("<QBB4B")
+SAMPLE_DATASET, SAMPLE_EXIT, SAMPLE_PROXIMITY = 0, 1, 2
+
+# include/gesture_decoder.h
+THRESHOLD = 10
+SMOOTH_SHIFT = 1
+Q15_ONE = 32768
+
+# include/gesture_classifier.h
+TREE_MAX_DEPTH = 12
+FEATURES = ["UD_DELTA", "LR_DELTA", "AXIS_MARGIN", "MOTION", "SAMPLES", "ENTRY_LEVEL", "PEAK_LEVEL", "LEVEL_DELTA"]
+LABELS = ["NONE", "UP", "DOWN", "LEFT", "RIGHT", "HOLD", "APPROACH", "RETREAT", "TAP", "DOUBLE_TAP"]
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "main", "gesture_model.c")
+
+
+def cdiv(a, b):
+    """C integer division, truncating towards zero."""
+    q = abs(a) // abs(b)
+    return q if (a >= 0) == (b >= 0) else -q
+
+
+def ratio_q15(a, b):
+    return min(cdiv((a - b) * Q15_ONE, a + b), Q15_ONE - 1)
+
+
+def smooth(avg, sample):
+    return avg + ((sample - avg) >> SMOOTH_SHIFT)
+
+
+class Decoder:
+    """Port of gesture_decoder_t, returns the trajectory fields used as features."""
+
+    def __init__(self):
+        self.active = False
+
+    def push(self, u, d, l, r):
+        if not (u > THRESHOLD and d > THRESHOLD and l > THRESHOLD and r > THRESHOLD):
+            return self.finish()
+        ud, lr, level = ratio_q15(u, d), ratio_q15(l, r), u + d + l + r
+        if not self.active:
+            self.active = True
+            self.samples = 0
+            self.ud_entry = self.ud_exit = ud
+            self.lr_entry = self.lr_exit = lr
+            self.entry_level = self.peak_level = self.exit_level = level
+        else:
+            self.ud_exit = smooth(self.ud_exit, ud)
+            self.lr_exit = smooth(self.lr_exit, lr)
+            self.exit_level = smooth(self.exit_level, level)
+            self.peak_level = max(self.peak_level, level)
+        self.samples = min(self.samples + 1, 0xFFFF)
+        return None
+
+    def finish(self):
+        if not self.active:
+            return None
+        self.active = False
+        return {
+            "ud_delta": self.ud_exit - self.ud_entry,
+            "lr_delta": self.lr_exit - self.lr_entry,
+            "samples": self.samples,
+            "entry_level": self.entry_level,
+            "peak_level": self.peak_level,
+            "exit_level": self.exit_level,
+        }
+
+
+def features(res):
+    """Port of gesture_classifier_features()."""
+    ud_mag, lr_mag = abs(res["ud_delta"]), abs(res["lr_delta"])
+    return [
+        res["ud_delta"],
+        res["lr_delta"],
+        ud_mag - lr_mag,
+        max(ud_mag, lr_mag),
+        res["samples"],
+        res["entry_level"],
+        res["peak_level"],
+        res["exit_level"] - res["entry_level"],
+    ]
+
+
+def read_trace(path):
+    data = open(path, "rb").read()
+    magic, version, record_size, sensor_count, record_count, _, _ = HEADER.unpack_from(data)
+    if magic != TRACE_MAGIC or version != TRACE_VERSION or record_size != RECORD.size:
+        raise ValueError(f"{path}: not a version {TRACE_VERSION} gesture trace")
+    offset = HEADER.size + sensor_count * SENSOR_SIZE
+    if len(data) < offset + record_count * RECORD.size:
+        raise ValueError(f"{path}: truncated")
+    for n in range(record_count):
+        _, kind, _, u, d, l, r = RECORD.unpack_from(data, offset + n * RECORD.size)
+        yield kind & 0x0F, kind >> 4, (u, d, l, r)
+
+
+def results(path):
+    """Every finished trajectory of a trace as (sensor, decoder fields), in record order."""
+    decoders = {}
+    for kind, sensor, dataset in read_trace(path):
+        dec = decoders.setdefault(sensor, Decoder())
+        if kind == SAMPLE_DATASET:
+            res = dec.push(*dataset)
+        elif kind == SAMPLE_EXIT:
+            res = dec.finish()
+        else:
+            continue
+        if res is not None:
+            yield sensor, res
+
+
+def trajectories(path):
+    for _, res in results(path):
+        yield features(res)
+
+
+def dump(kind, paths):
+    """One line per trajectory, the format test/host/test_gesture_{decoder,classifier}.c print for the C side."""
+    tree = load_model(OUTPUT) if kind == "classifier" else None
+    for path in sorted(paths, key=os.path.basename):
+        name = os.path.basename(path)
+        for sensor, res in results(path):
+            if kind == "classifier":
+                x = features(res)
+                print(name, sensor, *x, predict(tree, x))
+            else:
+                fields = [res[key] for key in ("ud_delta", "lr_delta", "samples", "entry_level", "peak_level", "exit_level")]
+                print(name, sensor, *fields)
+
+
+def label_of(path):
+    name = os.path.basename(path).lower()
+    for label in sorted(LABELS, key=len, reverse=True):
+        if re.match(label.lower() + r"([_\-.]|$)", name):
+            return "TAP" if label == "DOUBLE_TAP" else label
+    raise ValueError(f"{path}: file name does not start with a gesture label")
+
+
+# A node is ("leaf", label) or ("split", feature, threshold, left, right); left takes feature <= threshold.
+
+def gini(counts, total):
+    return 1.0 - sum((c / total) ** 2 for c in counts.values())
+
+
+def best_split(rows, min_leaf):
+    labels = Counter(label for _, label in rows)
+    best = None
+    parent = gini(labels, len(rows))
+    for f in range(len(FEATURES)):
+        ordered = sorted(rows, key=lambda row: row[0][f])
+        left = Counter()
+        for i in range(len(ordered) - 1):
+            left[ordered[i][1]] += 1
+            a, b = ordered[i][0][f], ordered[i + 1][0][f]
+            n_left = i + 1
+            if a == b or n_left < min_leaf or len(ordered) - n_left < min_leaf:
+                continue
+            right = labels - left
+            score = (n_left * gini(left, n_left) + (len(ordered) - n_left) * gini(right, len(ordered) - n_left)) / len(ordered)
+            if score < parent - 1e-9 and (best is None or score < best[0]):
+                best = (score, f, (a + b) // 2)
+    return best
+
+
+def grow(rows, depth, max_depth, min_leaf):
+    majority = Counter(label for _, label in rows).most_common(1)[0][0]
+    if depth >= max_depth or len(set(label for _, label in rows)) == 1:
+        return ("leaf", majority)
+    split = best_split(rows, min_leaf)
+    if split is None:
+        return ("leaf", majority)
+    _, f, threshold = split
+    left = [row for row in rows if row[0][f] <= threshold]
+    right = [row for row in rows if row[0][f] > threshold]
+    return ("split", f, threshold, grow(left, depth + 1, max_depth, min_leaf), grow(right, depth + 1, max_depth, min_leaf))
+
+
+def predict(node, x):
+    while node[0] == "split":
+        node = node[3] if x[node[1]] <= node[2] else node[4]
+    return node[1]
+
+
+def seed_tree():
+    """Hand-written starting point: the threshold decoder's swipes plus rough hold/approach/retreat/tap rules."""
+    f = FEATURES.index
+    leaf = lambda label: ("leaf", label)
+    split = lambda name, threshold, left, right: ("split", f(name), threshold, left, right)
+    still = split("SAMPLES", 3, leaf("NONE"),
+                  split("SAMPLES", 12,
+                        split("PEAK_LEVEL", 400, leaf("NONE"), leaf("TAP")),
+                        split("LEVEL_DELTA", -200, leaf("RETREAT"),
+                              split("LEVEL_DELTA", 200, leaf("HOLD"), leaf("APPROACH")))))
+    swipe = split("SAMPLES", 3, leaf("NONE"),
+                  split("AXIS_MARGIN", -1,
+                        split("LR_DELTA", -1, leaf("LEFT"), leaf("RIGHT")),
+                        split("UD_DELTA", -1, leaf("UP"), leaf("DOWN"))))
+    return split("MOTION", Q15_ONE // 2 - 1, still, swipe)
+
+
+def load_model(path):
+    """Read a model written by emit() back into the node tuples used by predict()."""
+    node_re = re.compile(r"\.threshold = (-?\d+), \.feature = GESTURE_(?:FEATURE_)?(\w+), \.label = GESTURE_(\w+), \.right = (\d+)")
+    nodes = [node_re.search(line).groups() for line in open(path) if ".threshold =" in line]
+
+    def build(idx):
+        threshold, feature, label, right = nodes[idx]
+        if feature == "TREE_LEAF":
+            return ("leaf", label)
+        return ("split", FEATURES.index(feature), int(threshold), build(idx + 1), build(int(right)))
+
+    return build(0)
+
+
+def flatten(node, out):
+    """Pre-order layout: the left child follows its parent, the right index is patched in."""
+    idx = len(out)
+    if node[0] == "leaf":
+        out.append(("leaf", node[1]))
+        return idx
+    out.append(None)
+    flatten(node[3], out)
+    right = flatten(node[4], out)
+    out[idx] = ("split", node[1], node[2], right)
+    return idx
+
+
+def depth_of(node):
+    return 0 if node[0] == "leaf" else 1 + max(depth_of(node[3]), depth_of(node[4]))
+
+
+def report(tree, test):
+    correct = sum(predict(tree, x) == label for x, label in test)
+    print(f"Accuracy: {correct}/{len(test)} ({100.0 * correct / len(test):.1f}%)")
+    for label in sorted(set(l for _, l in test)):
+        rows = [x for x, l in test if l == label]
+        hits = Counter(predict(tree, x) for x in rows)
+        print(f"  {label:10s} {hits[label]:4d}/{len(rows):<4d} {dict(hits)}")
+
+
+def emit(tree, source, path):
+    nodes = []
+    flatten(tree, nodes)
+    lines = [
+        "// Generated by tools/train_gesture_model.py, do not edit by hand.",
+        *(f"// {line}" for line in source.splitlines()),
+        '#include "../include/gesture_classifier.h"',
+        "",
+        "const gesture_tree_node_t gesture_model_nodes[] = {",
+    ]
+    for n, node in enumerate(nodes):
+        if node[0] == "leaf":
+            body = f".threshold = 0, .feature = GESTURE_TREE_LEAF, .label = GESTURE_{node[1]}, .right = 0"
+        else:
+            body = f".threshold = {node[2]}, .feature = GESTURE_FEATURE_{FEATURES[node[1]]}, .label = GESTURE_NONE, .right = {node[3]}"
+        lines.append(f"    /* {n:3d} */ {{ {body} }},")
+    lines += [
+        "};",
+        "",
+        "const uint16_t gesture_model_node_count = sizeof(gesture_model_nodes) / sizeof(gesture_model_nodes[0]);",
+        "",
+    ]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+    print(f"Wrote {len(nodes)} nodes (depth {depth_of(tree)}) to {os.path.normpath(path)}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("traces", nargs="*", help="labelled .gtrc trace files")
+    parser.add_argument("--seed", action="store_true", help="emit the hand-written seed model instead of training")
+    parser.add_argument("--evaluate", action="store_true", help="score the committed model on the traces and exit")
+    parser.add_argument("--dump", choices=["decoder", "classifier"], help="print the decoded trajectories of the traces and exit")
+    parser.add_argument("--max-depth", type=int, default=8)
+    parser.add_argument("--min-leaf", type=int, default=3, help="fewest trajectories per leaf")
+    parser.add_argument("--holdout", type=float, default=0.2, help="fraction of trace files kept out of training")
+    parser.add_argument("--random-seed", type=int, default=1)
+    parser.add_argument("--output", default=OUTPUT)
+    args = parser.parse_args()
+
+    if args.max_depth > TREE_MAX_DEPTH:
+        parser.error(f"--max-depth is capped at GESTURE_TREE_MAX_DEPTH ({TREE_MAX_DEPTH})")
+    if args.dump:
+        dump(args.dump, args.traces)
+        return 0
+    if args.seed:
+        emit(seed_tree(), "PLACEHOLDER: hand-written seed model (tools/train_gesture_model.py --seed), not trained on\n"
+             "recorded gestures and without a measured accuracy. Retrain from captured traces before relying on it.",
+             args.output)
+        return 0
+    if args.evaluate:
+        if not args.traces:
+            parser.error("no trace files given")
+        print(f"{os.path.normpath(args.output)}:")
+        report(load_model(args.output), [(x, label_of(p)) for p in sorted(args.traces) for x in trajectories(p)])
+        return 0
+    if not args.traces:
+        parser.error("no trace files given (or use --seed)")
+
+    # Hold out whole files: trajectories from one recording are too alike to test on each other
+    files = sorted(args.traces)
+    random.Random(args.random_seed).shuffle(files)
+    n_test = int(round(len(files) * args.holdout))
+    test_files, train_files = files[:n_test], files[n_test:]
+    load = lambda paths: [(x, label_of(p)) for p in paths for x in trajectories(p)]
+    train, test = load(train_files), load(test_files)
+    if not train:
+        print("No trajectories in the training traces.", file=sys.stderr)
+        return 1
+
+    tree = grow(train, 0, args.max_depth, args.min_leaf)
+    print(f"Trained on {len(train)} trajectories from {len(train_files)} files: {dict(Counter(l for _, l in train))}")
+    accuracy = "no held-out files"
+    if test:
+        print(f"Held-out set: {len(test_files)} files")
+        report(tree, test)
+        correct = sum(predict(tree, x) == label for x, label in test)
+        accuracy = f"held-out accuracy {correct}/{len(test)} over {len(test_files)} files"
+    emit(tree, f"Trained on {len(train)} trajectories from {len(train_files)} trace files, {accuracy}.", args.output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())